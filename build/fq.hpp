@@ -131,6 +131,7 @@ void Fq_longErr();
 
 #else
 
+#include "raw_generic.hpp"
 
 void Fq_copy(PFqElement r, PFqElement a);
 void Fq_mul(PFqElement r, PFqElement a, PFqElement b);
@@ -161,18 +162,22 @@ void Fq_neg(PFqElement r, PFqElement a);
 void Fq_toMontgomery(PFqElement r, PFqElement a);
 void Fq_square(PFqElement r, PFqElement a);
 
-void Fq_rawCopy(FqRawElement pRawResult, const FqRawElement pRawA);
+// The raw operations the field class and the curve code call most are
+// inline, on the constants of the modulus, instead of mpn calls.
+typedef RawGeneric::Field<0x3c208c16d87cfd47, 0x97816a916871ca8d, 0xb85045b68181585d, 0x30644e72e131a029> Fq_RawGeneric;
+
+inline void Fq_rawCopy(FqRawElement pRawResult, const FqRawElement pRawA) { Fq_RawGeneric::copy(pRawResult, pRawA); }
 void Fq_rawSwap(FqRawElement pRawResult, FqRawElement pRawA);
-void Fq_rawAdd(FqRawElement pRawResult, const FqRawElement pRawA, const FqRawElement pRawB);
-void Fq_rawSub(FqRawElement pRawResult, const FqRawElement pRawA, const FqRawElement pRawB);
-void Fq_rawNeg(FqRawElement pRawResult, const FqRawElement pRawA);
-void Fq_rawMMul(FqRawElement pRawResult, const FqRawElement pRawA, const FqRawElement pRawB);
-void Fq_rawMSquare(FqRawElement pRawResult, const FqRawElement pRawA);
-void Fq_rawMMul1(FqRawElement pRawResult, const FqRawElement pRawA, uint64_t pRawB);
-void Fq_rawToMontgomery(FqRawElement pRawResult, const FqRawElement &pRawA);
-void Fq_rawFromMontgomery(FqRawElement pRawResult, const FqRawElement &pRawA);
-int Fq_rawIsEq(const FqRawElement pRawA, const FqRawElement pRawB);
-int Fq_rawIsZero(const FqRawElement pRawB);
+inline void Fq_rawAdd(FqRawElement pRawResult, const FqRawElement pRawA, const FqRawElement pRawB) { Fq_RawGeneric::add(pRawResult, pRawA, pRawB); }
+inline void Fq_rawSub(FqRawElement pRawResult, const FqRawElement pRawA, const FqRawElement pRawB) { Fq_RawGeneric::sub(pRawResult, pRawA, pRawB); }
+inline void Fq_rawNeg(FqRawElement pRawResult, const FqRawElement pRawA) { Fq_RawGeneric::neg(pRawResult, pRawA); }
+inline void Fq_rawMMul(FqRawElement pRawResult, const FqRawElement pRawA, const FqRawElement pRawB) { Fq_RawGeneric::mul(pRawResult, pRawA, pRawB); }
+inline void Fq_rawMSquare(FqRawElement pRawResult, const FqRawElement pRawA) { Fq_RawGeneric::square(pRawResult, pRawA); }
+inline void Fq_rawMMul1(FqRawElement pRawResult, const FqRawElement pRawA, uint64_t pRawB) { Fq_RawGeneric::mul1(pRawResult, pRawA, pRawB); }
+inline void Fq_rawToMontgomery(FqRawElement pRawResult, const FqRawElement &pRawA) { Fq_RawGeneric::toMontgomery(pRawResult, pRawA); }
+inline void Fq_rawFromMontgomery(FqRawElement pRawResult, const FqRawElement &pRawA) { Fq_RawGeneric::fromMontgomery(pRawResult, pRawA); }
+inline int Fq_rawIsEq(const FqRawElement pRawA, const FqRawElement pRawB) { return Fq_RawGeneric::isEq(pRawA, pRawB); }
+inline int Fq_rawIsZero(const FqRawElement pRawB) { return Fq_RawGeneric::isZero(pRawB); }
 void Fq_rawZero(FqRawElement pRawResult);
 void Fq_rawCopyS2L(FqRawElement pRawResult, int64_t val);
 void Fq_rawAddLS(FqRawElement pRawResult, FqRawElement pRawA, uint64_t rawB);
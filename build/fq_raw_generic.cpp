@@ -3,20 +3,9 @@
 #include <cstring>
 
 static uint64_t     Fq_rawq[] = {0x3c208c16d87cfd47,0x97816a916871ca8d,0xb85045b68181585d,0x30644e72e131a029, 0};
-static uint64_t     Fq_np     = {0x87d20782e4866389};
 static uint64_t     lboMask   =  0x3fffffffffffffff;
 
 
-void Fq_rawAdd(FqRawElement pRawResult, const FqRawElement pRawA, const FqRawElement pRawB)
-{
-    uint64_t carry = mpn_add_n(pRawResult, pRawA, pRawB, Fq_N64);
-
-    if(carry || mpn_cmp(pRawResult, Fq_rawq, Fq_N64) >= 0)
-    {
-        mpn_sub_n(pRawResult, pRawResult, Fq_rawq, Fq_N64);
-    }
-}
-
 void Fq_rawAddLS(FqRawElement pRawResult, FqRawElement pRawA, uint64_t rawB)
 {
     uint64_t carry = mpn_add_1(pRawResult, pRawA, Fq_N64, rawB);
@@ -27,16 +16,6 @@ void Fq_rawAddLS(FqRawElement pRawResult, FqRawElement pRawA, uint64_t rawB)
     }
 }
 
-void Fq_rawSub(FqRawElement pRawResult, const FqRawElement pRawA, const FqRawElement pRawB)
-{
-    uint64_t carry = mpn_sub_n(pRawResult, pRawA, pRawB, Fq_N64);
-
-    if(carry)
-    {
-        mpn_add_n(pRawResult, pRawResult, Fq_rawq, Fq_N64);
-    }
-}
-
 void Fq_rawSubRegular(FqRawElement pRawResult, FqRawElement pRawA, FqRawElement pRawB)
 {
     mpn_sub_n(pRawResult, pRawA, pRawB, Fq_N64);
@@ -64,20 +43,6 @@ void Fq_rawSubLS(FqRawElement pRawResult, FqRawElement pRawA, uint64_t rawB)
     }
 }
 
-void Fq_rawNeg(FqRawElement pRawResult, const FqRawElement pRawA)
-{
-    const uint64_t zero[Fq_N64] = {0, 0, 0, 0};
-
-    if (mpn_cmp(pRawA, zero, Fq_N64) != 0)
-    {
-        mpn_sub_n(pRawResult, Fq_rawq, pRawA, Fq_N64);
-    }
-    else
-    {
-        mpn_copyi(pRawResult, zero, Fq_N64);
-    }
-}
-
 //  Substracts a long element and a short element form 0
 void Fq_rawNegLS(FqRawElement pRawResult, FqRawElement pRawA, uint64_t rawB)
 {
@@ -90,141 +55,6 @@ void Fq_rawNegLS(FqRawElement pRawResult, FqRawElement pRawA, uint64_t rawB)
     }
 }
 
-void Fq_rawCopy(FqRawElement pRawResult, const FqRawElement pRawA)
-{
-    pRawResult[0] = pRawA[0];
-    pRawResult[1] = pRawA[1];
-    pRawResult[2] = pRawA[2];
-    pRawResult[3] = pRawA[3];
-}
-
-int Fq_rawIsEq(const FqRawElement pRawA, const FqRawElement pRawB)
-{
-    return mpn_cmp(pRawA, pRawB, Fq_N64) == 0;
-}
-
-void Fq_rawMMul(FqRawElement pRawResult, const FqRawElement pRawA, const FqRawElement pRawB)
-{
-    const mp_size_t  N = Fq_N64+1;
-    const uint64_t  *mq = Fq_rawq;
-
-    uint64_t  np0;
-
-    uint64_t  product0[N] = {0};
-    uint64_t  product1[N] = {0};
-    uint64_t  product2[N] = {0};
-    uint64_t  product3[N] = {0};
-
-    product0[4] = mpn_mul_1(product0, pRawB, Fq_N64, pRawA[0]);
-
-    np0 = Fq_np * product0[0];
-    product1[1] = mpn_addmul_1(product0, mq, N, np0);
-
-    product1[4] = mpn_addmul_1(product1, pRawB, Fq_N64, pRawA[1]);
-    mpn_add(product1, product1, N, product0+1, N-1);
-
-    np0 = Fq_np * product1[0];
-    product2[1] = mpn_addmul_1(product1, mq, N, np0);
-
-    product2[4] = mpn_addmul_1(product2, pRawB, Fq_N64, pRawA[2]);
-    mpn_add(product2, product2, N, product1+1, N-1);
-
-    np0 = Fq_np * product2[0];
-    product3[1] = mpn_addmul_1(product2, mq, N, np0);
-
-    product3[4] = mpn_addmul_1(product3, pRawB, Fq_N64, pRawA[3]);
-    mpn_add(product3, product3, N, product2+1, N-1);
-
-    np0 = Fq_np * product3[0];
-    mpn_addmul_1(product3, mq, N, np0);
-
-    mpn_copyi(pRawResult,  product3+1, Fq_N64);
-
-    if (mpn_cmp(pRawResult, mq, Fq_N64) >= 0)
-    {
-        mpn_sub_n(pRawResult, pRawResult, mq, Fq_N64);
-    }
-}
-
-void Fq_rawMMul1(FqRawElement pRawResult, const FqRawElement pRawA, uint64_t pRawB)
-{
-    const mp_size_t  N = Fq_N64+1;
-    const uint64_t  *mq = Fq_rawq;
-
-    uint64_t  np0;
-
-    uint64_t  product0[N] = {0};
-    uint64_t  product1[N] = {0};
-    uint64_t  product2[N] = {0};
-    uint64_t  product3[N] = {0};
-
-    product0[4] = mpn_mul_1(product0, pRawA, Fq_N64, pRawB);
-
-    np0 = Fq_np * product0[0];
-    product1[1] = mpn_addmul_1(product0, mq, N, np0);
-    mpn_add(product1, product1, N, product0+1, N-1);
-
-    np0 = Fq_np * product1[0];
-    product2[1] = mpn_addmul_1(product1, mq, N, np0);
-    mpn_add(product2, product2, N, product1+1, N-1);
-
-    np0 = Fq_np * product2[0];
-    product3[1] = mpn_addmul_1(product2, mq, N, np0);
-    mpn_add(product3, product3, N, product2+1, N-1);
-
-    np0 = Fq_np * product3[0];
-    mpn_addmul_1(product3, mq, N, np0);
-
-    mpn_copyi(pRawResult,  product3+1, Fq_N64);
-
-    if (mpn_cmp(pRawResult, mq, Fq_N64) >= 0)
-    {
-        mpn_sub_n(pRawResult, pRawResult, mq, Fq_N64);
-    }
-}
-
-void Fq_rawFromMontgomery(FqRawElement pRawResult, const FqRawElement &pRawA)
-{
-    const mp_size_t  N = Fq_N64+1;
-    const uint64_t  *mq = Fq_rawq;
-
-    uint64_t  np0;
-
-    uint64_t  product0[N];
-    uint64_t  product1[N] = {0};
-    uint64_t  product2[N] = {0};
-    uint64_t  product3[N] = {0};
-
-    mpn_copyi(product0, pRawA, Fq_N64); product0[4] = 0;
-
-    np0 = Fq_np * product0[0];
-    product1[1] = mpn_addmul_1(product0, mq, N, np0);
-    mpn_add(product1, product1, N, product0+1, N-1);
-
-    np0 = Fq_np * product1[0];
-    product2[1] = mpn_addmul_1(product1, mq, N, np0);
-    mpn_add(product2, product2, N, product1+1, N-1);
-
-    np0 = Fq_np * product2[0];
-    product3[1] = mpn_addmul_1(product2, mq, N, np0);
-    mpn_add(product3, product3, N, product2+1, N-1);
-
-    np0 = Fq_np * product3[0];
-    mpn_addmul_1(product3, mq, N, np0);
-
-    mpn_copyi(pRawResult,  product3+1, Fq_N64);
-
-    if (mpn_cmp(pRawResult, mq, Fq_N64) >= 0)
-    {
-        mpn_sub_n(pRawResult, pRawResult, mq, Fq_N64);
-    }
-}
-
-int Fq_rawIsZero(const FqRawElement rawA)
-{
-    return mpn_zero_p(rawA, Fq_N64) ? 1 : 0;
-}
-
 int Fq_rawCmp(FqRawElement pRawA, FqRawElement pRawB)
 {
     return mpn_cmp(pRawA, pRawB, Fq_N64);
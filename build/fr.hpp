@@ -131,6 +131,7 @@ extern "C" void Fr_rawSubRegular(FrRawElement pRawResult, FrRawElement pRawA, Fr
 
 #else
 
+#include "raw_generic.hpp"
 
 void Fr_copy(PFrElement r, PFrElement a);
 void Fr_mul(PFrElement r, PFrElement a, PFrElement b);
@@ -161,18 +162,22 @@ void Fr_neg(PFrElement r, PFrElement a);
 void Fr_toMontgomery(PFrElement r, PFrElement a);
 void Fr_square(PFrElement r, PFrElement a);
 
-void Fr_rawCopy(FrRawElement pRawResult, const FrRawElement pRawA);
+// The raw operations the field class and the curve code call most are
+// inline, on the constants of the modulus, instead of mpn calls.
+typedef RawGeneric::Field<0x43e1f593f0000001, 0x2833e84879b97091, 0xb85045b68181585d, 0x30644e72e131a029> Fr_RawGeneric;
+
+inline void Fr_rawCopy(FrRawElement pRawResult, const FrRawElement pRawA) { Fr_RawGeneric::copy(pRawResult, pRawA); }
 void Fr_rawSwap(FrRawElement pRawResult, FrRawElement pRawA);
-void Fr_rawAdd(FrRawElement pRawResult, const FrRawElement pRawA, const FrRawElement pRawB);
-void Fr_rawSub(FrRawElement pRawResult, const FrRawElement pRawA, const FrRawElement pRawB);
-void Fr_rawNeg(FrRawElement pRawResult, const FrRawElement pRawA);
-void Fr_rawMMul(FrRawElement pRawResult, const FrRawElement pRawA, const FrRawElement pRawB);
-void Fr_rawMSquare(FrRawElement pRawResult, const FrRawElement pRawA);
-void Fr_rawMMul1(FrRawElement pRawResult, const FrRawElement pRawA, uint64_t pRawB);
-void Fr_rawToMontgomery(FrRawElement pRawResult, const FrRawElement &pRawA);
-void Fr_rawFromMontgomery(FrRawElement pRawResult, const FrRawElement &pRawA);
-int Fr_rawIsEq(const FrRawElement pRawA, const FrRawElement pRawB);
-int Fr_rawIsZero(const FrRawElement pRawB);
+inline void Fr_rawAdd(FrRawElement pRawResult, const FrRawElement pRawA, const FrRawElement pRawB) { Fr_RawGeneric::add(pRawResult, pRawA, pRawB); }
+inline void Fr_rawSub(FrRawElement pRawResult, const FrRawElement pRawA, const FrRawElement pRawB) { Fr_RawGeneric::sub(pRawResult, pRawA, pRawB); }
+inline void Fr_rawNeg(FrRawElement pRawResult, const FrRawElement pRawA) { Fr_RawGeneric::neg(pRawResult, pRawA); }
+inline void Fr_rawMMul(FrRawElement pRawResult, const FrRawElement pRawA, const FrRawElement pRawB) { Fr_RawGeneric::mul(pRawResult, pRawA, pRawB); }
+inline void Fr_rawMSquare(FrRawElement pRawResult, const FrRawElement pRawA) { Fr_RawGeneric::square(pRawResult, pRawA); }
+inline void Fr_rawMMul1(FrRawElement pRawResult, const FrRawElement pRawA, uint64_t pRawB) { Fr_RawGeneric::mul1(pRawResult, pRawA, pRawB); }
+inline void Fr_rawToMontgomery(FrRawElement pRawResult, const FrRawElement &pRawA) { Fr_RawGeneric::toMontgomery(pRawResult, pRawA); }
+inline void Fr_rawFromMontgomery(FrRawElement pRawResult, const FrRawElement &pRawA) { Fr_RawGeneric::fromMontgomery(pRawResult, pRawA); }
+inline int Fr_rawIsEq(const FrRawElement pRawA, const FrRawElement pRawB) { return Fr_RawGeneric::isEq(pRawA, pRawB); }
+inline int Fr_rawIsZero(const FrRawElement pRawB) { return Fr_RawGeneric::isZero(pRawB); }
 void Fr_rawZero(FrRawElement pRawResult);
 void Fr_rawCopyS2L(FrRawElement pRawResult, int64_t val);
 void Fr_rawAddLS(FrRawElement pRawResult, FrRawElement pRawA, uint64_t rawB);
@@ -3,20 +3,9 @@
 #include <cstring>
 
 static uint64_t     Fr_rawq[] = {0x43e1f593f0000001,0x2833e84879b97091,0xb85045b68181585d,0x30644e72e131a029, 0};
-static uint64_t     Fr_np     = {0xc2e1f593efffffff};
 static uint64_t     lboMask   =  0x3fffffffffffffff;
 
 
-void Fr_rawAdd(FrRawElement pRawResult, const FrRawElement pRawA, const FrRawElement pRawB)
-{
-    uint64_t carry = mpn_add_n(pRawResult, pRawA, pRawB, Fr_N64);
-
-    if(carry || mpn_cmp(pRawResult, Fr_rawq, Fr_N64) >= 0)
-    {
-        mpn_sub_n(pRawResult, pRawResult, Fr_rawq, Fr_N64);
-    }
-}
-
 void Fr_rawAddLS(FrRawElement pRawResult, FrRawElement pRawA, uint64_t rawB)
 {
     uint64_t carry = mpn_add_1(pRawResult, pRawA, Fr_N64, rawB);
@@ -27,16 +16,6 @@ void Fr_rawAddLS(FrRawElement pRawResult, FrRawElement pRawA, uint64_t rawB)
     }
 }
 
-void Fr_rawSub(FrRawElement pRawResult, const FrRawElement pRawA, const FrRawElement pRawB)
-{
-    uint64_t carry = mpn_sub_n(pRawResult, pRawA, pRawB, Fr_N64);
-
-    if(carry)
-    {
-        mpn_add_n(pRawResult, pRawResult, Fr_rawq, Fr_N64);
-    }
-}
-
 void Fr_rawSubRegular(FrRawElement pRawResult, FrRawElement pRawA, FrRawElement pRawB)
 {
     mpn_sub_n(pRawResult, pRawA, pRawB, Fr_N64);
@@ -64,20 +43,6 @@ void Fr_rawSubLS(FrRawElement pRawResult, FrRawElement pRawA, uint64_t rawB)
     }
 }
 
-void Fr_rawNeg(FrRawElement pRawResult, const FrRawElement pRawA)
-{
-    const uint64_t zero[Fr_N64] = {0, 0, 0, 0};
-
-    if (mpn_cmp(pRawA, zero, Fr_N64) != 0)
-    {
-        mpn_sub_n(pRawResult, Fr_rawq, pRawA, Fr_N64);
-    }
-    else
-    {
-        mpn_copyi(pRawResult, zero, Fr_N64);
-    }
-}
-
 //  Substracts a long element and a short element form 0
 void Fr_rawNegLS(FrRawElement pRawResult, FrRawElement pRawA, uint64_t rawB)
 {
@@ -90,141 +55,6 @@ void Fr_rawNegLS(FrRawElement pRawResult, FrRawElement pRawA, uint64_t rawB)
     }
 }
 
-void Fr_rawCopy(FrRawElement pRawResult, const FrRawElement pRawA)
-{
-    pRawResult[0] = pRawA[0];
-    pRawResult[1] = pRawA[1];
-    pRawResult[2] = pRawA[2];
-    pRawResult[3] = pRawA[3];
-}
-
-int Fr_rawIsEq(const FrRawElement pRawA, const FrRawElement pRawB)
-{
-    return mpn_cmp(pRawA, pRawB, Fr_N64) == 0;
-}
-
-void Fr_rawMMul(FrRawElement pRawResult, const FrRawElement pRawA, const FrRawElement pRawB)
-{
-    const mp_size_t  N = Fr_N64+1;
-    const uint64_t  *mq = Fr_rawq;
-
-    uint64_t  np0;
-
-    uint64_t  product0[N] = {0};
-    uint64_t  product1[N] = {0};
-    uint64_t  product2[N] = {0};
-    uint64_t  product3[N] = {0};
-
-    product0[4] = mpn_mul_1(product0, pRawB, Fr_N64, pRawA[0]);
-
-    np0 = Fr_np * product0[0];
-    product1[1] = mpn_addmul_1(product0, mq, N, np0);
-
-    product1[4] = mpn_addmul_1(product1, pRawB, Fr_N64, pRawA[1]);
-    mpn_add(product1, product1, N, product0+1, N-1);
-
-    np0 = Fr_np * product1[0];
-    product2[1] = mpn_addmul_1(product1, mq, N, np0);
-
-    product2[4] = mpn_addmul_1(product2, pRawB, Fr_N64, pRawA[2]);
-    mpn_add(product2, product2, N, product1+1, N-1);
-
-    np0 = Fr_np * product2[0];
-    product3[1] = mpn_addmul_1(product2, mq, N, np0);
-
-    product3[4] = mpn_addmul_1(product3, pRawB, Fr_N64, pRawA[3]);
-    mpn_add(product3, product3, N, product2+1, N-1);
-
-    np0 = Fr_np * product3[0];
-    mpn_addmul_1(product3, mq, N, np0);
-
-    mpn_copyi(pRawResult,  product3+1, Fr_N64);
-
-    if (mpn_cmp(pRawResult, mq, Fr_N64) >= 0)
-    {
-        mpn_sub_n(pRawResult, pRawResult, mq, Fr_N64);
-    }
-}
-
-void Fr_rawMMul1(FrRawElement pRawResult, const FrRawElement pRawA, uint64_t pRawB)
-{
-    const mp_size_t  N = Fr_N64+1;
-    const uint64_t  *mq = Fr_rawq;
-
-    uint64_t  np0;
-
-    uint64_t  product0[N] = {0};
-    uint64_t  product1[N] = {0};
-    uint64_t  product2[N] = {0};
-    uint64_t  product3[N] = {0};
-
-    product0[4] = mpn_mul_1(product0, pRawA, Fr_N64, pRawB);
-
-    np0 = Fr_np * product0[0];
-    product1[1] = mpn_addmul_1(product0, mq, N, np0);
-    mpn_add(product1, product1, N, product0+1, N-1);
-
-    np0 = Fr_np * product1[0];
-    product2[1] = mpn_addmul_1(product1, mq, N, np0);
-    mpn_add(product2, product2, N, product1+1, N-1);
-
-    np0 = Fr_np * product2[0];
-    product3[1] = mpn_addmul_1(product2, mq, N, np0);
-    mpn_add(product3, product3, N, product2+1, N-1);
-
-    np0 = Fr_np * product3[0];
-    mpn_addmul_1(product3, mq, N, np0);
-
-    mpn_copyi(pRawResult,  product3+1, Fr_N64);
-
-    if (mpn_cmp(pRawResult, mq, Fr_N64) >= 0)
-    {
-        mpn_sub_n(pRawResult, pRawResult, mq, Fr_N64);
-    }
-}
-
-void Fr_rawFromMontgomery(FrRawElement pRawResult, const FrRawElement &pRawA)
-{
-    const mp_size_t  N = Fr_N64+1;
-    const uint64_t  *mq = Fr_rawq;
-
-    uint64_t  np0;
-
-    uint64_t  product0[N];
-    uint64_t  product1[N] = {0};
-    uint64_t  product2[N] = {0};
-    uint64_t  product3[N] = {0};
-
-    mpn_copyi(product0, pRawA, Fr_N64); product0[4] = 0;
-
-    np0 = Fr_np * product0[0];
-    product1[1] = mpn_addmul_1(product0, mq, N, np0);
-    mpn_add(product1, product1, N, product0+1, N-1);
-
-    np0 = Fr_np * product1[0];
-    product2[1] = mpn_addmul_1(product1, mq, N, np0);
-    mpn_add(product2, product2, N, product1+1, N-1);
-
-    np0 = Fr_np * product2[0];
-    product3[1] = mpn_addmul_1(product2, mq, N, np0);
-    mpn_add(product3, product3, N, product2+1, N-1);
-
-    np0 = Fr_np * product3[0];
-    mpn_addmul_1(product3, mq, N, np0);
-
-    mpn_copyi(pRawResult,  product3+1, Fr_N64);
-
-    if (mpn_cmp(pRawResult, mq, Fr_N64) >= 0)
-    {
-        mpn_sub_n(pRawResult, pRawResult, mq, Fr_N64);
-    }
-}
-
-int Fr_rawIsZero(const FrRawElement rawA)
-{
-    return mpn_zero_p(rawA, Fr_N64) ? 1 : 0;
-}
-
 int Fr_rawCmp(FrRawElement pRawA, FrRawElement pRawB)
 {
     return mpn_cmp(pRawA, pRawB, Fr_N64);
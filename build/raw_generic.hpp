@@ -0,0 +1,260 @@
+#ifndef __RAW_GENERIC_H
+#define __RAW_GENERIC_H
+
+#include <cstdint>
+
+// Header-only Montgomery arithmetic over a 4-limb prime field, used by the
+// builds without the asm field code. The modulus is a template argument, so
+// every constant folds into the code, and the operations are inline so the
+// compiler sees through them in the prover and curve loops instead of
+// calling out to mpn.
+namespace RawGeneric {
+
+    typedef unsigned __int128 u128;
+
+    struct Limbs {
+        uint64_t w[4];
+    };
+
+    // Compile-time helpers. C++11 constexpr functions are a single return
+    // statement, hence the recursion.
+
+    // Inverse of an odd x modulo 2^64 by Newton's iteration, which doubles
+    // the correct low bits from the 3 of x itself.
+    constexpr uint64_t inverse64(uint64_t x, uint64_t inv = 0, int steps = 6) {
+        return steps == 6 ? inverse64(x, x, steps - 1)
+             : steps == 0 ? inv
+             : inverse64(x, inv * (2 - x * inv), steps - 1);
+    }
+
+    constexpr bool borrows(uint64_t a, uint64_t b, bool borrowIn) {
+        return a < b || (a == b && borrowIn);
+    }
+
+    constexpr Limbs subtract(const Limbs &a, const Limbs &b) {
+        return Limbs{{
+            a.w[0] - b.w[0],
+            a.w[1] - b.w[1] - borrows(a.w[0], b.w[0], false),
+            a.w[2] - b.w[2] - borrows(a.w[1], b.w[1], borrows(a.w[0], b.w[0], false)),
+            a.w[3] - b.w[3] - borrows(a.w[2], b.w[2], borrows(a.w[1], b.w[1], borrows(a.w[0], b.w[0], false)))
+        }};
+    }
+
+    constexpr bool lessThan(const Limbs &a, const Limbs &b) {
+        return a.w[3] != b.w[3] ? a.w[3] < b.w[3]
+             : a.w[2] != b.w[2] ? a.w[2] < b.w[2]
+             : a.w[1] != b.w[1] ? a.w[1] < b.w[1]
+             : a.w[0] < b.w[0];
+    }
+
+    constexpr Limbs shiftLeft1(const Limbs &a) {
+        return Limbs{{
+            a.w[0] << 1,
+            (a.w[1] << 1) | (a.w[0] >> 63),
+            (a.w[2] << 1) | (a.w[1] >> 63),
+            (a.w[3] << 1) | (a.w[2] >> 63)
+        }};
+    }
+
+    // 2x mod q for x < q < 2^255.
+    constexpr Limbs doubleMod(const Limbs &x, const Limbs &q) {
+        return lessThan(shiftLeft1(x), q) ? shiftLeft1(x) : subtract(shiftLeft1(x), q);
+    }
+
+    // x * 2^n mod q.
+    constexpr Limbs shiftMod(const Limbs &x, const Limbs &q, int n) {
+        return n == 0 ? x : shiftMod(doubleMod(x, q), q, n - 1);
+    }
+
+    // Runtime helpers.
+
+    // Returns the low word of a * b + c + carry and leaves the high word in
+    // carry. The sum is at most 2^128 - 1.
+    inline uint64_t mac(uint64_t a, uint64_t b, uint64_t c, uint64_t &carry) {
+        const u128 t = (u128)a * b + c + carry;
+        carry = (uint64_t)(t >> 64);
+        return (uint64_t)t;
+    }
+
+    inline uint64_t addc(uint64_t a, uint64_t b, uint64_t &carry) {
+        const u128 t = (u128)a + b + carry;
+        carry = (uint64_t)(t >> 64);
+        return (uint64_t)t;
+    }
+
+    inline uint64_t subb(uint64_t a, uint64_t b, uint64_t &borrow) {
+        const u128 t = (u128)a - b - borrow;
+        borrow = (uint64_t)(t >> 64) & 1;
+        return (uint64_t)t;
+    }
+
+    // Field modulo q0 + q1 2^64 + q2 2^128 + q3 2^192, odd and below 2^255,
+    // with elements in Montgomery form for R = 2^256. Inputs may be any 256
+    // bit value, with the results the mpn code gave; results are below q
+    // for inputs below q.
+    template <uint64_t q0, uint64_t q1, uint64_t q2, uint64_t q3>
+    struct Field {
+
+        static_assert(q0 & 1, "the modulus must be odd");
+        static_assert(q3 >> 63 == 0, "the modulus must be below 2^255");
+
+        static constexpr Limbs q() { return Limbs{{q0, q1, q2, q3}}; }
+
+        // -q^-1 mod 2^64
+        static constexpr uint64_t np() { return 0 - inverse64(q0); }
+
+        // R mod q and R^2 mod q.
+        static constexpr Limbs R() { return shiftMod(Limbs{{1, 0, 0, 0}}, q(), 256); }
+        static constexpr Limbs R2() { return shiftMod(R(), q(), 256); }
+
+        static_assert(q0 * inverse64(q0) == 1, "np is not the inverse of q");
+
+        static inline void copy(uint64_t *r, const uint64_t *a) {
+            r[0] = a[0];
+            r[1] = a[1];
+            r[2] = a[2];
+            r[3] = a[3];
+        }
+
+        // r = t - q when t (with its carry word) is at least q.
+        static inline void reduce(uint64_t *r, const uint64_t *t, uint64_t carry) {
+            uint64_t borrow = 0;
+            uint64_t d[4];
+
+            d[0] = subb(t[0], q0, borrow);
+            d[1] = subb(t[1], q1, borrow);
+            d[2] = subb(t[2], q2, borrow);
+            d[3] = subb(t[3], q3, borrow);
+
+            if (carry || !borrow) {
+                copy(r, d);
+            } else {
+                copy(r, t);
+            }
+        }
+
+        static inline void add(uint64_t *r, const uint64_t *a, const uint64_t *b) {
+            uint64_t carry = 0;
+            uint64_t t[4];
+
+            t[0] = addc(a[0], b[0], carry);
+            t[1] = addc(a[1], b[1], carry);
+            t[2] = addc(a[2], b[2], carry);
+            t[3] = addc(a[3], b[3], carry);
+
+            reduce(r, t, carry);
+        }
+
+        static inline void sub(uint64_t *r, const uint64_t *a, const uint64_t *b) {
+            uint64_t borrow = 0;
+            uint64_t t[4];
+
+            t[0] = subb(a[0], b[0], borrow);
+            t[1] = subb(a[1], b[1], borrow);
+            t[2] = subb(a[2], b[2], borrow);
+            t[3] = subb(a[3], b[3], borrow);
+
+            if (borrow) {
+                uint64_t carry = 0;
+
+                t[0] = addc(t[0], q0, carry);
+                t[1] = addc(t[1], q1, carry);
+                t[2] = addc(t[2], q2, carry);
+                t[3] = addc(t[3], q3, carry);
+            }
+            copy(r, t);
+        }
+
+        static inline void neg(uint64_t *r, const uint64_t *a) {
+            if ((a[0] | a[1] | a[2] | a[3]) == 0) {
+                r[0] = r[1] = r[2] = r[3] = 0;
+                return;
+            }
+
+            uint64_t borrow = 0;
+
+            r[0] = subb(q0, a[0], borrow);
+            r[1] = subb(q1, a[1], borrow);
+            r[2] = subb(q2, a[2], borrow);
+            r[3] = subb(q3, a[3], borrow);
+        }
+
+        // One CIOS round: t = (t + a * b + m * q) / 2^64 with m chosen to
+        // clear the low word. t[4] holds what the round carries out of 2^320,
+        // which is only ever set by inputs not below q: it goes back in at
+        // 2^64 and the carries out of 2^320 are dropped, as the mpn code
+        // this replaces did, so out-of-range inputs give the same results.
+        static inline void round(uint64_t *t, const uint64_t *a, uint64_t b) {
+            uint64_t carry = 0;
+            uint64_t x[5];
+
+            x[0] = mac(a[0], b, t[0], carry);
+            x[1] = mac(a[1], b, t[1], carry);
+            x[2] = mac(a[2], b, t[2], carry);
+            x[3] = mac(a[3], b, t[3], carry);
+            x[4] = carry;
+
+            carry = 0;
+            x[1] = addc(x[1], t[4], carry);
+            x[2] = addc(x[2], 0, carry);
+            x[3] = addc(x[3], 0, carry);
+            x[4] += carry;
+
+            const uint64_t m = x[0] * np();
+
+            carry = 0;
+            mac(m, q0, x[0], carry);
+            t[0] = mac(m, q1, x[1], carry);
+            t[1] = mac(m, q2, x[2], carry);
+            t[2] = mac(m, q3, x[3], carry);
+
+            uint64_t high = 0;
+            t[3] = addc(x[4], carry, high);
+            t[4] = high;
+        }
+
+        // r = a * b / R mod q, one row per limb of a. The result is reduced
+        // once, by q, and is below q when a and b are.
+        static inline void mul(uint64_t *r, const uint64_t *a, const uint64_t *b) {
+            uint64_t t[5] = {0, 0, 0, 0, 0};
+
+            round(t, b, a[0]);
+            round(t, b, a[1]);
+            round(t, b, a[2]);
+            round(t, b, a[3]);
+
+            reduce(r, t, 0);
+        }
+
+        static inline void square(uint64_t *r, const uint64_t *a) {
+            mul(r, a, a);
+        }
+
+        // r = a * b / R mod q for a single word b.
+        static inline void mul1(uint64_t *r, const uint64_t *a, uint64_t b) {
+            const uint64_t w[4] = {b, 0, 0, 0};
+
+            mul(r, w, a);
+        }
+
+        static inline void toMontgomery(uint64_t *r, const uint64_t *a) {
+            constexpr Limbs r2 = R2();
+
+            mul(r, a, r2.w);
+        }
+
+        static inline void fromMontgomery(uint64_t *r, const uint64_t *a) {
+            mul1(r, a, 1);
+        }
+
+        static inline int isEq(const uint64_t *a, const uint64_t *b) {
+            return a[0] == b[0] && a[1] == b[1] && a[2] == b[2] && a[3] == b[3];
+        }
+
+        static inline int isZero(const uint64_t *a) {
+            return (a[0] | a[1] | a[2] | a[3]) == 0;
+        }
+    };
+}
+
+#endif // __RAW_GENERIC_H
@@ -0,0 +1,255 @@
+#include <algorithm>
+
+namespace BatchAffine {
+
+template <typename Field>
+void batchInverse(Field &F, FieldBatch::Batch<Field> &batch, typename Field::Element *r, typename Field::Element *a, uint64_t n) {
+
+    if (n == 0) {
+        return;
+    }
+
+    typename Field::Element acc;
+    typename Field::Element aux;
+
+    // r[i] = a[0] * ... * a[i]
+    F.copy(r[0], a[0]);
+    for (uint64_t i = 1; i < n; i++) {
+        batch.mul(&r[i], &r[i-1], &a[i], 1);
+    }
+
+    F.inv(acc, r[n-1]);
+
+    for (uint64_t i = n - 1; i > 0; i--) {
+        batch.mul(&aux, &acc, &r[i-1], 1);
+        batch.mul(&acc, &acc, &a[i], 1);
+        F.copy(r[i], aux);
+    }
+    F.copy(r[0], acc);
+}
+
+template <typename Curve>
+PairSum<Curve>::PairSum(Field &_F, uint64_t capacity)
+    : F(_F)
+    , batch(_F)
+    , x1(capacity)
+    , y1(capacity)
+    , x2(capacity)
+    , y2(capacity)
+    , lambda(capacity)
+    , x3(capacity)
+    , denominators(capacity)
+    , inverses(capacity)
+    , n(0)
+{
+}
+
+template <typename Curve>
+void PairSum<Curve>::push(PointAffine &p1, PointAffine &p2) {
+    x1[n] = p1.x;
+    y1[n] = p1.y;
+    x2[n] = p2.x;
+    y2[n] = p2.y;
+    n++;
+}
+
+template <typename Curve>
+void PairSum<Curve>::sum() {
+
+    batch.sub(denominators.data(), x2.data(), x1.data(), n);
+    batchInverse(F, batch, inverses.data(), denominators.data(), n);
+
+    // lambda = (y2 - y1) / (x2 - x1)
+    batch.sub(lambda.data(), y2.data(), y1.data(), n);
+    batch.mul(lambda.data(), lambda.data(), inverses.data(), n);
+
+    // x3 = lambda^2 - x1 - x2
+    batch.square(x3.data(), lambda.data(), n);
+    batch.sub(x3.data(), x3.data(), x1.data(), n);
+    batch.sub(x3.data(), x3.data(), x2.data(), n);
+
+    // y3 = lambda * (x1 - x3) - y1, left in y1
+    batch.sub(x1.data(), x1.data(), x3.data(), n);
+    batch.mul(x1.data(), lambda.data(), x1.data(), n);
+    batch.sub(y1.data(), x1.data(), y1.data(), n);
+}
+
+template <typename Curve>
+void PairSum<Curve>::get(PointAffine &r, uint64_t k) {
+    r.x = x3[k];
+    r.y = y1[k];
+}
+
+template <typename Curve>
+PointSum<Curve>::PointSum(Curve &_g, Field &_F)
+    : g(_g)
+    , F(_F)
+    , points(chunkSize)
+    , pairs(_F, chunkSize / 2)
+{
+}
+
+// Reduces points[0..m) to one point and adds it to 'acc'. Pairs with the
+// same x (doubling or opposite points) are left to the xyzz formulas.
+template <typename Curve>
+void PointSum<Curve>::reduce(Point &acc, uint64_t m) {
+    while (m > 1) {
+        const uint64_t nPairs = m / 2;
+
+        pairs.clear();
+
+        for (uint64_t k = 0; k < nPairs; k++) {
+            PointAffine &p1 = points[2*k];
+            PointAffine &p2 = points[2*k + 1];
+
+            if (F.eq(p1.x, p2.x)) {
+                g.add(acc, acc, p1);
+                g.add(acc, acc, p2);
+            } else {
+                pairs.push(p1, p2);
+            }
+        }
+
+        pairs.sum();
+
+        uint64_t out = pairs.size();
+
+        for (uint64_t k = 0; k < out; k++) {
+            pairs.get(points[k], k);
+        }
+
+        if (m & 1) {
+            points[out++] = points[m - 1];
+        }
+
+        m = out;
+    }
+
+    if (m == 1) {
+        g.add(acc, acc, points[0]);
+    }
+}
+
+template <typename Curve>
+void PointSum<Curve>::add(Point &acc, PointAffine *bases, const uint32_t *indices, uint64_t n) {
+
+    for (uint64_t start = 0; start < n; start += chunkSize) {
+        const uint64_t end = std::min(n, start + chunkSize);
+        uint64_t m = 0;
+
+        for (uint64_t i = start; i < end; i++) {
+            PointAffine &p = bases[indices ? indices[i] : i];
+
+            if (!g.isZero(p)) {
+                points[m++] = p;
+            }
+        }
+
+        reduce(acc, m);
+    }
+}
+
+template <typename Curve>
+const uint64_t BucketSum<Curve>::maxBatchSize;
+
+template <typename Curve>
+BucketSum<Curve>::BucketSum(Curve &_g, Field &_F, uint64_t nBuckets, uint64_t _batchSize)
+    : g(_g)
+    , F(_F)
+    , mixedAdd(_g, _F)
+    , batchSize(std::max<uint64_t>(1, _batchSize))
+    , buckets(nBuckets)
+    , state(nBuckets, Empty)
+    , pairs(_F, batchSize)
+    , xyzzBuckets(nullptr)
+{
+    queuedBuckets.reserve(batchSize);
+    queuedPoints.reserve(batchSize);
+}
+
+template <typename Curve>
+void BucketSum<Curve>::start(Point *_xyzzBuckets) {
+    xyzzBuckets = _xyzzBuckets;
+}
+
+template <typename Curve>
+void BucketSum<Curve>::add(uint64_t bucket, PointAffine &p, bool negative) {
+
+    if (g.isZero(p)) {
+        return;
+    }
+
+    switch (state[bucket]) {
+    case Empty:
+        buckets[bucket] = p;
+        if (negative) {
+            F.neg(buckets[bucket].y, p.y);
+        }
+        state[bucket] = Held;
+        break;
+
+    case Held:
+        queuedBuckets.push_back(bucket);
+        queuedPoints.push_back(p);
+        if (negative) {
+            F.neg(queuedPoints.back().y, p.y);
+        }
+        state[bucket] = Queued;
+
+        if (queuedBuckets.size() == batchSize) {
+            addQueued();
+        }
+        break;
+
+    default:
+        if (negative) {
+            mixedAdd.sub(xyzzBuckets[bucket], p);
+        } else {
+            mixedAdd.add(xyzzBuckets[bucket], p);
+        }
+        break;
+    }
+}
+
+template <typename Curve>
+void BucketSum<Curve>::addQueued() {
+    pairs.clear();
+
+    // Points with the x of their bucket are doublings or opposite points.
+    for (uint64_t k = 0; k < queuedBuckets.size(); k++) {
+        const uint32_t b = queuedBuckets[k];
+        PointAffine &p = queuedPoints[k];
+
+        if (F.eq(p.x, buckets[b].x)) {
+            mixedAdd.add(xyzzBuckets[b], p);
+        } else {
+            queuedBuckets[pairs.size()] = b;
+            pairs.push(buckets[b], p);
+        }
+        state[b] = Held;
+    }
+
+    pairs.sum();
+
+    for (uint64_t k = 0; k < pairs.size(); k++) {
+        pairs.get(buckets[queuedBuckets[k]], k);
+    }
+
+    queuedBuckets.clear();
+    queuedPoints.clear();
+}
+
+template <typename Curve>
+void BucketSum<Curve>::finish() {
+
+    addQueued();
+
+    for (uint64_t b = 0; b < buckets.size(); b++) {
+        if (state[b] != Empty) {
+            mixedAdd.add(xyzzBuckets[b], buckets[b]);
+            state[b] = Empty;
+        }
+    }
+}
+
+} // namespace
@@ -0,0 +1,138 @@
+#ifndef BATCH_AFFINE_HPP
+#define BATCH_AFFINE_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "field_batch.hpp"
+#include "mixed_add.hpp"
+
+namespace BatchAffine {
+
+    // Base field of a curve, Curve<BaseField>. The curves keep their field
+    // private, so the batch additions take it from the caller.
+    template <typename Curve>
+    struct CurveField;
+
+    template <template <typename> class CurveT, typename BaseField>
+    struct CurveField<CurveT<BaseField>> {
+        typedef BaseField Type;
+    };
+
+    // Montgomery's trick: inverts 'n' nonzero elements with one inversion
+    // and 3(n-1) multiplications, done by 'batch'. 'r' and 'a' must not
+    // overlap.
+    template <typename Field>
+    void batchInverse(Field &F, FieldBatch::Batch<Field> &batch, typename Field::Element *r, typename Field::Element *a, uint64_t n);
+
+    // Affine sums of pairs of points with distinct x. The pairs are queued
+    // with their coordinates split into one array each, and the sums run
+    // over whole arrays through FieldBatch once the denominators x2 - x1
+    // share their inversion.
+    template <typename Curve>
+    class PairSum {
+
+        typedef typename Curve::PointAffine PointAffine;
+        typedef decltype(PointAffine::x) Element;
+        typedef typename CurveField<Curve>::Type Field;
+
+        Field &F;
+        FieldBatch::Batch<Field> batch;
+
+        std::vector<Element> x1, y1, x2, y2;
+        std::vector<Element> lambda;
+        std::vector<Element> x3;
+        std::vector<Element> denominators;
+        std::vector<Element> inverses;
+        uint64_t n;
+
+    public:
+        PairSum(Field &_F, uint64_t capacity);
+
+        uint64_t size() const { return n; }
+        void clear() { n = 0; }
+
+        void push(PointAffine &p1, PointAffine &p2);
+
+        // Computes the sums of the queued pairs.
+        void sum();
+
+        // The sum of pair k, after sum().
+        void get(PointAffine &r, uint64_t k);
+    };
+
+    // Sums affine points pairwise in affine coordinates. The additions of
+    // one level of the reduction tree share a single inversion, so a point
+    // costs about 6 multiplications instead of the 11 of a mixed xyzz add.
+    template <typename Curve>
+    class PointSum {
+
+        typedef typename Curve::Point Point;
+        typedef typename Curve::PointAffine PointAffine;
+        typedef typename CurveField<Curve>::Type Field;
+        typedef typename Field::Element Element;
+
+        Curve &g;
+        Field &F;
+
+        std::vector<PointAffine> points;
+        PairSum<Curve> pairs;
+
+        void reduce(Point &acc, uint64_t m);
+
+    public:
+        static const uint64_t chunkSize = 1024;
+
+        PointSum(Curve &_g, Field &_F);
+
+        // Adds bases[indices[i]] (bases[i] if 'indices' is null) for i < n
+        // to 'acc'.
+        void add(Point &acc, typename Curve::PointAffine *bases, const uint32_t *indices, uint64_t n);
+    };
+
+    // Accumulates points into buckets in affine coordinates. Additions to
+    // distinct buckets are queued and every 'batchSize' of them share one
+    // inversion. A point for a bucket that already has a queued addition,
+    // and a point with the x of its bucket, goes to the xyzz bucket instead.
+    template <typename Curve>
+    class BucketSum {
+
+        typedef typename Curve::Point Point;
+        typedef typename Curve::PointAffine PointAffine;
+        typedef typename CurveField<Curve>::Type Field;
+        typedef typename Field::Element Element;
+
+        enum BucketState : uint8_t { Empty, Held, Queued };
+
+        Curve &g;
+        Field &F;
+        MultiExp::MixedAdd<Curve, Field> mixedAdd;
+        uint64_t batchSize;
+
+        std::vector<PointAffine> buckets;
+        std::vector<uint8_t> state;
+        std::vector<uint32_t> queuedBuckets;
+        std::vector<PointAffine> queuedPoints;
+        PairSum<Curve> pairs;
+        Point *xyzzBuckets;
+
+        void addQueued();
+
+    public:
+        static const uint64_t maxBatchSize = 1024;
+
+        BucketSum(Curve &_g, Field &_F, uint64_t nBuckets, uint64_t _batchSize);
+
+        // Starts accumulating on top of the xyzz buckets '_xyzzBuckets'.
+        void start(Point *_xyzzBuckets);
+
+        void add(uint64_t bucket, PointAffine &p, bool negative);
+
+        // Adds the affine buckets to the xyzz buckets.
+        void finish();
+    };
+}
+
+#include "batch_affine.cpp"
+
+#endif // BATCH_AFFINE_HPP
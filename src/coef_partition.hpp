@@ -0,0 +1,87 @@
+#ifndef COEF_PARTITION_HPP
+#define COEF_PARTITION_HPP
+
+#include <cstdint>
+#include <vector>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace Groth16 {
+
+    // Groups the zkey coefficients by destination constraint and splits the
+    // constraints into ranges with about the same number of coefficients.
+    // A thread working on one range owns the corresponding entries of the
+    // a and b vectors, so the accumulation needs no locks.
+    template <typename CoefT>
+    class CoefPartition {
+
+        std::vector<u_int32_t> order;      // coef indices sorted by constraint
+        std::vector<u_int64_t> coefStart;  // first position in 'order' of every partition
+        std::vector<u_int32_t> constraintStart; // first constraint of every partition
+
+    public:
+        bool empty() const { return coefStart.empty(); }
+        u_int64_t size() const { return coefStart.empty() ? 0 : coefStart.size() - 1; }
+
+        u_int64_t coefBegin(u_int64_t p) const { return coefStart[p]; }
+        u_int64_t coefEnd(u_int64_t p) const { return coefStart[p+1]; }
+        u_int32_t constraintBegin(u_int64_t p) const { return constraintStart[p]; }
+        u_int32_t constraintEnd(u_int64_t p) const { return constraintStart[p+1]; }
+        u_int32_t coef(u_int64_t pos) const { return order[pos]; }
+
+        void build(const CoefT *coefs, u_int64_t nCoefs, u_int32_t domainSize, u_int64_t nPartitions)
+        {
+            order.clear();
+            coefStart.clear();
+            constraintStart.clear();
+
+            if (nCoefs > std::numeric_limits<u_int32_t>::max() || domainSize == 0) {
+                return;
+            }
+
+            std::vector<u_int32_t> offsets(domainSize + 1, 0);
+
+            for (u_int64_t i = 0; i < nCoefs; i++) {
+                if (coefs[i].c >= domainSize) {
+                    throw std::range_error("Invalid coef constraint: " + std::to_string(coefs[i].c));
+                }
+                offsets[coefs[i].c + 1]++;
+            }
+
+            for (u_int32_t c = 0; c < domainSize; c++) {
+                offsets[c + 1] += offsets[c];
+            }
+
+            if (nPartitions > domainSize) {
+                nPartitions = domainSize;
+            }
+            if (nPartitions == 0) {
+                nPartitions = 1;
+            }
+
+            const u_int64_t target = (nCoefs + nPartitions - 1) / nPartitions;
+
+            constraintStart.push_back(0);
+            coefStart.push_back(0);
+
+            for (u_int32_t c = 1; c < domainSize; c++) {
+                if (offsets[c] >= target * constraintStart.size()) {
+                    constraintStart.push_back(c);
+                    coefStart.push_back(offsets[c]);
+                }
+            }
+
+            constraintStart.push_back(domainSize);
+            coefStart.push_back(nCoefs);
+
+            order.resize(nCoefs);
+
+            for (u_int64_t i = 0; i < nCoefs; i++) {
+                order[offsets[coefs[i].c]++] = i;
+            }
+        }
+    };
+}
+
+#endif // COEF_PARTITION_HPP
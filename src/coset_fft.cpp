@@ -0,0 +1,456 @@
+#include <gmp.h>
+#include <algorithm>
+#include <stdexcept>
+
+#include "threadpool.hpp"
+
+template <typename Field>
+CosetFFT<Field>::CosetFFT(u_int64_t _domainSize)
+    : f(Field::field)
+    , domainSize(_domainSize)
+    , batch(Field::field)
+{
+    domainPower = 0;
+
+    while ((1ULL << domainPower) < domainSize) {
+        domainPower++;
+    }
+
+    if (domainSize == 0 || (1ULL << domainPower) != domainSize) {
+        throw std::invalid_argument("coset fft domain size must be a power of two");
+    }
+
+    blockPower = std::min<u_int32_t>(domainPower, COSET_FFT_BLOCK_BITS);
+    blockSize  = 1ULL << blockPower;
+    nBlocks    = domainSize >> blockPower;
+
+    tileColumns = std::min<u_int64_t>(blockSize, COSET_FFT_TILE_COLUMNS);
+    nTiles      = blockSize / tileColumns;
+
+    // The 2n-th root of unity as the ffiasm FFT of size 2n takes it: the
+    // smallest quadratic non-residue raised to (q - 1) / 2n.
+    mpz_t q;
+    mpz_t e;
+    mpz_t nqr;
+    mpz_t aux;
+
+    mpz_init(q);
+    mpz_init(e);
+    mpz_init_set_ui(nqr, 2);
+    mpz_init(aux);
+
+    f.toMpz(q, f.negOne());
+    mpz_add_ui(q, q, 1);
+
+    mpz_sub_ui(e, q, 1);
+    mpz_tdiv_q_2exp(e, e, 1);
+    mpz_powm(aux, nqr, e, q);
+
+    while (mpz_cmp_ui(aux, 1) == 0) {
+        mpz_add_ui(nqr, nqr, 1);
+        mpz_powm(aux, nqr, e, q);
+    }
+
+    mpz_sub_ui(e, q, 1);
+    const bool tooBig = mpz_scan1(e, 0) < domainPower + 1;
+    mpz_tdiv_q_2exp(e, e, domainPower + 1);
+    mpz_powm(aux, nqr, e, q);
+
+    uint64_t p[4] = {0, 0, 0, 0};
+    mpz_export(p, nullptr, -1, sizeof(uint64_t), 0, 0, q);
+
+    Element w;
+    f.fromMpz(w, aux);
+
+    mpz_clear(q);
+    mpz_clear(e);
+    mpz_clear(nqr);
+    mpz_clear(aux);
+
+    if (tooBig) {
+        throw std::range_error("Domain size too big for the curve");
+    }
+
+    LazyButterfly::setModulus(modulus, p);
+
+    Element w2;
+    f.mul(w2, w, w);
+
+    twiddles.resize(domainSize >> 1);
+
+    ThreadPool &threadPool = ThreadPool::defaultPool();
+
+    threadPool.parallelFor(0, twiddles.size(), [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        Element x;
+        Element normal;
+
+        power(x, w2, begin);
+
+        for (int64_t k = begin; k < end; k++) {
+            f.fromMontgomery(normal, x);
+            LazyButterfly::setTwiddle(twiddles[k], normal.v, modulus);
+            f.mul(x, x, w2);
+        }
+    });
+
+    Element n;
+    Element nInv;
+
+    f.fromUI(n, domainSize);
+    f.inv(nInv, n);
+
+    blockShift.resize(blockSize);
+    blockFactor.resize(nBlocks);
+
+    threadPool.parallelFor(0, blockSize, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        for (int64_t t = begin; t < end; t++) {
+            power(blockShift[t], w, reverseBits(t, blockPower) * nBlocks);
+            f.mul(blockShift[t], blockShift[t], nInv);
+        }
+    });
+
+    threadPool.parallelFor(0, nBlocks, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        for (int64_t b = begin; b < end; b++) {
+            power(blockFactor[b], w, reverseBits(b, domainPower - blockPower));
+        }
+    });
+}
+
+template <typename Field>
+u_int64_t CosetFFT<Field>::reverseBits(u_int64_t x, u_int32_t bits) {
+    u_int64_t r = 0;
+
+    for (u_int32_t i = 0; i < bits; i++) {
+        r = (r << 1) | ((x >> i) & 1);
+    }
+    return r;
+}
+
+template <typename Field>
+void CosetFFT<Field>::power(Element &r, const Element &base, u_int64_t e) {
+    Element b;
+
+    f.copy(r, f.one());
+    f.copy(b, base);
+
+    for (; e; e >>= 1) {
+        if (e & 1) {
+            f.mul(r, r, b);
+        }
+        f.mul(b, b, b);
+    }
+}
+
+template <typename Field>
+void CosetFFT<Field>::inverseButterfly(Element &x0, Element &x1, u_int64_t k) {
+    if (k == 0) {
+        LazyButterfly::inverse(x0.v, x1.v, twiddles[0], false, modulus);
+    } else {
+        LazyButterfly::inverse(x0.v, x1.v, twiddles[(domainSize >> 1) - k], true, modulus);
+    }
+}
+
+template <typename Field>
+void CosetFFT<Field>::forwardButterfly(Element &x0, Element &x1, u_int64_t k, bool last) {
+    LazyButterfly::forward(x0.v, x1.v, twiddles[k], modulus);
+
+    if (last) {
+        LazyButterfly::reduce(x0.v, modulus);
+        LazyButterfly::reduce(x1.v, modulus);
+    }
+}
+
+// One decimation-in-frequency layer over groups of 'len' elements using the
+// inverse roots, for every vector. Each root is loaded once for the
+// butterflies at its position in all the vectors.
+template <typename Field>
+void CosetFFT<Field>::inverseLayer(ThreadPool &threadPool, Element *const *vectors, u_int32_t nVectors, u_int64_t len) {
+    const u_int64_t half = len >> 1;
+    const u_int64_t step = domainSize / len;
+
+    threadPool.parallelFor(0, domainSize >> 1, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        for (int64_t i = begin; i < end; i++) {
+            const u_int64_t j = i % half;
+            const u_int64_t pos = (i / half) * len + j;
+
+            for (u_int32_t v = 0; v < nVectors; v++) {
+                inverseButterfly(vectors[v][pos], vectors[v][pos + half], j * step);
+            }
+        }
+    });
+}
+
+// One decimation-in-time layer over groups of 'len' elements, for every
+// vector.
+template <typename Field>
+void CosetFFT<Field>::forwardLayer(ThreadPool &threadPool, Element *const *vectors, u_int32_t nVectors, u_int64_t len) {
+    const u_int64_t half = len >> 1;
+    const u_int64_t step = domainSize / len;
+    const bool last = len == domainSize;
+
+    threadPool.parallelFor(0, domainSize >> 1, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        for (int64_t i = begin; i < end; i++) {
+            const u_int64_t j = i % half;
+            const u_int64_t pos = (i / half) * len + j;
+
+            for (u_int32_t v = 0; v < nVectors; v++) {
+                forwardButterfly(vectors[v][pos], vectors[v][pos + half], j * step, last);
+            }
+        }
+    });
+}
+
+// Copies the columns [column, column + tileColumns) of every row of 'a' to
+// 'tile', row after row, and back. The rows of the domain are a power of two
+// apart, so a tile left in place falls into a few cache sets.
+template <typename Field>
+void CosetFFT<Field>::loadTile(Element *tile, const Element *a, u_int64_t column) {
+    for (u_int64_t row = 0; row < nBlocks; row++) {
+        const Element *x = a + row * blockSize + column;
+
+        std::copy(x, x + tileColumns, tile + row * tileColumns);
+    }
+}
+
+template <typename Field>
+void CosetFFT<Field>::storeTile(Element *a, const Element *tile, u_int64_t column) {
+    for (u_int64_t row = 0; row < nBlocks; row++) {
+        const Element *x = tile + row * tileColumns;
+
+        std::copy(x, x + tileColumns, a + row * blockSize + column);
+    }
+}
+
+// The inverse layers that span blocks, over a tile of the columns [column,
+// column + tileColumns) loaded by loadTile(). Their butterflies only pair
+// elements of the same column, so a tile goes through all of them on its
+// own. A layer over groups of 'rows' rows pairs rows r and r + rows/2. Two
+// layers at a time are fused into radix-4 butterflies over rows r, r + q,
+// r + 2q and r + 3q, doing the same operations as the two radix-2 layers.
+template <typename Field>
+void CosetFFT<Field>::inverseTile(Element *tile, u_int64_t column) {
+    u_int64_t rows = nBlocks;
+
+    while (rows >= 4) {
+        const u_int64_t q = rows >> 2;
+        const u_int64_t stride = q * tileColumns;
+        const u_int64_t step = domainSize / (rows * blockSize);
+
+        for (u_int64_t k = 0; k < nBlocks; k += rows) {
+            for (u_int64_t row = 0; row < q; row++) {
+                for (u_int64_t c = 0; c < tileColumns; c++) {
+                    const u_int64_t j = row * blockSize + column + c;
+                    Element *x = tile + (k + row) * tileColumns + c;
+
+                    inverseButterfly(x[0], x[2*stride], j * step);
+                    inverseButterfly(x[stride], x[3*stride], (j + q * blockSize) * step);
+                    inverseButterfly(x[0], x[stride], 2 * j * step);
+                    inverseButterfly(x[2*stride], x[3*stride], 2 * j * step);
+                }
+            }
+        }
+        rows >>= 2;
+    }
+
+    if (rows == 2) {
+        const u_int64_t step = domainSize / (rows * blockSize);
+
+        for (u_int64_t k = 0; k < nBlocks; k += rows) {
+            for (u_int64_t c = 0; c < tileColumns; c++) {
+                Element *x = tile + k * tileColumns + c;
+
+                inverseButterfly(x[0], x[tileColumns], (column + c) * step);
+            }
+        }
+    }
+}
+
+// The forward layers that span blocks over one tile of columns, as
+// inverseTile.
+template <typename Field>
+void CosetFFT<Field>::forwardTile(Element *tile, u_int64_t column) {
+    u_int64_t rows = 2;
+
+    while (rows << 1 <= nBlocks) {
+        const u_int64_t q = rows >> 1;
+        const u_int64_t stride = q * tileColumns;
+        const u_int64_t step = domainSize / ((rows << 1) * blockSize);
+        const bool last = rows << 1 == nBlocks;
+
+        for (u_int64_t k = 0; k < nBlocks; k += rows << 1) {
+            for (u_int64_t row = 0; row < q; row++) {
+                for (u_int64_t c = 0; c < tileColumns; c++) {
+                    const u_int64_t j = row * blockSize + column + c;
+                    Element *x = tile + (k + row) * tileColumns + c;
+
+                    forwardButterfly(x[0], x[stride], 2 * j * step, false);
+                    forwardButterfly(x[2*stride], x[3*stride], 2 * j * step, false);
+                    forwardButterfly(x[0], x[2*stride], j * step, last);
+                    forwardButterfly(x[stride], x[3*stride], (j + q * blockSize) * step, last);
+                }
+            }
+        }
+        rows <<= 2;
+    }
+
+    if (rows <= nBlocks) {
+        const u_int64_t half = rows >> 1;
+        const u_int64_t stride = half * tileColumns;
+        const u_int64_t step = domainSize / (rows * blockSize);
+        const bool last = rows == nBlocks;
+
+        for (u_int64_t k = 0; k < nBlocks; k += rows) {
+            for (u_int64_t row = 0; row < half; row++) {
+                for (u_int64_t c = 0; c < tileColumns; c++) {
+                    const u_int64_t j = row * blockSize + column + c;
+                    Element *x = tile + (k + row) * tileColumns + c;
+
+                    forwardButterfly(x[0], x[stride], j * step, last);
+                }
+            }
+        }
+    }
+}
+
+// Runs the inverse layers that stay inside the block, the coset shift and the
+// forward layers that stay inside the block, while the block is in cache.
+template <typename Field>
+void CosetFFT<Field>::processBlock(Element *a, u_int64_t block) {
+    Element *x = a + block * blockSize;
+
+    for (u_int64_t len = blockSize; len > 2; len >>= 1) {
+        const u_int64_t half = len >> 1;
+        const u_int64_t step = domainSize / len;
+
+        for (u_int64_t k = 0; k < blockSize; k += len) {
+            for (u_int64_t j = 0; j < half; j++) {
+                inverseButterfly(x[k + j], x[k + j + half], j * step);
+            }
+        }
+    }
+
+    // The element at position block*blockSize + t holds the coefficient of
+    // degree rev(t)*nBlocks + rev(block), so its shift is w^rev(block) times
+    // the precomputed per-position factor. The shift multiplies reduced
+    // values, which ends the inverse transform.
+    const Element &factor = blockFactor[block];
+
+    if (blockSize == 1) {
+        LazyButterfly::reduce(x[0].v, modulus);
+    }
+
+    for (u_int64_t k = 0; k + 1 < blockSize; k += 2) {
+        Element &x0 = x[k];
+        Element &x1 = x[k + 1];
+        uint64_t d[4];
+
+        LazyButterfly::add(d, x0.v, modulus.p2);
+        LazyButterfly::sub(d, d, x1.v);
+        LazyButterfly::add(x0.v, x0.v, x1.v);
+        LazyButterfly::reduce(x0.v, modulus);
+        LazyButterfly::reduce(d, modulus);
+        std::copy(d, d + 4, x1.v);
+    }
+
+    batch.mul(x, x, blockShift.data(), blockSize);
+    batch.mulBy(x, x, factor, blockSize);
+
+    for (u_int64_t len = 2; len <= blockSize; len <<= 1) {
+        const u_int64_t half = len >> 1;
+        const u_int64_t step = domainSize / len;
+        const bool last = len == domainSize;
+
+        for (u_int64_t k = 0; k < blockSize; k += len) {
+            for (u_int64_t j = 0; j < half; j++) {
+                forwardButterfly(x[k + j], x[k + j + half], j * step, last);
+            }
+        }
+    }
+}
+
+template <typename Field>
+void CosetFFT<Field>::extend(Element *a, ThreadPool &threadPool) {
+    extend(&a, 1, threadPool);
+}
+
+// The vectors share every layer: one pass and one barrier per layer across
+// the domain, and one pass over the blocks of all of them. A block is
+// finished in one vector before the next, so only one block needs to stay
+// in cache.
+template <typename Field>
+void CosetFFT<Field>::extend(Element *const *vectors, u_int32_t nVectors, ThreadPool &threadPool) {
+
+    // The tiles are independent, so the layers that span blocks need no
+    // barrier between them.
+    const bool tiled = nBlocks > 1 && domainPower >= COSET_FFT_TILED_BITS;
+
+    if (tiled) {
+        threadPool.parallelFor(0, nTiles * nVectors, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+            std::vector<Element> tile(nBlocks * tileColumns);
+
+            for (int64_t i = begin; i < end; i++) {
+                Element *a = vectors[i / nTiles];
+                const u_int64_t column = (i % nTiles) * tileColumns;
+
+                loadTile(tile.data(), a, column);
+                inverseTile(tile.data(), column);
+                storeTile(a, tile.data(), column);
+            }
+        });
+    } else {
+        for (u_int64_t len = domainSize; len > blockSize; len >>= 1) {
+            inverseLayer(threadPool, vectors, nVectors, len);
+        }
+    }
+
+    threadPool.parallelFor(0, nBlocks * nVectors, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        for (int64_t i = begin; i < end; i++) {
+            processBlock(vectors[i / nBlocks], i % nBlocks);
+        }
+    });
+
+    if (tiled) {
+        threadPool.parallelFor(0, nTiles * nVectors, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+            std::vector<Element> tile(nBlocks * tileColumns);
+
+            for (int64_t i = begin; i < end; i++) {
+                Element *a = vectors[i / nTiles];
+                const u_int64_t column = (i % nTiles) * tileColumns;
+
+                loadTile(tile.data(), a, column);
+                forwardTile(tile.data(), column);
+                storeTile(a, tile.data(), column);
+            }
+        });
+    } else {
+        for (u_int64_t len = blockSize << 1; len <= domainSize; len <<= 1) {
+            forwardLayer(threadPool, vectors, nVectors, len);
+        }
+    }
+}
+
+template <typename Field>
+std::mutex CosetFFTCache<Field>::mutex;
+
+template <typename Field>
+std::map<u_int32_t, std::weak_ptr<CosetFFT<Field>>> CosetFFTCache<Field>::entries;
+
+template <typename Field>
+std::shared_ptr<CosetFFT<Field>> CosetFFTCache<Field>::get(u_int64_t domainSize) {
+    u_int32_t domainPower = 0;
+
+    while ((1ULL << domainPower) < domainSize) {
+        domainPower++;
+    }
+
+    std::lock_guard<std::mutex> guard(mutex);
+
+    std::shared_ptr<CosetFFT<Field>> cosetFft = entries[domainPower].lock();
+
+    if (!cosetFft) {
+        cosetFft = std::make_shared<CosetFFT<Field>>(domainSize);
+        entries[domainPower] = cosetFft;
+    }
+
+    return cosetFft;
+}
@@ -0,0 +1,120 @@
+#ifndef COSET_FFT_HPP
+#define COSET_FFT_HPP
+
+#include <sys/types.h>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "lazy_butterfly.hpp"
+#include "threadpool.hpp"
+#include "montgomery.hpp"
+#include "field_batch.hpp"
+
+#ifndef COSET_FFT_BLOCK_BITS
+#define COSET_FFT_BLOCK_BITS 12
+#endif
+
+// Domains of at least 2^COSET_FFT_TILED_BITS elements run the layers that
+// span blocks tile by tile, a tile being COSET_FFT_TILE_COLUMNS adjacent
+// columns of the domain seen as rows of one block each.
+#ifndef COSET_FFT_TILED_BITS
+#define COSET_FFT_TILED_BITS 20
+#endif
+
+#ifndef COSET_FFT_TILE_COLUMNS
+#define COSET_FFT_TILE_COLUMNS 8
+#endif
+
+// Low-degree extension of a vector of evaluations over the domain of size n
+// to the coset w*H, where w is the 2n-th root of unity of the ffiasm FFT
+// tables. It computes the same as fft.ifft(a), a[i] *= w^i, fft.fft(a) but
+// pairs a decimation-in-frequency inverse transform (natural order in,
+// bit-reversed out) with a decimation-in-time forward transform
+// (bit-reversed in, natural order out), so no bit-reversal permutation is
+// needed. The 1/n scaling and the coset shift are folded into the last
+// inverse butterfly layer, and all the layers that fit in a block of
+// 2^COSET_FFT_BLOCK_BITS elements are done in one cache-resident pass. On
+// large domains the other layers work on tiles of columns, copied out to a
+// buffer of their own so that they stay in cache through all of them, two
+// layers per radix-4 step, instead of streaming the domain once per layer.
+//
+// The butterflies are LazyButterfly kernels on Shoup twiddles, so Field must
+// be a 4-limb Montgomery field (Element::v) with a modulus below 2^254. The
+// values are only reduced to [0, p) after the coset shift and in the last
+// layer.
+template <typename Field>
+class CosetFFT {
+
+    typedef typename Field::Element Element;
+
+    Field &f;
+
+    u_int32_t domainPower;
+    u_int64_t domainSize;
+    u_int32_t blockPower;
+    u_int64_t blockSize;
+    u_int64_t nBlocks;
+    u_int64_t tileColumns;
+    u_int64_t nTiles;
+
+    LazyButterfly::Modulus modulus;
+    FieldBatch::Batch<Field> batch;
+
+    // w^(2k) for k < n/2, the roots of the n-th root of unity. The inverse
+    // roots w^(-2k) = -w^(n-2k) take the same entries.
+    std::vector<LazyButterfly::Twiddle> twiddles;
+
+    // w^(rev(t)*nBlocks) / n for every position t inside a block, and
+    // w^rev(b) for every block b.
+    std::vector<Element> blockShift;
+    std::vector<Element> blockFactor;
+
+    static u_int64_t reverseBits(u_int64_t x, u_int32_t bits);
+
+    void power(Element &r, const Element &base, u_int64_t e);
+
+    void inverseLayer(ThreadPool &threadPool, Element *const *vectors, u_int32_t nVectors, u_int64_t len);
+    void forwardLayer(ThreadPool &threadPool, Element *const *vectors, u_int32_t nVectors, u_int64_t len);
+    void processBlock(Element *a, u_int64_t block);
+
+    // Butterflies with the inverse root w^(-2k) and the root w^(2k) of the
+    // n-th root of unity, for k < n/2. The last forward layer also reduces
+    // its outputs to [0, p).
+    void inverseButterfly(Element &x0, Element &x1, u_int64_t k);
+    void forwardButterfly(Element &x0, Element &x1, u_int64_t k, bool last);
+    void loadTile(Element *tile, const Element *a, u_int64_t column);
+    void storeTile(Element *a, const Element *tile, u_int64_t column);
+    void inverseTile(Element *tile, u_int64_t column);
+    void forwardTile(Element *tile, u_int64_t column);
+
+public:
+    explicit CosetFFT(u_int64_t _domainSize);
+
+    CosetFFT(const CosetFFT&) = delete;
+    CosetFFT& operator=(const CosetFFT&) = delete;
+
+    void extend(Element *a, ThreadPool &threadPool = ThreadPool::defaultPool());
+
+    // Extends 'nVectors' vectors of the domain size at once.
+    void extend(Element *const *vectors, u_int32_t nVectors, ThreadPool &threadPool = ThreadPool::defaultPool());
+};
+
+// Process-wide cache of the coset FFT tables, keyed by the domain power. All
+// the provers of a domain size share one instance, built on its first use
+// and freed with its last user.
+template <typename Field>
+class CosetFFTCache {
+
+    static std::mutex mutex;
+    static std::map<u_int32_t, std::weak_ptr<CosetFFT<Field>>> entries;
+
+public:
+    static std::shared_ptr<CosetFFT<Field>> get(u_int64_t domainSize);
+};
+
+#include "coset_fft.cpp"
+
+#endif // COSET_FFT_HPP
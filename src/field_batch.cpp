@@ -0,0 +1,514 @@
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#include "field_batch.hpp"
+
+namespace FieldBatch {
+
+#if defined(__x86_64__)
+
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_IFMA __attribute__((target("avx512f,avx512ifma")))
+
+// AVX2: four elements per step, limb j of every element in one register.
+
+// Transposes four elements of 4 limbs. Its own inverse.
+TARGET_AVX2 static inline void Transpose4(__m256i x[4])
+{
+    const __m256i t0 = _mm256_unpacklo_epi64(x[0], x[1]);
+    const __m256i t1 = _mm256_unpackhi_epi64(x[0], x[1]);
+    const __m256i t2 = _mm256_unpacklo_epi64(x[2], x[3]);
+    const __m256i t3 = _mm256_unpackhi_epi64(x[2], x[3]);
+
+    x[0] = _mm256_permute2x128_si256(t0, t2, 0x20);
+    x[1] = _mm256_permute2x128_si256(t1, t3, 0x20);
+    x[2] = _mm256_permute2x128_si256(t0, t2, 0x31);
+    x[3] = _mm256_permute2x128_si256(t1, t3, 0x31);
+}
+
+TARGET_AVX2 static inline void Load4(__m256i x[4], const uint64_t *a)
+{
+    for (int j = 0; j < 4; j++) {
+        x[j] = _mm256_loadu_si256((const __m256i *)(a + 4 * j));
+    }
+    Transpose4(x);
+}
+
+TARGET_AVX2 static inline void Store4(uint64_t *r, __m256i x[4])
+{
+    Transpose4(x);
+    for (int j = 0; j < 4; j++) {
+        _mm256_storeu_si256((__m256i *)(r + 4 * j), x[j]);
+    }
+}
+
+// All ones in the lanes where a < b, unsigned.
+TARGET_AVX2 static inline __m256i LessThan4(__m256i a, __m256i b)
+{
+    const __m256i sign = _mm256_set1_epi64x(0x8000000000000000ULL);
+
+    return _mm256_cmpgt_epi64(_mm256_xor_si256(b, sign), _mm256_xor_si256(a, sign));
+}
+
+// r = a - b - borrow, with the borrows as all-ones lanes.
+TARGET_AVX2 static inline __m256i Sub4(__m256i x[4], const __m256i a[4], const __m256i b[4])
+{
+    __m256i borrow = _mm256_setzero_si256();
+
+    for (int j = 0; j < 4; j++) {
+        const __m256i d = _mm256_sub_epi64(a[j], b[j]);
+        const __m256i out = _mm256_or_si256(
+            LessThan4(a[j], b[j]),
+            _mm256_and_si256(borrow, _mm256_cmpeq_epi64(d, _mm256_setzero_si256())));
+
+        x[j] = _mm256_add_epi64(d, borrow);
+        borrow = out;
+    }
+    return borrow;
+}
+
+// r = a + b + carry, no carry out since a, b < 2^255.
+TARGET_AVX2 static inline void Add4(__m256i x[4], const __m256i a[4], const __m256i b[4])
+{
+    __m256i carry = _mm256_setzero_si256();
+
+    for (int j = 0; j < 4; j++) {
+        const __m256i s = _mm256_add_epi64(a[j], b[j]);
+        const __m256i out = _mm256_or_si256(
+            LessThan4(s, a[j]),
+            _mm256_and_si256(carry, _mm256_cmpeq_epi64(s, _mm256_set1_epi64x(-1))));
+
+        x[j] = _mm256_sub_epi64(s, carry);
+        carry = out;
+    }
+}
+
+TARGET_AVX2 static void AddAvx2(uint64_t *r, const uint64_t *a, const uint64_t *b, uint64_t n, const Montgomery::Modulus &m)
+{
+    __m256i p[4];
+
+    for (int j = 0; j < 4; j++) {
+        p[j] = _mm256_set1_epi64x(m.p[j]);
+    }
+
+    for (uint64_t i = 0; i < n; i += 4) {
+        __m256i x[4], y[4], s[4], d[4];
+
+        Load4(x, a + 4 * i);
+        Load4(y, b + 4 * i);
+        Add4(s, x, y);
+
+        // s - p unless it borrows.
+        const __m256i borrow = Sub4(d, s, p);
+
+        for (int j = 0; j < 4; j++) {
+            s[j] = _mm256_blendv_epi8(d[j], s[j], borrow);
+        }
+        Store4(r + 4 * i, s);
+    }
+}
+
+TARGET_AVX2 static void SubAvx2(uint64_t *r, const uint64_t *a, const uint64_t *b, uint64_t n, const Montgomery::Modulus &m)
+{
+    __m256i p[4];
+
+    for (int j = 0; j < 4; j++) {
+        p[j] = _mm256_set1_epi64x(m.p[j]);
+    }
+
+    for (uint64_t i = 0; i < n; i += 4) {
+        __m256i x[4], y[4], d[4], s[4], q[4];
+
+        Load4(x, a + 4 * i);
+        Load4(y, b + 4 * i);
+
+        // d + p where a - b borrows.
+        const __m256i borrow = Sub4(d, x, y);
+
+        for (int j = 0; j < 4; j++) {
+            q[j] = _mm256_and_si256(p[j], borrow);
+        }
+        Add4(s, d, q);
+        Store4(r + 4 * i, s);
+    }
+}
+
+// AVX-512: eight elements per step.
+
+// Transposes eight elements of 4 limbs, two per register, to one limb per
+// register, and back.
+TARGET_IFMA static inline void Load8(__m512i x[4], const uint64_t *a)
+{
+    const __m512i lo = _mm512_set_epi64(13, 9, 5, 1, 12, 8, 4, 0);
+    const __m512i hi = _mm512_set_epi64(15, 11, 7, 3, 14, 10, 6, 2);
+    const __m512i first = _mm512_set_epi64(11, 10, 9, 8, 3, 2, 1, 0);
+    const __m512i second = _mm512_set_epi64(15, 14, 13, 12, 7, 6, 5, 4);
+    __m512i z[4];
+
+    for (int j = 0; j < 4; j++) {
+        z[j] = _mm512_loadu_si512((const void *)(a + 8 * j));
+    }
+
+    // Limbs 0 and 1, and 2 and 3, of elements 0-3 and 4-7.
+    const __m512i u0 = _mm512_permutex2var_epi64(z[0], lo, z[1]);
+    const __m512i u1 = _mm512_permutex2var_epi64(z[0], hi, z[1]);
+    const __m512i u2 = _mm512_permutex2var_epi64(z[2], lo, z[3]);
+    const __m512i u3 = _mm512_permutex2var_epi64(z[2], hi, z[3]);
+
+    x[0] = _mm512_permutex2var_epi64(u0, first, u2);
+    x[1] = _mm512_permutex2var_epi64(u0, second, u2);
+    x[2] = _mm512_permutex2var_epi64(u1, first, u3);
+    x[3] = _mm512_permutex2var_epi64(u1, second, u3);
+}
+
+TARGET_IFMA static inline void Store8(uint64_t *r, const __m512i x[4])
+{
+    const __m512i lo = _mm512_set_epi64(13, 9, 5, 1, 12, 8, 4, 0);
+    const __m512i hi = _mm512_set_epi64(15, 11, 7, 3, 14, 10, 6, 2);
+    const __m512i first = _mm512_set_epi64(11, 10, 9, 8, 3, 2, 1, 0);
+    const __m512i second = _mm512_set_epi64(15, 14, 13, 12, 7, 6, 5, 4);
+
+    const __m512i u0 = _mm512_permutex2var_epi64(x[0], first, x[1]);
+    const __m512i u2 = _mm512_permutex2var_epi64(x[0], second, x[1]);
+    const __m512i u1 = _mm512_permutex2var_epi64(x[2], first, x[3]);
+    const __m512i u3 = _mm512_permutex2var_epi64(x[2], second, x[3]);
+
+    _mm512_storeu_si512((void *)(r + 0), _mm512_permutex2var_epi64(u0, lo, u1));
+    _mm512_storeu_si512((void *)(r + 8), _mm512_permutex2var_epi64(u0, hi, u1));
+    _mm512_storeu_si512((void *)(r + 16), _mm512_permutex2var_epi64(u2, lo, u3));
+    _mm512_storeu_si512((void *)(r + 24), _mm512_permutex2var_epi64(u2, hi, u3));
+}
+
+// r = a - b with the borrow of the lanes in the mask.
+TARGET_IFMA static inline __mmask8 Sub8(__m512i x[4], const __m512i a[4], const __m512i b[4])
+{
+    const __m512i one = _mm512_set1_epi64(1);
+    __mmask8 borrow = 0;
+
+    for (int j = 0; j < 4; j++) {
+        const __m512i d = _mm512_sub_epi64(a[j], b[j]);
+        const __mmask8 out = _mm512_cmplt_epu64_mask(a[j], b[j]) |
+                             _mm512_mask_cmpeq_epu64_mask(borrow, d, _mm512_setzero_si512());
+
+        x[j] = _mm512_mask_sub_epi64(d, borrow, d, one);
+        borrow = out;
+    }
+    return borrow;
+}
+
+// r = a + b, no carry out since a, b < 2^255.
+TARGET_IFMA static inline void Add8(__m512i x[4], const __m512i a[4], const __m512i b[4])
+{
+    const __m512i one = _mm512_set1_epi64(1);
+    __mmask8 carry = 0;
+
+    for (int j = 0; j < 4; j++) {
+        const __m512i s = _mm512_add_epi64(a[j], b[j]);
+        const __mmask8 out = _mm512_cmplt_epu64_mask(s, a[j]) |
+                             _mm512_mask_cmpeq_epu64_mask(carry, s, _mm512_set1_epi64(-1));
+
+        x[j] = _mm512_mask_add_epi64(s, carry, s, one);
+        carry = out;
+    }
+}
+
+TARGET_IFMA static void AddAvx512(uint64_t *r, const uint64_t *a, const uint64_t *b, uint64_t n, const Montgomery::Modulus &m)
+{
+    __m512i p[4];
+
+    for (int j = 0; j < 4; j++) {
+        p[j] = _mm512_set1_epi64(m.p[j]);
+    }
+
+    for (uint64_t i = 0; i < n; i += 8) {
+        __m512i x[4], y[4], s[4], d[4];
+
+        Load8(x, a + 4 * i);
+        Load8(y, b + 4 * i);
+        Add8(s, x, y);
+
+        const __mmask8 borrow = Sub8(d, s, p);
+
+        for (int j = 0; j < 4; j++) {
+            s[j] = _mm512_mask_blend_epi64(borrow, d[j], s[j]);
+        }
+        Store8(r + 4 * i, s);
+    }
+}
+
+TARGET_IFMA static void SubAvx512(uint64_t *r, const uint64_t *a, const uint64_t *b, uint64_t n, const Montgomery::Modulus &m)
+{
+    __m512i p[4];
+
+    for (int j = 0; j < 4; j++) {
+        p[j] = _mm512_set1_epi64(m.p[j]);
+    }
+
+    for (uint64_t i = 0; i < n; i += 8) {
+        __m512i x[4], y[4], d[4], s[4], q[4];
+
+        Load8(x, a + 4 * i);
+        Load8(y, b + 4 * i);
+
+        const __mmask8 borrow = Sub8(d, x, y);
+
+        for (int j = 0; j < 4; j++) {
+            q[j] = _mm512_maskz_mov_epi64(borrow, p[j]);
+        }
+        Add8(s, d, q);
+        Store8(r + 4 * i, s);
+    }
+}
+
+// IFMA products run on five 52-bit limbs, a Montgomery multiplication
+// modulo 2^260. With b taken as b * 2^4, which still fits the five limbs
+// since b < 2^254, the product is a * b / 2^256 like the scalar kernels,
+// and a * b * 2^4 / 2^260 + p < 2p leaves one conditional subtraction.
+
+static const uint64_t mask52 = (1ULL << 52) - 1;
+
+TARGET_IFMA static inline void To52(__m512i l[5], const __m512i x[4])
+{
+    const __m512i mask = _mm512_set1_epi64(mask52);
+
+    l[0] = _mm512_and_si512(x[0], mask);
+    l[1] = _mm512_and_si512(_mm512_or_si512(_mm512_srli_epi64(x[0], 52), _mm512_slli_epi64(x[1], 12)), mask);
+    l[2] = _mm512_and_si512(_mm512_or_si512(_mm512_srli_epi64(x[1], 40), _mm512_slli_epi64(x[2], 24)), mask);
+    l[3] = _mm512_and_si512(_mm512_or_si512(_mm512_srli_epi64(x[2], 28), _mm512_slli_epi64(x[3], 36)), mask);
+    l[4] = _mm512_srli_epi64(x[3], 16);
+}
+
+// Limbs of x * 2^4.
+TARGET_IFMA static inline void To52Shifted(__m512i l[5], const __m512i x[4])
+{
+    const __m512i mask = _mm512_set1_epi64(mask52);
+
+    l[0] = _mm512_and_si512(_mm512_slli_epi64(x[0], 4), mask);
+    l[1] = _mm512_and_si512(_mm512_or_si512(_mm512_srli_epi64(x[0], 48), _mm512_slli_epi64(x[1], 16)), mask);
+    l[2] = _mm512_and_si512(_mm512_or_si512(_mm512_srli_epi64(x[1], 36), _mm512_slli_epi64(x[2], 28)), mask);
+    l[3] = _mm512_and_si512(_mm512_or_si512(_mm512_srli_epi64(x[2], 24), _mm512_slli_epi64(x[3], 40)), mask);
+    l[4] = _mm512_srli_epi64(x[3], 12);
+}
+
+TARGET_IFMA static inline void From52(__m512i x[4], const __m512i l[5])
+{
+    x[0] = _mm512_or_si512(l[0], _mm512_slli_epi64(l[1], 52));
+    x[1] = _mm512_or_si512(_mm512_srli_epi64(l[1], 12), _mm512_slli_epi64(l[2], 40));
+    x[2] = _mm512_or_si512(_mm512_srli_epi64(l[2], 24), _mm512_slli_epi64(l[3], 28));
+    x[3] = _mm512_or_si512(_mm512_srli_epi64(l[3], 36), _mm512_slli_epi64(l[4], 16));
+}
+
+struct Modulus52 {
+    __m512i p[5];
+    __m512i np;
+};
+
+TARGET_IFMA static inline void SetModulus52(Modulus52 &m52, const Montgomery::Modulus &m)
+{
+    const uint64_t p[5] = {
+        m.p[0] & mask52,
+        ((m.p[0] >> 52) | (m.p[1] << 12)) & mask52,
+        ((m.p[1] >> 40) | (m.p[2] << 24)) & mask52,
+        ((m.p[2] >> 28) | (m.p[3] << 36)) & mask52,
+        m.p[3] >> 16
+    };
+
+    for (int j = 0; j < 5; j++) {
+        m52.p[j] = _mm512_set1_epi64(p[j]);
+    }
+    m52.np = _mm512_set1_epi64(m.np & mask52);
+}
+
+// Operand scanning: t += a * b[i], then t += m * p with m = t[0] * np mod
+// 2^52 and t shifts down a limb. The limbs take up to four 52-bit terms a
+// round in their 64 bits and are only normalized at the end.
+TARGET_IFMA static inline void Mul52(__m512i r[5], const __m512i a[5], const __m512i b[5], const Modulus52 &m)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i mask = _mm512_set1_epi64(mask52);
+    __m512i t[6] = {zero, zero, zero, zero, zero, zero};
+
+    for (int i = 0; i < 5; i++) {
+        for (int j = 0; j < 5; j++) {
+            t[j] = _mm512_madd52lo_epu64(t[j], a[j], b[i]);
+            t[j + 1] = _mm512_madd52hi_epu64(t[j + 1], a[j], b[i]);
+        }
+
+        const __m512i q = _mm512_madd52lo_epu64(zero, t[0], m.np);
+
+        for (int j = 0; j < 5; j++) {
+            t[j] = _mm512_madd52lo_epu64(t[j], m.p[j], q);
+            t[j + 1] = _mm512_madd52hi_epu64(t[j + 1], m.p[j], q);
+        }
+
+        t[1] = _mm512_add_epi64(t[1], _mm512_srli_epi64(t[0], 52));
+        for (int j = 0; j < 5; j++) {
+            t[j] = t[j + 1];
+        }
+        t[5] = zero;
+    }
+
+    for (int j = 0; j < 4; j++) {
+        t[j + 1] = _mm512_add_epi64(t[j + 1], _mm512_srli_epi64(t[j], 52));
+        t[j] = _mm512_and_si512(t[j], mask);
+    }
+
+    // t - p, kept where it does not go negative.
+    __m512i d[5];
+    __m512i borrow = zero;
+
+    for (int j = 0; j < 5; j++) {
+        d[j] = _mm512_add_epi64(_mm512_sub_epi64(t[j], m.p[j]), borrow);
+        borrow = _mm512_srai_epi64(d[j], 52);
+        d[j] = _mm512_and_si512(d[j], mask);
+    }
+
+    const __mmask8 negative = _mm512_cmplt_epi64_mask(borrow, zero);
+
+    for (int j = 0; j < 5; j++) {
+        r[j] = _mm512_mask_blend_epi64(negative, d[j], t[j]);
+    }
+}
+
+TARGET_IFMA static void MulIfma(uint64_t *r, const uint64_t *a, const uint64_t *b, uint64_t n, const Montgomery::Modulus &m)
+{
+    Modulus52 m52;
+    SetModulus52(m52, m);
+
+    for (uint64_t i = 0; i < n; i += 8) {
+        __m512i x[4], y[4];
+        __m512i xl[5], yl[5], rl[5];
+
+        Load8(x, a + 4 * i);
+        Load8(y, b + 4 * i);
+        To52(xl, x);
+        To52Shifted(yl, y);
+        Mul52(rl, xl, yl, m52);
+        From52(x, rl);
+        Store8(r + 4 * i, x);
+    }
+}
+
+TARGET_IFMA static void MulByIfma(uint64_t *r, const uint64_t *a, const uint64_t *b, uint64_t n, const Montgomery::Modulus &m)
+{
+    Modulus52 m52;
+    SetModulus52(m52, m);
+
+    __m512i y[4];
+    __m512i yl[5];
+
+    for (int j = 0; j < 4; j++) {
+        y[j] = _mm512_set1_epi64(b[j]);
+    }
+    To52Shifted(yl, y);
+
+    for (uint64_t i = 0; i < n; i += 8) {
+        __m512i x[4];
+        __m512i xl[5], rl[5];
+
+        Load8(x, a + 4 * i);
+        To52(xl, x);
+        Mul52(rl, xl, yl, m52);
+        From52(x, rl);
+        Store8(r + 4 * i, x);
+    }
+}
+
+static uint64_t ReadXcr0()
+{
+    uint32_t eax, edx;
+
+    __asm__ ("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+    return ((uint64_t)edx << 32) | eax;
+}
+
+static Isa DetectIsa()
+{
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return Scalar;
+    }
+
+    const unsigned int osxsave = 1u << 27;
+
+    if (!(ecx & osxsave)) {
+        return Scalar;
+    }
+
+    // The OS saves the ymm state, and the opmask and zmm state.
+    const uint64_t xcr0 = ReadXcr0();
+    const bool ymmState = (xcr0 & 0x6) == 0x6;
+    const bool zmmState = (xcr0 & 0xe6) == 0xe6;
+
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return Scalar;
+    }
+
+    const unsigned int avx2 = 1u << 5;
+    const unsigned int avx512f = 1u << 16;
+    const unsigned int avx512ifma = 1u << 21;
+
+    if (zmmState && (ebx & avx512f) && (ebx & avx512ifma)) {
+        return Avx512Ifma;
+    }
+    if (ymmState && (ebx & avx2)) {
+        return Avx2;
+    }
+    return Scalar;
+}
+
+Isa bestIsa()
+{
+    static const Isa isa = DetectIsa();
+
+    return isa;
+}
+
+static const Kernels scalarKernels = {0, nullptr, nullptr, 0, nullptr, nullptr};
+static const Kernels avx2Kernels = {0, nullptr, nullptr, 4, AddAvx2, SubAvx2};
+static const Kernels ifmaKernels = {8, MulIfma, MulByIfma, 8, AddAvx512, SubAvx512};
+
+const Kernels &kernels(Isa isa)
+{
+    switch (isa) {
+    case Avx512Ifma:
+        return ifmaKernels;
+    case Avx2:
+        return avx2Kernels;
+    default:
+        return scalarKernels;
+    }
+}
+
+#else
+
+Isa bestIsa()
+{
+    return Scalar;
+}
+
+static const Kernels scalarKernels = {0, nullptr, nullptr, 0, nullptr, nullptr};
+
+const Kernels &kernels(Isa isa)
+{
+    return scalarKernels;
+}
+
+#endif
+
+const char *isaName(Isa isa)
+{
+    switch (isa) {
+    case Avx512Ifma:
+        return "avx512ifma";
+    case Avx2:
+        return "avx2";
+    default:
+        return "scalar";
+    }
+}
+
+} // Namespace
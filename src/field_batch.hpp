@@ -0,0 +1,227 @@
+#ifndef FIELD_BATCH_HPP
+#define FIELD_BATCH_HPP
+
+#include <cstdint>
+
+#include "montgomery.hpp"
+
+// Element-wise arithmetic over arrays of a 4-limb Montgomery field with a
+// modulus below 2^254, several elements per instruction. With AVX-512 IFMA
+// eight products run side by side on 52-bit limbs; AVX2 has no 64-bit
+// multiplier, so there only additions and subtractions are vectorized and
+// products go through the MULX kernel of Montgomery::FieldMul. The kernels
+// are compiled for their instruction set alone and picked at run time.
+namespace FieldBatch {
+
+    enum Isa {
+        Scalar,
+        Avx2,
+        Avx512Ifma
+    };
+
+    // The widest instruction set the CPU and the OS support. Read once.
+    Isa bestIsa();
+
+    const char *isaName(Isa isa);
+
+    // Kernels over arrays of n elements of 4 limbs each, n a multiple of
+    // the lane count of the kernel. 'r' may be one of the inputs but must
+    // not overlap them otherwise. mulBy multiplies every element by b[0].
+    // Null where the instruction set has no kernel.
+    struct Kernels {
+        uint64_t mulLanes;
+        void (*mul)(uint64_t *r, const uint64_t *a, const uint64_t *b, uint64_t n, const Montgomery::Modulus &m);
+        void (*mulBy)(uint64_t *r, const uint64_t *a, const uint64_t *b, uint64_t n, const Montgomery::Modulus &m);
+
+        uint64_t addLanes;
+        void (*add)(uint64_t *r, const uint64_t *a, const uint64_t *b, uint64_t n, const Montgomery::Modulus &m);
+        void (*sub)(uint64_t *r, const uint64_t *a, const uint64_t *b, uint64_t n, const Montgomery::Modulus &m);
+    };
+
+    const Kernels &kernels(Isa isa);
+
+    // Batch operations of a Field, so curve code can use one interface for
+    // G1 and G2. Fields whose Element is 4 limbs in Element::v take the
+    // kernels, quadratic extensions of those (Fq2, 8 limbs) the fused
+    // products of Montgomery::QuadraticMul and the kernels of the base
+    // field for additions, and the others loop over the field's own
+    // operations.
+    template <typename Field, uint64_t limbs = sizeof(typename Field::Element) / sizeof(uint64_t)>
+    class Batch {
+        Field &f;
+
+    public:
+        typedef typename Field::Element Element;
+
+        explicit Batch(Field &_f, Isa isa = bestIsa()) : f(_f) {}
+
+        void mul(Element *r, Element *a, Element *b, uint64_t n) {
+            for (uint64_t i = 0; i < n; i++) {
+                f.mul(r[i], a[i], b[i]);
+            }
+        }
+
+        void mulBy(Element *r, Element *a, Element &b, uint64_t n) {
+            for (uint64_t i = 0; i < n; i++) {
+                f.mul(r[i], a[i], b);
+            }
+        }
+
+        void square(Element *r, Element *a, uint64_t n) {
+            for (uint64_t i = 0; i < n; i++) {
+                f.square(r[i], a[i]);
+            }
+        }
+
+        void add(Element *r, Element *a, Element *b, uint64_t n) {
+            for (uint64_t i = 0; i < n; i++) {
+                f.add(r[i], a[i], b[i]);
+            }
+        }
+
+        void sub(Element *r, Element *a, Element *b, uint64_t n) {
+            for (uint64_t i = 0; i < n; i++) {
+                f.sub(r[i], a[i], b[i]);
+            }
+        }
+    };
+
+    template <typename Field>
+    class Batch<Field, 4> {
+    public:
+        typedef typename Field::Element Element;
+
+    private:
+        Field &f;
+        Montgomery::FieldMul<Field> fieldMul;
+        const Kernels &k;
+
+        static uint64_t *limbs(Element *x) { return (uint64_t *)x; }
+        static const uint64_t *limbs(const Element *x) { return (const uint64_t *)x; }
+
+    public:
+        explicit Batch(Field &_f, Isa isa = bestIsa())
+            : f(_f)
+            , fieldMul(_f)
+            , k(kernels(isa))
+        {}
+
+        void mul(Element *r, const Element *a, const Element *b, uint64_t n) {
+            uint64_t done = 0;
+
+            if (k.mul && n >= k.mulLanes) {
+                done = n - n % k.mulLanes;
+                k.mul(limbs(r), limbs(a), limbs(b), done, fieldMul.getModulus());
+            }
+            for (uint64_t i = done; i < n; i++) {
+                fieldMul.mul(r[i], a[i], b[i]);
+            }
+        }
+
+        void mulBy(Element *r, const Element *a, const Element &b, uint64_t n) {
+            uint64_t done = 0;
+
+            if (k.mulBy) {
+                done = n - n % k.mulLanes;
+                k.mulBy(limbs(r), limbs(a), b.v, done, fieldMul.getModulus());
+            }
+            for (uint64_t i = done; i < n; i++) {
+                fieldMul.mul(r[i], a[i], b);
+            }
+        }
+
+        void square(Element *r, const Element *a, uint64_t n) {
+            mul(r, a, a, n);
+        }
+
+        void add(Element *r, const Element *a, const Element *b, uint64_t n) {
+            uint64_t done = 0;
+
+            if (k.add) {
+                done = n - n % k.addLanes;
+                k.add(limbs(r), limbs(a), limbs(b), done, fieldMul.getModulus());
+            }
+            for (uint64_t i = done; i < n; i++) {
+                f.add(r[i], a[i], b[i]);
+            }
+        }
+
+        void sub(Element *r, const Element *a, const Element *b, uint64_t n) {
+            uint64_t done = 0;
+
+            if (k.sub) {
+                done = n - n % k.addLanes;
+                k.sub(limbs(r), limbs(a), limbs(b), done, fieldMul.getModulus());
+            }
+            for (uint64_t i = done; i < n; i++) {
+                f.sub(r[i], a[i], b[i]);
+            }
+        }
+    };
+
+    template <typename Field>
+    class Batch<Field, 8> {
+    public:
+        typedef typename Field::Element Element;
+
+    private:
+        Field &f;
+        Montgomery::QuadraticMul<Field> quadraticMul;
+        const Kernels &k;
+
+        static uint64_t *limbs(Element *x) { return (uint64_t *)x; }
+        static const uint64_t *limbs(const Element *x) { return (const uint64_t *)x; }
+
+    public:
+        explicit Batch(Field &_f, Isa isa = bestIsa())
+            : f(_f)
+            , quadraticMul(_f)
+            , k(kernels(isa))
+        {}
+
+        void mul(Element *r, Element *a, Element *b, uint64_t n) {
+            for (uint64_t i = 0; i < n; i++) {
+                quadraticMul.mul(r[i], a[i], b[i]);
+            }
+        }
+
+        void mulBy(Element *r, Element *a, Element &b, uint64_t n) {
+            for (uint64_t i = 0; i < n; i++) {
+                quadraticMul.mul(r[i], a[i], b);
+            }
+        }
+
+        void square(Element *r, Element *a, uint64_t n) {
+            for (uint64_t i = 0; i < n; i++) {
+                quadraticMul.square(r[i], a[i]);
+            }
+        }
+
+        // Componentwise, so the base field kernels run over 2n elements.
+        void add(Element *r, Element *a, Element *b, uint64_t n) {
+            uint64_t done = 0;
+
+            if (k.add) {
+                done = n - n % k.addLanes;
+                k.add(limbs(r), limbs(a), limbs(b), 2 * done, quadraticMul.getModulus());
+            }
+            for (uint64_t i = done; i < n; i++) {
+                f.add(r[i], a[i], b[i]);
+            }
+        }
+
+        void sub(Element *r, Element *a, Element *b, uint64_t n) {
+            uint64_t done = 0;
+
+            if (k.sub) {
+                done = n - n % k.addLanes;
+                k.sub(limbs(r), limbs(a), limbs(b), 2 * done, quadraticMul.getModulus());
+            }
+            for (uint64_t i = done; i < n; i++) {
+                f.sub(r[i], a[i], b[i]);
+            }
+        }
+    };
+}
+
+#endif // FIELD_BATCH_HPP
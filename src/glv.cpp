@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <cstring>
+
+#include "glv.hpp"
+
+namespace MultiExp {
+
+GlvSplit::GlvSplit()
+{
+    mpz_init_set_str(r, "21888242871839275222246405745257275088548364400416034343698204186575808495617", 10);
+    mpz_init_set_str(lambda, "4407920970296243842393367215006156084916469457145843978461", 10);
+    mpz_inits(a1, b1, a2, b2, det, NULL);
+
+    // Short basis of the lattice {(x, y): x + y*lambda = 0 (mod r)} from
+    // the extended Euclidean algorithm on (r, lambda), whose rows satisfy
+    // r_i = t_i*lambda (mod r). With l the last row where r_l >= sqrt(r),
+    // (a1, b1) = (r_l+1, -t_l+1) and (a2, b2) is the shorter of the rows l
+    // and l+2.
+    mpz_t sqrtR, r0, r1, r2, t0, t1, t2, q, norm0, norm2;
+    mpz_inits(sqrtR, r0, r1, r2, t0, t1, t2, q, norm0, norm2, NULL);
+
+    mpz_sqrt(sqrtR, r);
+    mpz_set(r0, r);
+    mpz_set(r1, lambda);
+    mpz_set_ui(t0, 0);
+    mpz_set_ui(t1, 1);
+
+    while (mpz_cmp(r1, sqrtR) >= 0) {
+        mpz_fdiv_q(q, r0, r1);
+
+        mpz_set(r2, r0);
+        mpz_submul(r2, q, r1);
+        mpz_set(t2, t0);
+        mpz_submul(t2, q, t1);
+
+        mpz_swap(r0, r1);
+        mpz_swap(r1, r2);
+        mpz_swap(t0, t1);
+        mpz_swap(t1, t2);
+    }
+
+    mpz_set(a1, r1);
+    mpz_neg(b1, t1);
+
+    mpz_fdiv_q(q, r0, r1);
+    mpz_set(r2, r0);
+    mpz_submul(r2, q, r1);
+    mpz_set(t2, t0);
+    mpz_submul(t2, q, t1);
+
+    mpz_mul(norm0, r0, r0);
+    mpz_addmul(norm0, t0, t0);
+    mpz_mul(norm2, r2, r2);
+    mpz_addmul(norm2, t2, t2);
+
+    if (mpz_cmp(norm0, norm2) <= 0) {
+        mpz_set(a2, r0);
+        mpz_neg(b2, t0);
+    } else {
+        mpz_set(a2, r2);
+        mpz_neg(b2, t2);
+    }
+
+    mpz_clears(sqrtR, r0, r1, r2, t0, t1, t2, q, norm0, norm2, NULL);
+
+    mpz_mul(det, a1, b2);
+    mpz_submul(det, a2, b1);
+}
+
+GlvSplit::~GlvSplit()
+{
+    mpz_clears(r, lambda, a1, b1, a2, b2, det, NULL);
+}
+
+const GlvSplit &GlvSplit::bn254()
+{
+    static GlvSplit split;
+
+    return split;
+}
+
+void GlvSplit::getLambda(uint8_t *lambdaBytes, uint64_t size) const
+{
+    size_t count = 0;
+
+    std::memset(lambdaBytes, 0, size);
+    mpz_export(lambdaBytes, &count, -1, 1, -1, 0, lambda);
+}
+
+static void ExportHalf(uint8_t *half, uint8_t *negative, const mpz_t v)
+{
+    size_t count = 0;
+
+    std::memset(half, 0, GlvSplit::halfSize);
+
+    if (mpz_sizeinbase(v, 2) > GlvSplit::halfSize * 8) {
+        throw std::range_error("GLV half scalar out of range");
+    }
+
+    mpz_export(half, &count, -1, 1, -1, 0, v);
+    *negative = mpz_sgn(v) < 0;
+}
+
+void GlvSplit::split(const uint8_t *scalars, uint64_t scalarSize, uint64_t n,
+                     uint8_t *halves, uint8_t *negative, ThreadPool &threadPool) const
+{
+    threadPool.parallelFor(0, n, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        mpz_t k, k1, k2, c1, c2, twoDet;
+        mpz_inits(k, k1, k2, c1, c2, twoDet, NULL);
+
+        mpz_mul_2exp(twoDet, det, 1);
+
+        for (int64_t i = begin; i < end; i++) {
+            const uint8_t *scalar = scalars + i*scalarSize;
+            uint8_t *h1 = halves + (2*i) * halfSize;
+            uint8_t *h2 = h1 + halfSize;
+
+            // Scalars below 2^128 are already split: k1 = k, k2 = 0.
+            bool small = true;
+            for (uint64_t b = halfSize; b < scalarSize; b++) {
+                if (scalar[b] != 0) {
+                    small = false;
+                    break;
+                }
+            }
+
+            if (small) {
+                uint8_t low[halfSize] = {0};
+
+                std::memcpy(low, scalar, std::min(halfSize, scalarSize));
+                std::memcpy(h1, low, halfSize);
+                std::memset(h2, 0, halfSize);
+                negative[2*i] = 0;
+                negative[2*i + 1] = 0;
+                continue;
+            }
+
+            mpz_import(k, scalarSize, -1, 1, -1, 0, scalar);
+
+            // c1 = round(b2*k/det), c2 = round(-b1*k/det)
+            mpz_mul(c1, b2, k);
+            mpz_mul_2exp(c1, c1, 1);
+            mpz_add(c1, c1, det);
+            mpz_fdiv_q(c1, c1, twoDet);
+
+            mpz_mul(c2, b1, k);
+            mpz_neg(c2, c2);
+            mpz_mul_2exp(c2, c2, 1);
+            mpz_add(c2, c2, det);
+            mpz_fdiv_q(c2, c2, twoDet);
+
+            // k1 = k - c1*a1 - c2*a2, k2 = -c1*b1 - c2*b2
+            mpz_set(k1, k);
+            mpz_submul(k1, c1, a1);
+            mpz_submul(k1, c2, a2);
+
+            mpz_mul(k2, c1, b1);
+            mpz_addmul(k2, c2, b2);
+            mpz_neg(k2, k2);
+
+            ExportHalf(h1, negative + 2*i, k1);
+            ExportHalf(h2, negative + 2*i + 1, k2);
+        }
+
+        mpz_clears(k, k1, k2, c1, c2, twoDet, NULL);
+    });
+}
+
+} // Namespace
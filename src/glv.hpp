@@ -0,0 +1,136 @@
+#ifndef GLV_HPP
+#define GLV_HPP
+
+#include <gmp.h>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "fq.hpp"
+#include "threadpool.hpp"
+
+namespace MultiExp {
+
+    // Splits BN254 Fr scalars as k = k1 + k2*lambda (mod r), where lambda is
+    // a cube root of unity, with |k1|, |k2| < 2^128 (GLV decomposition).
+    class GlvSplit {
+
+        mpz_t r;
+        mpz_t lambda;
+        mpz_t a1, b1, a2, b2;
+        mpz_t det;
+
+        GlvSplit();
+
+    public:
+        static const uint64_t halfSize = 16;
+
+        ~GlvSplit();
+
+        GlvSplit(const GlvSplit&) = delete;
+        GlvSplit& operator=(const GlvSplit&) = delete;
+
+        static const GlvSplit &bn254();
+
+        // Little-endian lambda, 'size' bytes.
+        void getLambda(uint8_t *lambdaBytes, uint64_t size) const;
+
+        // For every scalar i < n writes |k1| and |k2| to halves[2i] and
+        // halves[2i+1] (halfSize bytes each) and their signs to
+        // negative[2i] and negative[2i+1]. With 32 byte scalars 'halves'
+        // may be 'scalars' itself.
+        void split(const uint8_t *scalars, uint64_t scalarSize, uint64_t n,
+                   uint8_t *halves, uint8_t *negative, ThreadPool &threadPool) const;
+    };
+
+    inline void mulByFq(RawFq::Element &r, const RawFq::Element &x, const RawFq::Element &beta) {
+        RawFq::field.mul(r, x, beta);
+    }
+
+    template <typename F2Element>
+    inline void mulByFq(F2Element &r, const F2Element &x, const RawFq::Element &beta) {
+        RawFq::field.mul(r.a, x.a, beta);
+        RawFq::field.mul(r.b, x.b, beta);
+    }
+
+    // phi(x, y) = (beta*x, y), which acts on the prime order subgroup as
+    // multiplication by the GlvSplit lambda.
+    template <typename Curve>
+    class Endomorphism {
+
+        typedef typename Curve::Point Point;
+        typedef typename Curve::PointAffine PointAffine;
+
+        RawFq::Element beta;
+
+    public:
+        explicit Endomorphism(Curve &g) {
+            RawFq &F = RawFq::field;
+            uint8_t lambda[32];
+            Point expected;
+            Point image;
+            PointAffine imageAffine;
+
+            GlvSplit::bn254().getLambda(lambda, sizeof(lambda));
+            g.mulByScalar(expected, g.oneAffine(), lambda, sizeof(lambda));
+
+            // Of the two nontrivial cube roots of unity, take the one that
+            // corresponds to lambda on this group.
+            F.fromString(beta, "2203960485148121921418603742825762020974279258880205651966");
+
+            for (int i = 0; i < 2; i++) {
+                apply(imageAffine, g.oneAffine());
+                g.copy(image, imageAffine);
+
+                if (g.eq(image, expected)) {
+                    return;
+                }
+                F.mul(beta, beta, beta);
+            }
+
+            throw std::logic_error("no endomorphism for lambda");
+        }
+
+        void apply(PointAffine &r, PointAffine &p) const {
+            mulByFq(r.x, p.x, beta);
+            r.y = p.y;
+        }
+
+        void applyAll(PointAffine *r, PointAffine *p, uint64_t n, ThreadPool &threadPool) const {
+            threadPool.parallelFor(0, n, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+                for (int64_t i = begin; i < end; i++) {
+                    apply(r[i], p[i]);
+                }
+            });
+        }
+    };
+
+    // Split scalars of every scalar vector of a batch.
+    struct GlvScalars {
+        std::vector<uint8_t *> halves;
+        std::vector<uint8_t *> negative;
+
+        // The scalars from index 'from' on.
+        GlvScalars offset(uint64_t from) const {
+            GlvScalars r;
+
+            for (uint64_t w = 0; w < halves.size(); w++) {
+                r.halves.push_back(halves[w] + 2*from*GlvSplit::halfSize);
+                r.negative.push_back(negative[w] + 2*from);
+            }
+            return r;
+        }
+    };
+
+    // Input of the GLV mode of the multiexp: the endomorphism, the
+    // precomputed images of the bases (null to compute them on the fly)
+    // and the split scalars.
+    template <typename Curve>
+    struct GlvInput {
+        const Endomorphism<Curve> *endomorphism;
+        typename Curve::PointAffine *endoBases;
+        const GlvScalars *scalars;
+    };
+}
+
+#endif // GLV_HPP
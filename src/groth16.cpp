@@ -1,9 +1,15 @@
 #include "random_generator.hpp"
 #include "logging.hpp"
 #include "misc.hpp"
+#include "multiexp.hpp"
 #include <sstream>
 #include <vector>
+#include <cstring>
 #include <mutex>
+#include <future>
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
 
 namespace Groth16 {
 
@@ -43,179 +49,1397 @@ std::unique_ptr<Prover<Engine>> makeProver(
         (typename Engine::G1PointAffine *)pointsC,
         (typename Engine::G1PointAffine *)pointsH
     );
+    p->buildCoefPartition();
+    p->findZeroPoints();
     return std::unique_ptr< Prover<Engine> >(p);
 }
 
 template <typename Engine>
 std::unique_ptr<Proof<Engine>> Prover<Engine>::prove(typename Engine::FrElement *wtns) {
 
-    ThreadPool &threadPool = ThreadPool::defaultPool();
+    auto proofs = proveBatch(std::vector<typename Engine::FrElement *>(1, wtns));
+
+    return std::move(proofs[0]);
+}
+
+template <typename Engine>
+typename Prover<Engine>::ProofList Prover<Engine>::proveBatch(const std::vector<typename Engine::FrElement *> &wtns) {
+
+    if (wtns.empty()) {
+        return ProofList();
+    }
+
+    if (options.taskGraph) {
+        return proveTaskGraph(wtns);
+    }
+
+    const u_int32_t nWitnesses = wtns.size();
+    auto scratch = scratchPool.checkout(
+        [this, nWitnesses] () { return createScratchSet(nWitnesses); },
+        [nWitnesses] (const ScratchSet &set) { return set.batchSize >= nWitnesses; });
+
+    // A, B1, B2 and C share the window digits of the witness.
+    MultiExp::DigitCache digitCache;
+    auto g1Msm = g1Multiexp(&digitCache);
+    auto g2Msm = g2Multiexp(&digitCache);
+
+    g1Msm.setMemoryLimit(scratch->limits.g1);
+    g2Msm.setMemoryLimit(scratch->limits.g2);
+
+    uint32_t sW = sizeof(wtns[0][0]);
+    std::vector<uint8_t *> scalars(nWitnesses);
+    std::vector<uint8_t *> scalarsC(nWitnesses);
+
+    for (u_int32_t w=0; w<nWitnesses; w++) {
+        scalars[w] = (uint8_t *)wtns[w];
+        scalarsC[w] = (uint8_t *)((uint64_t)wtns[w] + (nPublic +1)*sW);
+    }
+
+    WitnessProfiles profiles;
+
+    if (options.witnessProfile) {
+        LOG_TRACE("Start witness profile");
+        profileWitness(scalars, profiles);
+    }
+
+    if (options.glv != GlvOff) {
+        LOG_TRACE("Start witness GLV split");
+        splitWitness(scalars, *scratch);
+    }
+
+    const MultiExp::GlvScalars &glvScalars = scratch->glvWitness;
+    const MultiExp::GlvScalars glvScalarsC = glvScalars.offset(nPublic + 1);
+
+    shareWitnessDigits(digitCache, scalars, glvScalars, 0, nVars);
+
+    std::vector<typename Engine::G1Point> pi_a(nWitnesses);
+    std::vector<typename Engine::G1Point> pib1(nWitnesses);
+    std::vector<typename Engine::G2Point> pi_b(nWitnesses);
+    std::vector<typename Engine::G1Point> pi_c(nWitnesses);
+
+    if (options.numa) {
+        LOG_TRACE("Start NUMA Multiexps A B1 B2 C");
+        numaMultiexps(pi_a.data(), pib1.data(), pi_b.data(), pi_c.data(), scalars, profiles, *scratch);
+
+        std::ostringstream ss;
+        ss << "pi_a: " << E.g1.toString(pi_a[0]) << " pib1: " << E.g1.toString(pib1[0]);
+        ss << " pi_b: " << E.g2.toString(pi_b[0]) << " pi_c: " << E.g1.toString(pi_c[0]);
+        LOG_DEBUG(ss);
+    } else {
+        LOG_TRACE("Start Multiexp A");
+        multiexp(g1Msm, MultiexpA, pi_a.data(), pointsA, scalars, nVars, profiles.a,
+                 glvInput(g1Endomorphism, endoPointsA, glvScalars), shiftedA, scratch->g1Buckets);
+        std::ostringstream ss2;
+        ss2 << "pi_a: " << E.g1.toString(pi_a[0]);
+        LOG_DEBUG(ss2);
+
+        LOG_TRACE("Start Multiexp B1");
+        multiexp(g1Msm, MultiexpB1, pib1.data(), pointsB1, scalars, nVars, profiles.b1,
+                 glvInput(g1Endomorphism, endoPointsB1, glvScalars), shiftedB1, scratch->g1Buckets);
+        std::ostringstream ss3;
+        ss3 << "pib1: " << E.g1.toString(pib1[0]);
+        LOG_DEBUG(ss3);
+
+        LOG_TRACE("Start Multiexp B2");
+        multiexp(g2Msm, MultiexpB2, pi_b.data(), pointsB2, scalars, nVars, profiles.b2,
+                 glvInput(g2Endomorphism, endoPointsB2, glvScalars), shiftedB2, scratch->g2Buckets);
+        std::ostringstream ss4;
+        ss4 << "pi_b: " << E.g2.toString(pi_b[0]);
+        LOG_DEBUG(ss4);
+
+        LOG_TRACE("Start Multiexp C");
+        multiexp(g1Msm, MultiexpC, pi_c.data(), pointsC, scalarsC, nVars-nPublic-1, profiles.c,
+                 glvInput(g1Endomorphism, endoPointsC, glvScalarsC), shiftedC, scratch->g1Buckets);
+        std::ostringstream ss5;
+        ss5 << "pi_c: " << E.g1.toString(pi_c[0]);
+        LOG_DEBUG(ss5);
+    }
+
+    LOG_TRACE("Start Initializing a b c A");
+    computeH(wtns, *scratch);
+
+    LOG_TRACE("Start Multiexp H");
+    std::vector<typename Engine::G1Point> pih(nWitnesses);
+    multiexpH(pih.data(), *scratch, nWitnesses);
+    std::ostringstream ss1;
+    ss1 << "pih: " << E.g1.toString(pih[0]);
+    LOG_DEBUG(ss1);
+
+    ProofList proofs;
+
+    for (u_int32_t w=0; w<nWitnesses; w++) {
+        Proof<Engine> *p = new Proof<Engine>(Engine::engine);
+        finishProof(*p, pi_a[w], pib1[w], pi_b[w], pi_c[w], pih[w]);
+        proofs.push_back(std::unique_ptr<Proof<Engine>>(p));
+    }
+
+    return proofs;
+}
+
+template <typename Engine>
+typename Prover<Engine>::ProofList Prover<Engine>::proveTaskGraph(const std::vector<typename Engine::FrElement *> &wtns) {
+
+    const u_int32_t nWitnesses = wtns.size();
+    auto scratch = scratchPool.checkout(
+        [this, nWitnesses] () { return createScratchSet(nWitnesses); },
+        [nWitnesses] (const ScratchSet &set) { return set.batchSize >= nWitnesses; });
+
+    uint32_t sW = sizeof(wtns[0][0]);
+    std::vector<uint8_t *> scalars(nWitnesses);
+    std::vector<uint8_t *> scalarsC(nWitnesses);
+
+    for (u_int32_t w=0; w<nWitnesses; w++) {
+        scalars[w] = (uint8_t *)wtns[w];
+        scalarsC[w] = (uint8_t *)((uint64_t)wtns[w] + (nPublic +1)*sW);
+    }
+
+    WitnessProfiles profiles;
+
+    if (options.witnessProfile) {
+        LOG_TRACE("Start witness profile");
+        profileWitness(scalars, profiles);
+    }
+
+    if (options.glv != GlvOff) {
+        LOG_TRACE("Start witness GLV split");
+        splitWitness(scalars, *scratch);
+    }
+
+    const MultiExp::GlvScalars &glvScalars = scratch->glvWitness;
+    const MultiExp::GlvScalars glvScalarsC = glvScalars.offset(nPublic + 1);
+
+    std::vector<typename Engine::G1Point> pi_a(nWitnesses);
+    std::vector<typename Engine::G1Point> pib1(nWitnesses);
+    std::vector<typename Engine::G2Point> pi_b(nWitnesses);
+    std::vector<typename Engine::G1Point> pi_c(nWitnesses);
+
+    // A, B1, B2 and C share the window digits of the witness.
+    MultiExp::DigitCache digitCache;
+    shareWitnessDigits(digitCache, scalars, glvScalars, 0, nVars);
+
+    // The multiexps only depend on the witness, so they run on their own
+    // thread pools while this thread computes H on the H pool. In NUMA mode
+    // one lane runs them on the pools of the nodes, and the H multiexp,
+    // which needs the same pools, waits for it.
+    std::future<void> g1Lane;
+    std::future<void> g2Lane;
+
+    if (options.numa) {
+        LOG_TRACE("Start NUMA Multiexp lane");
+        g1Lane = std::async(std::launch::async, [&] () {
+            numaMultiexps(pi_a.data(), pib1.data(), pi_b.data(), pi_c.data(), scalars, profiles, *scratch);
+        });
+    } else {
+        LOG_TRACE("Start Multiexp lane G2");
+        g2Lane = std::async(std::launch::async, [&] () {
+            auto msm = g2Multiexp(&digitCache);
+
+            msm.setMemoryLimit(scratch->limits.g2);
+
+            multiexp(msm, MultiexpB2, pi_b.data(), pointsB2, scalars, nVars, profiles.b2,
+                     glvInput(g2Endomorphism, endoPointsB2, glvScalars), shiftedB2, scratch->g2Buckets);
+        });
+
+        LOG_TRACE("Start Multiexp lane G1");
+        g1Lane = std::async(std::launch::async, [&] () {
+            auto msm = g1Multiexp(&digitCache);
+
+            msm.setMemoryLimit(scratch->limits.g1);
+
+            multiexp(msm, MultiexpA, pi_a.data(), pointsA, scalars, nVars, profiles.a,
+                     glvInput(g1Endomorphism, endoPointsA, glvScalars), shiftedA, scratch->g1Buckets);
+            multiexp(msm, MultiexpB1, pib1.data(), pointsB1, scalars, nVars, profiles.b1,
+                     glvInput(g1Endomorphism, endoPointsB1, glvScalars), shiftedB1, scratch->g1Buckets);
+            multiexp(msm, MultiexpC, pi_c.data(), pointsC, scalarsC, nVars-nPublic-1, profiles.c,
+                     glvInput(g1Endomorphism, endoPointsC, glvScalarsC), shiftedC, scratch->g1Buckets);
+        });
+    }
+
+    LOG_TRACE("Start Initializing a b c A");
+    computeH(wtns, *scratch);
+
+    if (options.numa) {
+        LOG_TRACE("Wait NUMA Multiexp lane");
+        g1Lane.get();
+    }
+
+    LOG_TRACE("Start Multiexp H");
+    std::vector<typename Engine::G1Point> pih(nWitnesses);
+    multiexpH(pih.data(), *scratch, nWitnesses);
+    std::ostringstream ss1;
+    ss1 << "pih: " << E.g1.toString(pih[0]);
+    LOG_DEBUG(ss1);
+
+    LOG_TRACE("Wait Multiexp lanes");
+    if (g1Lane.valid()) {
+        g1Lane.get();
+    }
+    if (g2Lane.valid()) {
+        g2Lane.get();
+    }
 
-    LOG_TRACE("Start Multiexp A");
-    uint32_t sW = sizeof(wtns[0]);
-    typename Engine::G1Point pi_a;
-    E.g1.multiMulByScalarMSM(pi_a, pointsA, (uint8_t *)wtns, sW, nVars);
     std::ostringstream ss2;
-    ss2 << "pi_a: " << E.g1.toString(pi_a);
+    ss2 << "pi_a: " << E.g1.toString(pi_a[0]) << " pib1: " << E.g1.toString(pib1[0]);
+    ss2 << " pi_b: " << E.g2.toString(pi_b[0]) << " pi_c: " << E.g1.toString(pi_c[0]);
     LOG_DEBUG(ss2);
 
-    LOG_TRACE("Start Multiexp B1");
-    typename Engine::G1Point pib1;
-    E.g1.multiMulByScalarMSM(pib1, pointsB1, (uint8_t *)wtns, sW, nVars);
-    std::ostringstream ss3;
-    ss3 << "pib1: " << E.g1.toString(pib1);
-    LOG_DEBUG(ss3);
-
-    LOG_TRACE("Start Multiexp B2");
-    typename Engine::G2Point pi_b;
-    E.g2.multiMulByScalarMSM(pi_b, pointsB2, (uint8_t *)wtns, sW, nVars);
-    std::ostringstream ss4;
-    ss4 << "pi_b: " << E.g2.toString(pi_b);
-    LOG_DEBUG(ss4);
-
-    LOG_TRACE("Start Multiexp C");
-    typename Engine::G1Point pi_c;
-    E.g1.multiMulByScalarMSM(pi_c, pointsC, (uint8_t *)((uint64_t)wtns + (nPublic +1)*sW), sW, nVars-nPublic-1);
-    std::ostringstream ss5;
-    ss5 << "pi_c: " << E.g1.toString(pi_c);
-    LOG_DEBUG(ss5);
+    ProofList proofs;
 
-    LOG_TRACE("Start Initializing a b c A");
-    auto a = new typename Engine::FrElement[domainSize];
-    auto b = new typename Engine::FrElement[domainSize];
-    auto c = new typename Engine::FrElement[domainSize];
-
-    threadPool.parallelFor(0, domainSize, [&] (int64_t begin, int64_t end, uint64_t idThread) {
-        for (u_int32_t i=begin; i<end; i++) {
-            E.fr.copy(a[i], E.fr.zero());
-            E.fr.copy(b[i], E.fr.zero());
+    for (u_int32_t w=0; w<nWitnesses; w++) {
+        Proof<Engine> *p = new Proof<Engine>(Engine::engine);
+        finishProof(*p, pi_a[w], pib1[w], pi_b[w], pi_c[w], pih[w]);
+        proofs.push_back(std::unique_ptr<Proof<Engine>>(p));
+    }
+
+    return proofs;
+}
+
+template <typename Engine>
+void Prover<Engine>::profileWitness(const std::vector<uint8_t *> &scalars, WitnessProfiles &profiles)
+{
+    MultiExp::ScalarProfile profile;
+
+    profile.build(scalars.data(), sizeof(typename Engine::FrElement), nVars, scalars.size(), ThreadPool::defaultPool());
+    profile.exclude(profiles.a, zeroPointsA);
+    profile.exclude(profiles.b1, zeroPointsB1);
+    profile.exclude(profiles.b2, zeroPointsB2);
+    profile.slice(profiles.c, nPublic + 1, nVars - nPublic - 1);
+
+    std::lock_guard<std::mutex> guard(witnessHistogramMutex);
+
+    for (int c = 0; c < MultiExp::nScalarClasses; c++) {
+        witnessHistogram[c] = profile.count((MultiExp::ScalarClass)c);
+    }
+
+    std::ostringstream ss;
+    ss << "witness zeros: " << witnessHistogram[MultiExp::ScalarZero]
+       << " ones: " << witnessHistogram[MultiExp::ScalarOne]
+       << " short: " << witnessHistogram[MultiExp::ScalarShort]
+       << " full: " << witnessHistogram[MultiExp::ScalarFull];
+    LOG_DEBUG(ss);
+}
+
+template <typename Engine>
+void Prover<Engine>::getWitnessHistogram(u_int64_t histogram[MultiExp::nScalarClasses]) {
+
+    std::lock_guard<std::mutex> guard(witnessHistogramMutex);
+
+    std::copy(witnessHistogram, witnessHistogram + MultiExp::nScalarClasses, histogram);
+}
+
+template <typename Engine>
+void Prover<Engine>::findZeroPoints() {
+
+    listZeroPoints(zeroPointsA, E.g1, pointsA, nVars);
+    listZeroPoints(zeroPointsB1, E.g1, pointsB1, nVars);
+    listZeroPoints(zeroPointsB2, E.g2, pointsB2, nVars);
+
+    std::ostringstream ss;
+    ss << "points at infinity A: " << zeroPointsA.size()
+       << " B1: " << zeroPointsB1.size()
+       << " B2: " << zeroPointsB2.size();
+    LOG_DEBUG(ss);
+}
+
+template <typename Engine>
+template <typename Curve>
+void Prover<Engine>::listZeroPoints(
+    std::vector<u_int32_t> &r,
+    Curve &g,
+    typename Curve::PointAffine *points,
+    u_int64_t n)
+{
+    const u_int64_t rangeSize = 1 << 16;
+    const u_int64_t nRanges = (n + rangeSize - 1) / rangeSize;
+
+    std::vector<std::vector<u_int32_t>> rangeLists(nRanges);
+
+    ThreadPool::defaultPool().parallelFor(0, nRanges, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        for (int64_t k = begin; k < end; k++) {
+            const u_int64_t to = std::min(n, (k + 1) * rangeSize);
+
+            for (u_int64_t i = k * rangeSize; i < to; i++) {
+                if (g.isZero(points[i])) {
+                    rangeLists[k].push_back(i);
+                }
+            }
         }
     });
 
-    LOG_TRACE("Processing coefs");
+    r.clear();
+    for (const auto &l : rangeLists) {
+        r.insert(r.end(), l.begin(), l.end());
+    }
+}
+
+template <typename Engine>
+void Prover<Engine>::splitWitness(const std::vector<uint8_t *> &scalars, ScratchSet &scratch) {
+
+    const MultiExp::GlvSplit &split = MultiExp::GlvSplit::bn254();
+
+    for (u_int32_t w=0; w<scalars.size(); w++) {
+        split.split(scalars[w], sizeof(typename Engine::FrElement), nVars,
+                    scratch.glvWitness.halves[w], scratch.glvWitness.negative[w], ThreadPool::defaultPool());
+    }
+}
+
+template <typename Engine>
+void Prover<Engine>::shareWitnessDigits(
+    MultiExp::DigitCache &cache,
+    const std::vector<uint8_t *> &scalars,
+    const MultiExp::GlvScalars &glvScalars,
+    u_int64_t from,
+    u_int64_t n)
+{
+    const uint64_t sW = sizeof(typename Engine::FrElement);
+    const u_int32_t nWitnesses = scalars.size();
+    std::vector<uint8_t *> extent(nWitnesses);
+
+    for (u_int32_t w=0; w<nWitnesses; w++) {
+        extent[w] = scalars[w] + from*sW;
+    }
+    cache.addScalars(extent.data(), sW, n, nWitnesses);
+
+    if (options.glv != GlvOff) {
+        const MultiExp::GlvScalars glvExtent = glvScalars.offset(from);
+
+        cache.addScalars(glvExtent.halves.data(), MultiExp::GlvSplit::halfSize, 2*n, nWitnesses);
+    }
+}
+
+template <typename Engine>
+template <typename Curve>
+MultiExp::GlvInput<Curve> Prover<Engine>::glvInput(
+    const std::unique_ptr<MultiExp::Endomorphism<Curve>> &endomorphism,
+    std::vector<typename Curve::PointAffine> &endoBases,
+    const MultiExp::GlvScalars &scalars)
+{
+    MultiExp::GlvInput<Curve> glv;
+
+    glv.endomorphism = endomorphism.get();
+    glv.endoBases = endoBases.empty() ? nullptr : endoBases.data();
+    glv.scalars = &scalars;
+
+    return glv;
+}
+
+template <typename Engine>
+template <typename Curve>
+void Prover<Engine>::mapEndomorphism(
+    std::vector<typename Curve::PointAffine> &r,
+    const std::unique_ptr<MultiExp::Endomorphism<Curve>> &endomorphism,
+    typename Curve::PointAffine *bases,
+    u_int64_t n)
+{
+    r.resize(n);
+    endomorphism->applyAll(r.data(), bases, n, ThreadPool::defaultPool());
+}
+
+template <typename Engine>
+template <typename Curve>
+void Prover<Engine>::multiexp(
+    MultiExp::Pippenger<Curve> &msm,
+    ProofMultiexp id,
+    typename Curve::Point *r,
+    typename Curve::PointAffine *bases,
+    const std::vector<uint8_t *> &scalars,
+    u_int64_t n,
+    const MultiExp::ScalarProfile &profile,
+    const MultiExp::GlvInput<Curve> &glv,
+    MultiExp::ShiftedBases<Curve> &shifted,
+    void *scratch)
+{
+    const uint64_t sW = sizeof(typename Engine::FrElement);
+    const MultiExp::GlvInput<Curve> *glvMode = options.glv != GlvOff ? &glv : nullptr;
+    MultiExp::ShiftedBases<Curve> *shiftedMode = options.shiftedCopies > 1 ? &shifted : nullptr;
+
+    msm.setBatchAffine(options.batchAffine & id);
+
+    if (options.witnessProfile) {
+        msm.runProfiled(r, bases, scalars.data(), sW, scalars.size(), profile, scratch, glvMode, shiftedMode);
+    } else if (glvMode && !shiftedMode) {
+        msm.runGlv(r, bases, glv, n, scalars.size(), scratch);
+    } else {
+        msm.runBatch(r, bases, scalars.data(), sW, n, scalars.size(), scratch, shiftedMode);
+    }
+}
+
+template <typename Engine>
+void Prover<Engine>::multiexpH(typename Engine::G1Point *r, ScratchSet &scratch, u_int32_t nWitnesses) {
+
+    const uint64_t sW = sizeof(typename Engine::FrElement);
+    const std::vector<uint8_t *> scalars((uint8_t **)scratch.a.data(), (uint8_t **)scratch.a.data() + nWitnesses);
+
+    if (options.glv != GlvOff && options.shiftedCopies <= 1) {
+        // a is not used after this multiexp, so it is split in place.
+        const MultiExp::GlvSplit &split = MultiExp::GlvSplit::bn254();
 
-    #define NLOCKS 1024
-    std::vector<std::mutex> locks(NLOCKS);
+        for (u_int32_t w=0; w<nWitnesses; w++) {
+            split.split((uint8_t *)scratch.a[w], sW, domainSize,
+                        scratch.glvH.halves[w], scratch.glvH.negative[w], hThreadPool());
+        }
+    }
 
-    threadPool.parallelFor(0, nCoefs, [&] (int64_t begin, int64_t end, uint64_t idThread) {
-        for (u_int64_t i=begin; i<end; i++) {
-            typename Engine::FrElement *ab = (coefs[i].m == 0) ? a : b;
-            typename Engine::FrElement aux;
+    if (!options.numa) {
+        auto msm = hMultiexp();
 
-            E.fr.mul(
-                aux,
-                wtns[coefs[i].s],
-                coefs[i].coef
-            );
+        msm.setMemoryLimit(scratch.limits.h);
+        runMultiexpH(msm, r, pointsH, endoPointsH, shiftedH, scalars, scratch.glvH, domainSize, scratch.hBuckets);
+        return;
+    }
 
-            std::lock_guard<std::mutex> guard(locks[coefs[i].c % NLOCKS]);
+    std::vector<std::vector<typename Engine::G1Point>> partials(numaParts.size());
 
-            E.fr.add(
-                ab[coefs[i].c],
-                ab[coefs[i].c],
-                aux
-            );
+    onNumaNodes([&] (NumaPart &part, size_t k) {
+        std::vector<uint8_t *> partScalars(nWitnesses);
+
+        for (u_int32_t w=0; w<nWitnesses; w++) {
+            partScalars[w] = scalars[w] + part.hFrom*sW;
         }
+
+        auto msm = numaMultiexp(E.g1, E.f1, part, MultiExp::GroupG1);
+
+        msm.setMemoryLimit(scratch.numaLimits[k].h);
+        partials[k].resize(nWitnesses);
+        runMultiexpH(msm, partials[k].data(), part.pointsH.data(), part.endoPointsH, part.shiftedH,
+                     partScalars, scratch.glvH.offset(part.hFrom), part.hCount, scratch.numaHBuckets[k]);
     });
-    LOG_TRACE("Calculating c");
-    threadPool.parallelFor(0, domainSize, [&] (int64_t begin, int64_t end, uint64_t idThread) {
-        for (u_int64_t i=begin; i<end; i++) {
-            E.fr.mul(
-                c[i],
-                a[i],
-                b[i]
-            );
+
+    for (u_int32_t w=0; w<nWitnesses; w++) {
+        E.g1.copy(r[w], E.g1.zero());
+
+        for (size_t k=0; k<partials.size(); k++) {
+            E.g1.add(r[w], r[w], partials[k][w]);
         }
-    });
+    }
+}
 
-    LOG_TRACE("Initializing fft");
-    u_int32_t domainPower = fft->log2(domainSize);
+template <typename Engine>
+void Prover<Engine>::runMultiexpH(
+    MultiExp::Pippenger<typename Engine::G1> &msm,
+    typename Engine::G1Point *r,
+    typename Engine::G1PointAffine *bases,
+    std::vector<typename Engine::G1PointAffine> &endoBases,
+    MultiExp::ShiftedBases<typename Engine::G1> &shifted,
+    const std::vector<uint8_t *> &scalars,
+    const MultiExp::GlvScalars &glvScalars,
+    u_int64_t n,
+    void *scratch)
+{
+    const uint64_t sW = sizeof(typename Engine::FrElement);
 
-    LOG_TRACE("Start iFFT A");
-    fft->ifft(a, domainSize);
-    LOG_TRACE("a After ifft:");
-    LOG_DEBUG(E.fr.toString(a[0]).c_str());
-    LOG_DEBUG(E.fr.toString(a[1]).c_str());
-    LOG_TRACE("Start Shift A");
+    msm.setBatchAffine(options.batchAffine & MultiexpH);
 
-    threadPool.parallelFor(0, domainSize, [&] (int64_t begin, int64_t end, uint64_t idThread) {
-        for (u_int64_t i=begin; i<end; i++) {
-            E.fr.mul(a[i], a[i], fft->root(domainPower+1, i));
+    if (options.shiftedCopies > 1) {
+        msm.runBatch(r, bases, scalars.data(), sW, n, scalars.size(), scratch, &shifted);
+    } else if (options.glv == GlvOff) {
+        msm.runBatch(r, bases, scalars.data(), sW, n, scalars.size(), scratch);
+    } else {
+        msm.runGlv(r, bases, glvInput(g1Endomorphism, endoBases, glvScalars), n, scalars.size(), scratch);
+    }
+}
+
+template <typename Engine>
+template <typename Fn>
+void Prover<Engine>::onNumaNodes(Fn fn) {
+
+    std::vector<std::future<void>> tasks;
+
+    for (size_t k=0; k<numaParts.size(); k++) {
+        NumaPart &part = *numaParts[k];
+
+        tasks.push_back(std::async(std::launch::async, [&part, k, &fn] () {
+            Numa::pinThread(part.node);
+            fn(part, k);
+        }));
+    }
+
+    // All the tasks are waited for before the first error is passed on.
+    std::exception_ptr error;
+
+    for (auto &task : tasks) {
+        try {
+            task.get();
+        } catch (...) {
+            if (!error) {
+                error = std::current_exception();
+            }
         }
-    });
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+template <typename Engine>
+void Prover<Engine>::buildNumaParts() {
+
+    const std::vector<Numa::Node> nodes = Numa::nodes();
+    const u_int64_t nC = nVars - nPublic - 1;
+    u_int64_t nCpus = 0;
+
+    for (const Numa::Node &node : nodes) {
+        nCpus += node.cpus.size();
+    }
+
+    numaParts.clear();
+
+    // Every node takes a share of the points proportional to its cores.
+    u_int64_t cpusBefore = 0;
+
+    for (const Numa::Node &node : nodes) {
+        const u_int64_t cpusAfter = cpusBefore + node.cpus.size();
+        NumaPart *part = new NumaPart;
+
+        numaParts.push_back(std::unique_ptr<NumaPart>(part));
 
-    LOG_TRACE("a After shift:");
-    LOG_DEBUG(E.fr.toString(a[0]).c_str());
-    LOG_DEBUG(E.fr.toString(a[1]).c_str());
-    LOG_TRACE("Start FFT A");
-    fft->fft(a, domainSize);
-    LOG_TRACE("a After fft:");
-    LOG_DEBUG(E.fr.toString(a[0]).c_str());
-    LOG_DEBUG(E.fr.toString(a[1]).c_str());
-    LOG_TRACE("Start iFFT B");
-    fft->ifft(b, domainSize);
-    LOG_TRACE("b After ifft:");
-    LOG_DEBUG(E.fr.toString(b[0]).c_str());
-    LOG_DEBUG(E.fr.toString(b[1]).c_str());
-    LOG_TRACE("Start Shift B");
-    threadPool.parallelFor(0, domainSize, [&] (int64_t begin, int64_t end, uint64_t idThread) {
-        for (u_int64_t i=begin; i<end; i++) {
-            E.fr.mul(b[i], b[i], fft->root(domainPower+1, i));
+        part->node = node;
+        part->pool = Numa::createPool(node);
+        part->varsFrom = nVars * cpusBefore / nCpus;
+        part->varsCount = nVars * cpusAfter / nCpus - part->varsFrom;
+        part->cFrom = nC * cpusBefore / nCpus;
+        part->cCount = nC * cpusAfter / nCpus - part->cFrom;
+        part->hFrom = (u_int64_t)domainSize * cpusBefore / nCpus;
+        part->hCount = (u_int64_t)domainSize * cpusAfter / nCpus - part->hFrom;
+
+        cpusBefore = cpusAfter;
+    }
+
+    std::ostringstream ss;
+    ss << "NUMA nodes: " << numaParts.size() << " cores: " << nCpus;
+    LOG_DEBUG(ss);
+
+    // The copies are made by threads pinned to their nodes, whose first
+    // touch places the pages there.
+    LOG_TRACE("Copying point sections to the NUMA nodes");
+    onNumaNodes([&] (NumaPart &part, size_t k) {
+        part.pointsA.assign(pointsA + part.varsFrom, pointsA + part.varsFrom + part.varsCount);
+        part.pointsB1.assign(pointsB1 + part.varsFrom, pointsB1 + part.varsFrom + part.varsCount);
+        part.pointsB2.assign(pointsB2 + part.varsFrom, pointsB2 + part.varsFrom + part.varsCount);
+        part.pointsC.assign(pointsC + part.cFrom, pointsC + part.cFrom + part.cCount);
+        part.pointsH.assign(pointsH + part.hFrom, pointsH + part.hFrom + part.hCount);
+
+        if (options.glv == GlvPrecomputed) {
+            mapEndomorphism(part.endoPointsA, g1Endomorphism, part.pointsA.data(), part.varsCount);
+            mapEndomorphism(part.endoPointsB1, g1Endomorphism, part.pointsB1.data(), part.varsCount);
+            mapEndomorphism(part.endoPointsB2, g2Endomorphism, part.pointsB2.data(), part.varsCount);
+            mapEndomorphism(part.endoPointsC, g1Endomorphism, part.pointsC.data(), part.cCount);
+            mapEndomorphism(part.endoPointsH, g1Endomorphism, part.pointsH.data(), part.hCount);
         }
     });
-    LOG_TRACE("b After shift:");
-    LOG_DEBUG(E.fr.toString(b[0]).c_str());
-    LOG_DEBUG(E.fr.toString(b[1]).c_str());
-    LOG_TRACE("Start FFT B");
-    fft->fft(b, domainSize);
-    LOG_TRACE("b After fft:");
-    LOG_DEBUG(E.fr.toString(b[0]).c_str());
-    LOG_DEBUG(E.fr.toString(b[1]).c_str());
-
-    LOG_TRACE("Start iFFT C");
-    fft->ifft(c, domainSize);
-    LOG_TRACE("c After ifft:");
-    LOG_DEBUG(E.fr.toString(c[0]).c_str());
-    LOG_DEBUG(E.fr.toString(c[1]).c_str());
-    LOG_TRACE("Start Shift C");
-    threadPool.parallelFor(0, domainSize, [&] (int64_t begin, int64_t end, uint64_t idThread) {
-        for (u_int64_t i=begin; i<end; i++) {
-            E.fr.mul(c[i], c[i], fft->root(domainPower+1, i));
+}
+
+template <typename Engine>
+template <typename Curve>
+MultiExp::Pippenger<Curve> Prover<Engine>::numaMultiexp(
+    Curve &g,
+    typename BatchAffine::CurveField<Curve>::Type &F,
+    NumaPart &part,
+    MultiExp::CurveGroup group,
+    MultiExp::DigitCache *digitCache)
+{
+    MultiExp::Pippenger<Curve> msm(g, F, *part.pool, part.node.cpus.size(), options.signedDigits, digitCache);
+
+    msm.setWindowTable(&tuning.table(group));
+    return msm;
+}
+
+template <typename Engine>
+void Prover<Engine>::numaMultiexps(
+    typename Engine::G1Point *pi_a,
+    typename Engine::G1Point *pib1,
+    typename Engine::G2Point *pi_b,
+    typename Engine::G1Point *pi_c,
+    const std::vector<uint8_t *> &scalars,
+    const WitnessProfiles &profiles,
+    ScratchSet &scratch)
+{
+    const uint64_t sW = sizeof(typename Engine::FrElement);
+    const u_int32_t nWitnesses = scalars.size();
+    const size_t nParts = numaParts.size();
+
+    // partials[k*3 + m] holds the results of part k for A, B1 and C.
+    std::vector<std::vector<typename Engine::G1Point>> partials(nParts * 3);
+    std::vector<std::vector<typename Engine::G2Point>> partialsB2(nParts);
+
+    onNumaNodes([&] (NumaPart &part, size_t k) {
+        const u_int64_t fromC = nPublic + 1 + part.cFrom;
+        std::vector<uint8_t *> partScalars(nWitnesses);
+        std::vector<uint8_t *> partScalarsC(nWitnesses);
+
+        for (u_int32_t w=0; w<nWitnesses; w++) {
+            partScalars[w] = scalars[w] + part.varsFrom*sW;
+            partScalarsC[w] = scalars[w] + fromC*sW;
+        }
+
+        WitnessProfiles partProfiles;
+
+        if (options.witnessProfile) {
+            profiles.a.slice(partProfiles.a, part.varsFrom, part.varsCount);
+            profiles.b1.slice(partProfiles.b1, part.varsFrom, part.varsCount);
+            profiles.b2.slice(partProfiles.b2, part.varsFrom, part.varsCount);
+            profiles.c.slice(partProfiles.c, part.cFrom, part.cCount);
         }
+
+        const MultiExp::GlvScalars glvScalars = scratch.glvWitness.offset(part.varsFrom);
+        const MultiExp::GlvScalars glvScalarsC = scratch.glvWitness.offset(fromC);
+
+        // A, B1, B2 and C share the window digits of the witness, decoded
+        // over the vars of the part and those of its share of C.
+        const u_int64_t digitsFrom = std::min(part.varsFrom, fromC);
+        const u_int64_t digitsTo = std::max(part.varsFrom + part.varsCount, fromC + part.cCount);
+
+        MultiExp::DigitCache digitCache;
+        shareWitnessDigits(digitCache, scalars, scratch.glvWitness, digitsFrom, digitsTo - digitsFrom);
+        auto g1Msm = numaMultiexp(E.g1, E.f1, part, MultiExp::GroupG1, &digitCache);
+        auto g2Msm = numaMultiexp(E.g2, E.f2, part, MultiExp::GroupG2, &digitCache);
+
+        g1Msm.setMemoryLimit(scratch.numaLimits[k].g1);
+        g2Msm.setMemoryLimit(scratch.numaLimits[k].g2);
+
+        std::vector<typename Engine::G1Point> &a = partials[k*3];
+        std::vector<typename Engine::G1Point> &b1 = partials[k*3 + 1];
+        std::vector<typename Engine::G1Point> &c = partials[k*3 + 2];
+        std::vector<typename Engine::G2Point> &b2 = partialsB2[k];
+
+        a.resize(nWitnesses);
+        b1.resize(nWitnesses);
+        c.resize(nWitnesses);
+        b2.resize(nWitnesses);
+
+        multiexp(g1Msm, MultiexpA, a.data(), part.pointsA.data(), partScalars, part.varsCount, partProfiles.a,
+                 glvInput(g1Endomorphism, part.endoPointsA, glvScalars), part.shiftedA, scratch.numaG1Buckets[k]);
+        multiexp(g1Msm, MultiexpB1, b1.data(), part.pointsB1.data(), partScalars, part.varsCount, partProfiles.b1,
+                 glvInput(g1Endomorphism, part.endoPointsB1, glvScalars), part.shiftedB1, scratch.numaG1Buckets[k]);
+        multiexp(g2Msm, MultiexpB2, b2.data(), part.pointsB2.data(), partScalars, part.varsCount, partProfiles.b2,
+                 glvInput(g2Endomorphism, part.endoPointsB2, glvScalars), part.shiftedB2, scratch.numaG2Buckets[k]);
+        multiexp(g1Msm, MultiexpC, c.data(), part.pointsC.data(), partScalarsC, part.cCount, partProfiles.c,
+                 glvInput(g1Endomorphism, part.endoPointsC, glvScalarsC), part.shiftedC, scratch.numaG1Buckets[k]);
     });
-    LOG_TRACE("c After shift:");
-    LOG_DEBUG(E.fr.toString(c[0]).c_str());
-    LOG_DEBUG(E.fr.toString(c[1]).c_str());
-    LOG_TRACE("Start FFT C");
-    fft->fft(c, domainSize);
-    LOG_TRACE("c After fft:");
-    LOG_DEBUG(E.fr.toString(c[0]).c_str());
-    LOG_DEBUG(E.fr.toString(c[1]).c_str());
-
-    LOG_TRACE("Start ABC");
-    threadPool.parallelFor(0, domainSize, [&] (int64_t begin, int64_t end, uint64_t idThread) {
-        for (u_int64_t i=begin; i<end; i++) {
-            E.fr.mul(a[i], a[i], b[i]);
-            E.fr.sub(a[i], a[i], c[i]);
-            E.fr.fromMontgomery(a[i], a[i]);
+
+    for (u_int32_t w=0; w<nWitnesses; w++) {
+        E.g1.copy(pi_a[w], E.g1.zero());
+        E.g1.copy(pib1[w], E.g1.zero());
+        E.g2.copy(pi_b[w], E.g2.zero());
+        E.g1.copy(pi_c[w], E.g1.zero());
+
+        for (size_t k=0; k<nParts; k++) {
+            E.g1.add(pi_a[w], pi_a[w], partials[k*3][w]);
+            E.g1.add(pib1[w], pib1[w], partials[k*3 + 1][w]);
+            E.g2.add(pi_b[w], pi_b[w], partialsB2[k][w]);
+            E.g1.add(pi_c[w], pi_c[w], partials[k*3 + 2][w]);
         }
+    }
+}
+
+template <typename Engine>
+typename Prover<Engine>::ScratchSet *Prover<Engine>::createScratchSet(u_int32_t batchSize) {
+
+    const uint64_t sW = sizeof(typename Engine::FrElement);
+    ScratchArena::Layout layout;
+
+    const MemoryPlan plan = planMemory(batchSize);
+    std::vector<size_t> idA(batchSize);
+    std::vector<size_t> idB(batchSize);
+
+    for (u_int32_t w=0; w<batchSize; w++) {
+        idA[w] = layout.add(domainSize * sW);
+    }
+
+    // The b vectors and c are laid out in one run for the H buckets.
+    for (u_int32_t w=0; w<batchSize; w++) {
+        idB[w] = layout.add(domainSize * sW);
+    }
+    const size_t idC = layout.add(domainSize * sW);
+
+    const bool glv = options.glv != GlvOff;
+    std::vector<size_t> idGlvHalves;
+    std::vector<size_t> idGlvNegative;
+    std::vector<size_t> idGlvNegativeH;
+
+    if (glv) {
+        for (u_int32_t w=0; w<batchSize; w++) {
+            idGlvHalves.push_back(layout.add(2 * nVars * MultiExp::GlvSplit::halfSize));
+            idGlvNegative.push_back(layout.add(2 * nVars));
+            idGlvNegativeH.push_back(layout.add(2 * domainSize));
+        }
+    }
+
+    // The bucket areas are those of the memory plan. In NUMA mode they are
+    // taken from the buffers of the nodes.
+    const bool hInBC = plan.areas.h <= (u_int64_t)(batchSize + 1) * domainSize * sW;
+    const size_t idG1 = layout.add(plan.areas.g1);
+    const size_t idG2 = layout.add(plan.areas.g2);
+    const size_t idH = layout.add(hInBC ? 0 : plan.areas.h);
+
+    LOG_TRACE("Allocating scratch set");
+    ScratchSet *set = new ScratchSet(layout.size(), batchSize, options.hugePages);
+
+    for (u_int32_t w=0; w<batchSize; w++) {
+        set->a[w] = (typename Engine::FrElement *)layout.region(set->buffer, idA[w]);
+        set->b[w] = (typename Engine::FrElement *)layout.region(set->buffer, idB[w]);
+    }
+
+    set->c = (typename Engine::FrElement *)layout.region(set->buffer, idC);
+    set->g1Buckets = layout.region(set->buffer, idG1);
+    set->g2Buckets = layout.region(set->buffer, idG2);
+    set->hBuckets = hInBC ? (void *)set->b[0] : layout.region(set->buffer, idH);
+    set->limits = plan.limits;
+    set->numaLimits = plan.numaLimits;
+
+    if (glv) {
+        for (u_int32_t w=0; w<batchSize; w++) {
+            set->glvWitness.halves.push_back((uint8_t *)layout.region(set->buffer, idGlvHalves[w]));
+            set->glvWitness.negative.push_back((uint8_t *)layout.region(set->buffer, idGlvNegative[w]));
+            set->glvH.halves.push_back((uint8_t *)set->a[w]);
+            set->glvH.negative.push_back((uint8_t *)layout.region(set->buffer, idGlvNegativeH[w]));
+        }
+    }
+
+    for (size_t k=0; k<numaParts.size(); k++) {
+        NumaPart *part = numaParts[k].get();
+        ScratchArena::Layout partLayout;
+
+        const size_t idPartG1 = partLayout.add(plan.numaAreas[k].g1);
+        const size_t idPartG2 = partLayout.add(plan.numaAreas[k].g2);
+        const size_t idPartH = partLayout.add(plan.numaAreas[k].h);
+
+        set->numaBuffers.emplace_back(new ScratchArena::Buffer(partLayout.size(), *part->pool, options.hugePages));
+        set->numaG1Buckets.push_back(partLayout.region(*set->numaBuffers.back(), idPartG1));
+        set->numaG2Buckets.push_back(partLayout.region(*set->numaBuffers.back(), idPartG2));
+        set->numaHBuckets.push_back(partLayout.region(*set->numaBuffers.back(), idPartH));
+    }
+
+    u_int64_t hugePageBytes = set->buffer.hugePageBytes();
+
+    for (auto &buffer : set->numaBuffers) {
+        hugePageBytes += buffer->hugePageBytes();
+    }
+    scratchHugePageBytes = hugePageBytes;
+
+    return set;
+}
+
+template <typename Engine>
+u_int64_t Prover<Engine>::fixedMemory(u_int32_t batchSize) const {
+
+    const uint64_t sW = sizeof(typename Engine::FrElement);
+    const uint64_t sG1 = sizeof(typename Engine::G1PointAffine);
+    const uint64_t sG2 = sizeof(typename Engine::G2PointAffine);
+    const u_int64_t nC = nVars - nPublic - 1;
+
+    // The coefficients and the point sections, in the zkey or copied out
+    // of it, and the copies of the sections.
+    u_int64_t size = nCoefs * sizeof(Coef<Engine>) + (2*nVars + nC + domainSize) * sG1 + nVars * sG2;
+
+    size += (endoPointsA.size() + endoPointsB1.size() + endoPointsC.size() + endoPointsH.size()) * sG1
+            + endoPointsB2.size() * sG2;
+    size += getShiftedBasesSize();
+
+    for (const auto &part : numaParts) {
+        size += (part->pointsA.size() + part->pointsB1.size() + part->pointsC.size() + part->pointsH.size()
+                 + part->endoPointsA.size() + part->endoPointsB1.size() + part->endoPointsC.size()
+                 + part->endoPointsH.size()) * sG1
+                + (part->pointsB2.size() + part->endoPointsB2.size()) * sG2;
+    }
+
+    if (!coefPartition.empty()) {
+        size += nCoefs * sizeof(u_int32_t);
+    }
+
+    // The witnesses and the a, b and c vectors, with the split witnesses
+    // and the signs of the GLV mode.
+    size += (u_int64_t)batchSize * nVars * sW;
+    size += (2 * (u_int64_t)batchSize + 1) * domainSize * sW;
+
+    if (options.glv != GlvOff) {
+        size += (u_int64_t)batchSize * (2 * nVars * (MultiExp::GlvSplit::halfSize + 1) + 2 * domainSize);
+    }
+
+    return size;
+}
+
+template <typename Engine>
+u_int64_t Prover<Engine>::witnessDigitsMemory(
+    const MultiExp::Pippenger<typename Engine::G1> &g1Msm,
+    const MultiExp::Pippenger<typename Engine::G2> &g2Msm,
+    u_int64_t n,
+    u_int32_t batchSize)
+{
+    const uint64_t sW = sizeof(typename Engine::FrElement);
+
+    // The full scalars, or their GLV halves, and the short ones are
+    // decoded once for every window width among the two groups.
+    std::vector<std::pair<u_int64_t, u_int64_t>> classes;
+
+    if (options.glv != GlvOff && options.shiftedCopies <= 1) {
+        classes.push_back(std::make_pair(MultiExp::GlvSplit::halfSize*8, 2*n));
+    } else {
+        classes.push_back(std::make_pair(sW*8, n));
+    }
+
+    if (options.witnessProfile) {
+        classes.push_back(std::make_pair(MultiExp::shortScalarBits, n));
+    }
+
+    u_int64_t size = 0;
+
+    for (const auto &c : classes) {
+        const u_int64_t g1Bits = g1Msm.windowWidth(c.first, c.second, batchSize);
+        const u_int64_t g2Bits = g2Msm.windowWidth(c.first, c.second, batchSize);
+
+        size += batchSize * c.second * MultiExp::windowCount(c.first, g1Bits, options.signedDigits) * sizeof(uint16_t);
+
+        if (g2Bits != g1Bits) {
+            size += batchSize * c.second * MultiExp::windowCount(c.first, g2Bits, options.signedDigits) * sizeof(uint16_t);
+        }
+    }
+
+    return size;
+}
+
+template <typename Engine>
+template <typename Curve>
+u_int64_t Prover<Engine>::multiexpMemory(
+    MultiExp::Pippenger<Curve> &msm,
+    bool batchAffine,
+    u_int64_t n,
+    u_int32_t batchSize,
+    u_int64_t reused,
+    u_int64_t &limit,
+    u_int64_t &area)
+{
+    const uint64_t sW = sizeof(typename Engine::FrElement);
+    const bool glv = options.glv != GlvOff;
+
+    msm.setBatchAffine(batchAffine);
+    msm.setMemoryLimit(0);
+
+    // A limit the multiexp fits without one would only widen its area.
+    if (limit >= msm.memorySize(sW, n, batchSize, glv)) {
+        limit = 0;
+    }
+    msm.setMemoryLimit(limit);
+    area = msm.scratchSize(sW, n, batchSize, glv);
+
+    const u_int64_t size = msm.memorySize(sW, n, batchSize, glv);
+
+    return area <= reused ? size - area : size;
+}
+
+template <typename Engine>
+void Prover<Engine>::planMultiexps(MemoryPlan &plan, u_int32_t batchSize, u_int64_t limit) {
+
+    const uint64_t sW = sizeof(typename Engine::FrElement);
+    const unsigned int affine = options.batchAffine;
+    const unsigned int affineG1 = affine & (MultiexpA | MultiexpB1 | MultiexpC);
+
+    // Stands for the digits of the witness, which are counted apart.
+    MultiExp::DigitCache digitCache;
+
+    plan.multiexps = 0;
+    plan.limits = BucketBytes();
+    plan.areas = BucketBytes();
+    plan.numaLimits.clear();
+    plan.numaAreas.clear();
+
+    if (!options.numa) {
+        // H runs after the b and c vectors are done with, so its buckets
+        // may take their place.
+        const u_int64_t bc = (u_int64_t)(batchSize + 1) * domainSize * sW;
+        auto g1Msm = g1Multiexp(&digitCache);
+        auto g2Msm = g2Multiexp(&digitCache);
+        auto hMsm = hMultiexp();
+
+        plan.limits.g1 = limit;
+        plan.limits.g2 = limit;
+        plan.limits.h = limit ? std::max(limit, bc) : 0;
+
+        plan.multiexps += multiexpMemory(g1Msm, affineG1, nVars, batchSize, 0, plan.limits.g1, plan.areas.g1);
+        plan.multiexps += multiexpMemory(g2Msm, affine & MultiexpB2, nVars, batchSize, 0, plan.limits.g2, plan.areas.g2);
+        plan.multiexps += multiexpMemory(hMsm, affine & MultiexpH, domainSize, batchSize, bc, plan.limits.h, plan.areas.h);
+        plan.multiexps += witnessDigitsMemory(g1Msm, g2Msm, nVars, batchSize);
+        return;
+    }
+
+    for (auto &part : numaParts) {
+        const u_int64_t fromC = nPublic + 1 + part->cFrom;
+        const u_int64_t nDigits = std::max(part->varsFrom + part->varsCount, fromC + part->cCount)
+                                  - std::min(part->varsFrom, fromC);
+        auto g1Msm = numaMultiexp(E.g1, E.f1, *part, MultiExp::GroupG1, &digitCache);
+        auto g2Msm = numaMultiexp(E.g2, E.f2, *part, MultiExp::GroupG2, &digitCache);
+        auto hMsm = numaMultiexp(E.g1, E.f1, *part, MultiExp::GroupG1);
+        BucketBytes limits;
+        BucketBytes areas;
+
+        limits.g1 = limit;
+        limits.g2 = limit;
+        limits.h = limit;
+
+        plan.multiexps += multiexpMemory(g1Msm, affineG1, std::max(part->varsCount, part->cCount), batchSize, 0,
+                                         limits.g1, areas.g1);
+        plan.multiexps += multiexpMemory(g2Msm, affine & MultiexpB2, part->varsCount, batchSize, 0, limits.g2, areas.g2);
+        plan.multiexps += multiexpMemory(hMsm, affine & MultiexpH, part->hCount, batchSize, 0, limits.h, areas.h);
+        plan.multiexps += witnessDigitsMemory(g1Msm, g2Msm, nDigits, batchSize);
+        plan.numaLimits.push_back(limits);
+        plan.numaAreas.push_back(areas);
+    }
+}
+
+template <typename Engine>
+typename Prover<Engine>::MemoryPlan Prover<Engine>::planMemory(u_int32_t batchSize) {
+
+    MemoryPlan plan;
+
+    plan.fixed = fixedMemory(batchSize);
+    planMultiexps(plan, batchSize, 0);
+
+    if (options.memoryBudget == 0 || plan.peak() <= options.memoryBudget) {
+        return plan;
+    }
+
+    // Every pass of the multiexps keeps its memory within one limit, the
+    // largest found that keeps the proof within the budget. If none does,
+    // the plan of the least peak is taken.
+    MemoryPlan fits;
+    MemoryPlan least = plan;
+    bool found = false;
+    u_int64_t low = 0;
+    u_int64_t high = plan.peak();
+
+    while (high - low > 1) {
+        const u_int64_t limit = low + (high - low) / 2;
+
+        planMultiexps(plan, batchSize, limit);
+        if (plan.peak() <= options.memoryBudget) {
+            fits = plan;
+            found = true;
+            low = limit;
+        } else {
+            high = limit;
+        }
+
+        if (plan.peak() < least.peak()) {
+            least = plan;
+        }
+    }
+
+    if (found) {
+        return fits;
+    }
+
+    std::ostringstream ss;
+    ss << "proofs take " << least.peak() << " bytes, past the memory budget of " << options.memoryBudget;
+    LOG_DEBUG(ss);
+
+    return least;
+}
+
+template <typename Engine>
+void Prover<Engine>::shiftBases() {
+
+    const uint64_t sW = sizeof(typename Engine::FrElement);
+    const u_int64_t nCopies = options.shiftedCopies > 1 ? options.shiftedCopies : 1;
+
+    // In NUMA mode only the nodes keep shifted copies, of their parts.
+    const u_int64_t globalCopies = options.numa ? 1 : nCopies;
+
+    LOG_TRACE("Shifting point sections");
+    g1Multiexp().shiftBases(shiftedA, pointsA, sW, nVars, globalCopies);
+    g1Multiexp().shiftBases(shiftedB1, pointsB1, sW, nVars, globalCopies);
+    g2Multiexp().shiftBases(shiftedB2, pointsB2, sW, nVars, globalCopies);
+    g1Multiexp().shiftBases(shiftedC, pointsC, sW, nVars - nPublic - 1, globalCopies);
+    hMultiexp().shiftBases(shiftedH, pointsH, sW, domainSize, globalCopies);
+
+    shiftedA.points.shrink_to_fit();
+    shiftedB1.points.shrink_to_fit();
+    shiftedB2.points.shrink_to_fit();
+    shiftedC.points.shrink_to_fit();
+    shiftedH.points.shrink_to_fit();
+
+    onNumaNodes([&] (NumaPart &part, size_t k) {
+        numaMultiexp(E.g1, E.f1, part, MultiExp::GroupG1).shiftBases(part.shiftedA, part.pointsA.data(), sW, part.varsCount, nCopies);
+        numaMultiexp(E.g1, E.f1, part, MultiExp::GroupG1).shiftBases(part.shiftedB1, part.pointsB1.data(), sW, part.varsCount, nCopies);
+        numaMultiexp(E.g2, E.f2, part, MultiExp::GroupG2).shiftBases(part.shiftedB2, part.pointsB2.data(), sW, part.varsCount, nCopies);
+        numaMultiexp(E.g1, E.f1, part, MultiExp::GroupG1).shiftBases(part.shiftedC, part.pointsC.data(), sW, part.cCount, nCopies);
+        numaMultiexp(E.g1, E.f1, part, MultiExp::GroupG1).shiftBases(part.shiftedH, part.pointsH.data(), sW, part.hCount, nCopies);
     });
-    LOG_TRACE("abc:");
-    LOG_DEBUG(E.fr.toString(a[0]).c_str());
-    LOG_DEBUG(E.fr.toString(a[1]).c_str());
+}
 
-    delete [] b;
-    delete [] c;
+template <typename Engine>
+void Prover<Engine>::placeSections() {
 
-    LOG_TRACE("Start Multiexp H");
-    typename Engine::G1Point pih;
-    E.g1.multiMulByScalarMSM(pih, pointsH, (uint8_t *)a, sizeof(a[0]), domainSize);
-    std::ostringstream ss1;
-    ss1 << "pih: " << E.g1.toString(pih);
-    LOG_DEBUG(ss1);
+    pointsA = zkeyPointsA;
+    pointsB1 = zkeyPointsB1;
+    pointsB2 = zkeyPointsB2;
+    pointsC = zkeyPointsC;
+    pointsH = zkeyPointsH;
+    hugeSections.reset();
 
-    delete [] a;
+    if (options.hugePages == ScratchArena::SmallPages) {
+        return;
+    }
 
+    const u_int64_t sG1 = sizeof(typename Engine::G1PointAffine);
+    const u_int64_t sG2 = sizeof(typename Engine::G2PointAffine);
+    const u_int64_t nC = nVars - nPublic - 1;
+    ScratchArena::Layout layout;
+
+    const size_t idA = layout.add(nVars * sG1);
+    const size_t idB1 = layout.add(nVars * sG1);
+    const size_t idB2 = layout.add(nVars * sG2);
+    const size_t idC = layout.add(nC * sG1);
+    const size_t idH = layout.add(domainSize * sG1);
+
+    LOG_TRACE("Copying point sections to huge pages");
+    hugeSections.reset(new ScratchArena::Buffer(layout.size(), ThreadPool::defaultPool(), options.hugePages));
+
+    struct Section {
+        void *to;
+        const void *from;
+        u_int64_t size;
+    };
+
+    const Section sections[] = {
+        {layout.region(*hugeSections, idA), zkeyPointsA, nVars * sG1},
+        {layout.region(*hugeSections, idB1), zkeyPointsB1, nVars * sG1},
+        {layout.region(*hugeSections, idB2), zkeyPointsB2, nVars * sG2},
+        {layout.region(*hugeSections, idC), zkeyPointsC, nC * sG1},
+        {layout.region(*hugeSections, idH), zkeyPointsH, domainSize * sG1}
+    };
+
+    const u_int64_t blockSize = 1 << 20;
+
+    for (const Section &section : sections) {
+        const int64_t nBlocks = (section.size + blockSize - 1) / blockSize;
+
+        ThreadPool::defaultPool().parallelFor(0, nBlocks, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+            const u_int64_t from = begin * blockSize;
+            const u_int64_t to = std::min<u_int64_t>(section.size, end * blockSize);
+
+            std::memcpy((uint8_t *)section.to + from, (const uint8_t *)section.from + from, to - from);
+        });
+    }
+
+    pointsA = (typename Engine::G1PointAffine *)sections[0].to;
+    pointsB1 = (typename Engine::G1PointAffine *)sections[1].to;
+    pointsB2 = (typename Engine::G2PointAffine *)sections[2].to;
+    pointsC = (typename Engine::G1PointAffine *)sections[3].to;
+    pointsH = (typename Engine::G1PointAffine *)sections[4].to;
+
+    std::ostringstream ss;
+    ss << "point sections: " << layout.size() << " bytes, in huge pages: " << hugeSections->hugePageBytes();
+    LOG_DEBUG(ss);
+}
+
+template <typename Engine>
+void Prover<Engine>::warmUp(bool lock, const Residency::Progress &progress) {
+
+    const u_int64_t sG1 = sizeof(typename Engine::G1PointAffine);
+    const u_int64_t sG2 = sizeof(typename Engine::G2PointAffine);
+    const u_int64_t nC = nVars - nPublic - 1;
+
+    const std::vector<Residency::Range> ranges = {
+        {coefs, nCoefs * sizeof(Coef<Engine>)},
+        {pointsA, nVars * sG1},
+        {pointsB1, nVars * sG1},
+        {pointsB2, nVars * sG2},
+        {pointsC, nC * sG1},
+        {pointsH, domainSize * sG1}
+    };
+
+    LOG_TRACE("Warming up the zkey sections");
+    resident.warmUp(ranges, lock, ThreadPool::defaultPool(), progress);
+
+    std::ostringstream ss;
+    ss << "warm: " << resident.warmBytes() << " bytes, locked: " << resident.lockedBytes();
+    LOG_DEBUG(ss);
+}
+
+template <typename Engine>
+u_int64_t Prover<Engine>::getShiftedBasesSize() const {
+    u_int64_t size = (shiftedA.points.size() + shiftedB1.points.size() + shiftedC.points.size() + shiftedH.points.size())
+                         * sizeof(typename Engine::G1PointAffine)
+                     + shiftedB2.points.size() * sizeof(typename Engine::G2PointAffine);
+
+    for (const auto &part : numaParts) {
+        size += (part->shiftedA.points.size() + part->shiftedB1.points.size() + part->shiftedC.points.size()
+                 + part->shiftedH.points.size()) * sizeof(typename Engine::G1PointAffine)
+                + part->shiftedB2.points.size() * sizeof(typename Engine::G2PointAffine);
+    }
+    return size;
+}
+
+template <typename Engine>
+MultiExp::Pippenger<typename Engine::G1> Prover<Engine>::g1Multiexp(MultiExp::DigitCache *digitCache) {
+    ThreadPool &pool = options.taskGraph ? *g1Pool : ThreadPool::defaultPool();
+    MultiExp::Pippenger<typename Engine::G1> msm(E.g1, E.f1, pool, options.taskGraph ? g1Threads : nThreads,
+                                                 options.signedDigits, digitCache);
+
+    msm.setWindowTable(&tuning.table(MultiExp::GroupG1));
+    return msm;
+}
+
+template <typename Engine>
+MultiExp::Pippenger<typename Engine::G2> Prover<Engine>::g2Multiexp(MultiExp::DigitCache *digitCache) {
+    ThreadPool &pool = options.taskGraph ? *g2Pool : ThreadPool::defaultPool();
+    MultiExp::Pippenger<typename Engine::G2> msm(E.g2, E.f2, pool, options.taskGraph ? g2Threads : nThreads,
+                                                 options.signedDigits, digitCache);
+
+    msm.setWindowTable(&tuning.table(MultiExp::GroupG2));
+    return msm;
+}
+
+template <typename Engine>
+MultiExp::Pippenger<typename Engine::G1> Prover<Engine>::hMultiexp() {
+    ThreadPool &pool = options.taskGraph ? *hPool : ThreadPool::defaultPool();
+    MultiExp::Pippenger<typename Engine::G1> msm(E.g1, E.f1, pool, options.taskGraph ? hThreads : nThreads,
+                                                 options.signedDigits);
+
+    msm.setWindowTable(&tuning.table(MultiExp::GroupG1));
+    return msm;
+}
+
+template <typename Engine>
+void Prover<Engine>::tune(const std::string &profilePath) {
+
+    const uint64_t sW = sizeof(typename Engine::FrElement);
+    const u_int64_t nC = nVars - nPublic - 1;
+
+    tuning.load(profilePath);
+
+    // Full-width random scalars below the group order.
+    std::vector<uint8_t> scalars(std::max<u_int64_t>(nVars, domainSize) * sW);
+
+    randombytes_buf(scalars.data(), scalars.size());
+    for (u_int64_t i = sW - 1; i < scalars.size(); i += sW) {
+        scalars[i] &= 0x1f;
+    }
+
+    // Every size is timed once per curve group, on the multiexp that runs
+    // it first in a proof.
+    LOG_TRACE("Tuning multiexp windows");
+    auto msmA = g1Multiexp();
+    msmA.setBatchAffine(options.batchAffine & MultiexpA);
+    msmA.tune(tuning.table(MultiExp::GroupG1), pointsA, scalars.data(), sW, nVars);
+
+    auto msmB2 = g2Multiexp();
+    msmB2.setBatchAffine(options.batchAffine & MultiexpB2);
+    msmB2.tune(tuning.table(MultiExp::GroupG2), pointsB2, scalars.data(), sW, nVars);
+
+    auto msmC = g1Multiexp();
+    msmC.setBatchAffine(options.batchAffine & MultiexpC);
+    msmC.tune(tuning.table(MultiExp::GroupG1), pointsC, scalars.data(), sW, nC);
+
+    auto msmH = hMultiexp();
+    msmH.setBatchAffine(options.batchAffine & MultiexpH);
+    msmH.tune(tuning.table(MultiExp::GroupG1), pointsH, scalars.data(), sW, domainSize);
+
+    // The NUMA parts run their shares on their own pools. They are tuned
+    // one at a time from threads pinned to their nodes; parts of the same
+    // size share their choices.
+    for (auto &part : numaParts) {
+        std::async(std::launch::async, [&] () {
+            Numa::pinThread(part->node);
+
+            auto g1Msm = numaMultiexp(E.g1, E.f1, *part, MultiExp::GroupG1);
+            auto g2Msm = numaMultiexp(E.g2, E.f2, *part, MultiExp::GroupG2);
+
+            g1Msm.setBatchAffine(options.batchAffine & MultiexpA);
+            g1Msm.tune(tuning.table(MultiExp::GroupG1), part->pointsA.data(), scalars.data(), sW, part->varsCount);
+            g2Msm.setBatchAffine(options.batchAffine & MultiexpB2);
+            g2Msm.tune(tuning.table(MultiExp::GroupG2), part->pointsB2.data(), scalars.data(), sW, part->varsCount);
+            g1Msm.setBatchAffine(options.batchAffine & MultiexpC);
+            g1Msm.tune(tuning.table(MultiExp::GroupG1), part->pointsC.data(), scalars.data(), sW, part->cCount);
+            g1Msm.setBatchAffine(options.batchAffine & MultiexpH);
+            g1Msm.tune(tuning.table(MultiExp::GroupG1), part->pointsH.data(), scalars.data(), sW, part->hCount);
+        }).get();
+    }
+
+    tuning.save(profilePath);
+
+    // The bucket areas and the shifts depend on the window widths.
+    scratchPool.reset(options.scratchSets);
+
+    if (options.shiftedCopies > 1) {
+        shiftBases();
+    }
+}
+
+template <typename Engine>
+CosetFFT<typename Engine::Fr> &Prover<Engine>::getCosetFft()
+{
+    std::lock_guard<std::mutex> guard(cosetFftMutex);
+
+    if (!cosetFft) {
+        LOG_TRACE("Initializing fft");
+        cosetFft = CosetFFTCache<typename Engine::Fr>::get(domainSize);
+    }
+
+    return *cosetFft;
+}
+
+template <typename Engine>
+void Prover<Engine>::computeH(const std::vector<typename Engine::FrElement *> &wtns, ScratchSet &scratch)
+{
+    ThreadPool &threadPool = hThreadPool();
+    CosetFFT<typename Engine::Fr> &coset = getCosetFft();
+
+    const u_int32_t nWitnesses = wtns.size();
+    typename Engine::FrElement **a = scratch.a.data();
+    typename Engine::FrElement **b = scratch.b.data();
+    typename Engine::FrElement *c = scratch.c;
+
+    if (coefPartition.empty()) {
+        threadPool.parallelFor(0, domainSize, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+            for (u_int32_t w=0; w<nWitnesses; w++) {
+                for (u_int32_t i=begin; i<end; i++) {
+                    E.fr.copy(a[w][i], E.fr.zero());
+                    E.fr.copy(b[w][i], E.fr.zero());
+                }
+            }
+        });
+
+        LOG_TRACE("Processing coefs");
+
+        #define NLOCKS 1024
+        std::vector<std::mutex> locks(NLOCKS);
+
+        threadPool.parallelFor(0, nCoefs, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+            for (u_int64_t i=begin; i<end; i++) {
+                typename Engine::FrElement **ab = (coefs[i].m == 0) ? a : b;
+                typename Engine::FrElement aux;
+
+                std::lock_guard<std::mutex> guard(locks[coefs[i].c % NLOCKS]);
+
+                for (u_int32_t w=0; w<nWitnesses; w++) {
+                    frMul.mul(
+                        aux,
+                        wtns[w][coefs[i].s],
+                        coefs[i].coef
+                    );
+
+                    E.fr.add(
+                        ab[w][coefs[i].c],
+                        ab[w][coefs[i].c],
+                        aux
+                    );
+                }
+            }
+        });
+
+        LOG_TRACE("Calculating c");
+        threadPool.parallelFor(0, domainSize, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+            frBatch.mul(c + begin, a[0] + begin, b[0] + begin, end - begin);
+        });
+
+    } else {
+        LOG_TRACE("Processing coefs");
+
+        // Every partition owns a range of constraints, so its entries of a
+        // and b are written by a single thread and need no locking. The c
+        // of the first witness is computed while the range is in cache.
+        threadPool.parallelFor(0, coefPartition.size(), [&] (int64_t begin, int64_t end, uint64_t idThread) {
+            for (int64_t p=begin; p<end; p++) {
+                for (u_int32_t w=0; w<nWitnesses; w++) {
+                    for (u_int32_t i=coefPartition.constraintBegin(p); i<coefPartition.constraintEnd(p); i++) {
+                        E.fr.copy(a[w][i], E.fr.zero());
+                        E.fr.copy(b[w][i], E.fr.zero());
+                    }
+                }
+
+                // The products of a run of coefficients are gathered and
+                // multiplied as one batch, then added to their constraints.
+                const u_int64_t runSize = 64;
+                typename Engine::FrElement factors[runSize];
+                typename Engine::FrElement products[runSize];
+
+                for (u_int64_t k=coefPartition.coefBegin(p); k<coefPartition.coefEnd(p); k+=runSize) {
+                    const u_int64_t n = std::min(runSize, coefPartition.coefEnd(p) - k);
+
+                    for (u_int64_t t=0; t<n; t++) {
+                        E.fr.copy(factors[t], coefs[coefPartition.coef(k + t)].coef);
+                    }
+
+                    for (u_int32_t w=0; w<nWitnesses; w++) {
+                        for (u_int64_t t=0; t<n; t++) {
+                            E.fr.copy(products[t], wtns[w][coefs[coefPartition.coef(k + t)].s]);
+                        }
+
+                        frBatch.mul(products, products, factors, n);
+
+                        for (u_int64_t t=0; t<n; t++) {
+                            const u_int64_t i = coefPartition.coef(k + t);
+                            typename Engine::FrElement **ab = (coefs[i].m == 0) ? a : b;
+
+                            E.fr.add(
+                                ab[w][coefs[i].c],
+                                ab[w][coefs[i].c],
+                                products[t]
+                            );
+                        }
+                    }
+                }
+
+                const u_int32_t first = coefPartition.constraintBegin(p);
+                const u_int32_t last = coefPartition.constraintEnd(p);
+
+                frBatch.mul(c + first, a[0] + first, b[0] + first, last - first);
+            }
+        });
+    }
+
+    // The witnesses share one c vector, so they go through the FFTs one
+    // after another and the result of each one is left in its a vector.
+    for (u_int32_t w=0; w<nWitnesses; w++) {
+        typename Engine::FrElement *aw = a[w];
+        typename Engine::FrElement *bw = b[w];
+
+        if (w > 0) {
+            LOG_TRACE("Calculating c");
+            threadPool.parallelFor(0, domainSize, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+                frBatch.mul(c + begin, aw + begin, bw + begin, end - begin);
+            });
+        }
+
+        LOG_TRACE("Start coset FFT A, B, C");
+        typename Engine::FrElement *vectors[] = {aw, bw, c};
+        coset.extend(vectors, 3, threadPool);
+        LOG_TRACE("a After coset fft:");
+        LOG_DEBUG(E.fr.toString(aw[0]).c_str());
+        LOG_DEBUG(E.fr.toString(aw[1]).c_str());
+        LOG_TRACE("b After coset fft:");
+        LOG_DEBUG(E.fr.toString(bw[0]).c_str());
+        LOG_DEBUG(E.fr.toString(bw[1]).c_str());
+        LOG_TRACE("c After coset fft:");
+        LOG_DEBUG(E.fr.toString(c[0]).c_str());
+        LOG_DEBUG(E.fr.toString(c[1]).c_str());
+
+        LOG_TRACE("Start ABC");
+        threadPool.parallelFor(0, domainSize, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+            frBatch.mul(aw + begin, aw + begin, bw + begin, end - begin);
+            frBatch.sub(aw + begin, aw + begin, c + begin, end - begin);
+
+            for (u_int64_t i=begin; i<end; i++) {
+                E.fr.fromMontgomery(aw[i], aw[i]);
+            }
+        });
+        LOG_TRACE("abc:");
+        LOG_DEBUG(E.fr.toString(aw[0]).c_str());
+        LOG_DEBUG(E.fr.toString(aw[1]).c_str());
+    }
+}
+
+template <typename Engine>
+void Prover<Engine>::finishProof(
+    Proof<Engine> &proof,
+    typename Engine::G1Point &pi_a,
+    typename Engine::G1Point &pib1,
+    typename Engine::G2Point &pi_b,
+    typename Engine::G1Point &pi_c,
+    typename Engine::G1Point &pih)
+{
     typename Engine::FrElement r;
     typename Engine::FrElement s;
     typename Engine::FrElement rs;
@@ -255,12 +1479,102 @@ std::unique_ptr<Proof<Engine>> Prover<Engine>::prove(typename Engine::FrElement
     E.g1.mulByScalar(p1, vk_delta1, (uint8_t *)&rs, sizeof(rs));
     E.g1.sub(pi_c, pi_c, p1);
 
-    Proof<Engine> *p = new Proof<Engine>(Engine::engine);
-    E.g1.copy(p->A, pi_a);
-    E.g2.copy(p->B, pi_b);
-    E.g1.copy(p->C, pi_c);
+    E.g1.copy(proof.A, pi_a);
+    E.g2.copy(proof.B, pi_b);
+    E.g1.copy(proof.C, pi_c);
+}
 
-    return std::unique_ptr<Proof<Engine>>(p);
+template <typename Engine>
+void Prover<Engine>::setOptions(const ProverOptions &_options) {
+
+    if (_options.taskGraph) {
+        if (_options.g2CoreShare <= 0 || _options.g1CoreShare <= 0 ||
+            _options.g2CoreShare + _options.g1CoreShare > 1) {
+            throw std::invalid_argument("invalid multiexp core shares");
+        }
+    }
+
+    if (_options.scratchSets == 0) {
+        throw std::invalid_argument("invalid number of scratch sets");
+    }
+
+    if (_options.glv != GlvOff && !g1Endomorphism) {
+        g1Endomorphism.reset(new MultiExp::Endomorphism<typename Engine::G1>(E.g1));
+        g2Endomorphism.reset(new MultiExp::Endomorphism<typename Engine::G2>(E.g2));
+    }
+
+    // In NUMA mode the nodes keep the images of their parts.
+    if (_options.glv == GlvPrecomputed && !_options.numa) {
+        if (endoPointsA.empty()) {
+            LOG_TRACE("Precomputing endomorphism images");
+            mapEndomorphism(endoPointsA, g1Endomorphism, pointsA, nVars);
+            mapEndomorphism(endoPointsB1, g1Endomorphism, pointsB1, nVars);
+            mapEndomorphism(endoPointsB2, g2Endomorphism, pointsB2, nVars);
+            mapEndomorphism(endoPointsC, g1Endomorphism, pointsC, nVars - nPublic - 1);
+            mapEndomorphism(endoPointsH, g1Endomorphism, pointsH, domainSize);
+        }
+    } else {
+        std::vector<typename Engine::G1PointAffine>().swap(endoPointsA);
+        std::vector<typename Engine::G1PointAffine>().swap(endoPointsB1);
+        std::vector<typename Engine::G2PointAffine>().swap(endoPointsB2);
+        std::vector<typename Engine::G1PointAffine>().swap(endoPointsC);
+        std::vector<typename Engine::G1PointAffine>().swap(endoPointsH);
+    }
+
+    // The shifts depend on the window width and so on the digit mode.
+    const bool reshift = _options.shiftedCopies != options.shiftedCopies ||
+                         _options.signedDigits != options.signedDigits ||
+                         _options.numa != options.numa;
+
+    const bool moveSections = _options.hugePages != options.hugePages;
+
+    const bool rebuildNuma = _options.numa &&
+                             (!options.numa || (_options.glv == GlvPrecomputed) != (options.glv == GlvPrecomputed));
+
+    options = _options;
+
+    g1Pool.reset();
+    g2Pool.reset();
+    hPool.reset();
+    g1Threads = 0;
+    g2Threads = 0;
+    hThreads = 0;
+
+    if (options.taskGraph) {
+        const unsigned int nCores = std::max(1u, std::thread::hardware_concurrency());
+
+        g2Threads = std::max(1u, (unsigned int)(nCores * options.g2CoreShare));
+        g1Threads = std::max(1u, (unsigned int)(nCores * options.g1CoreShare));
+
+        // H gets the cores left by the lanes, so the three pools together
+        // do not oversubscribe the machine.
+        hThreads = nCores > g1Threads + g2Threads ? nCores - g1Threads - g2Threads : 1;
+
+        g2Pool.reset(new ThreadPool(g2Threads));
+        g1Pool.reset(new ThreadPool(g1Threads));
+        hPool.reset(new ThreadPool(hThreads));
+    }
+
+    if (moveSections) {
+        // The locks would outlive the copy the sections move out of.
+        resident.unlock();
+        placeSections();
+    }
+
+    if (!options.numa) {
+        numaParts.clear();
+    } else if (rebuildNuma) {
+        buildNumaParts();
+    }
+
+    // The bucket areas depend on the number of multiexp tasks and on the
+    // digit mode, the GLV buffers on the GLV mode, all of them on the page
+    // mode.
+    scratchPool.reset(options.scratchSets);
+
+    if (reshift || rebuildNuma) {
+        shiftBases();
+    }
 }
 
 template <typename Engine>
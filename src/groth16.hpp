@@ -3,10 +3,26 @@
 
 #include <string>
 #include <array>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
 #include <nlohmann/json.hpp>
 using json = nlohmann::json;
 
+#include <thread>
+#include <algorithm>
+
 #include "fft.hpp"
+#include "coset_fft.hpp"
+#include "threadpool.hpp"
+#include "coef_partition.hpp"
+#include "scratch_arena.hpp"
+#include "multiexp.hpp"
+#include "numa.hpp"
+#include "residency.hpp"
+#include "montgomery.hpp"
+#include "field_batch.hpp"
 
 namespace Groth16 {
 
@@ -48,6 +64,93 @@ namespace Groth16 {
     };
 #pragma pack(pop)
 
+    enum GlvMode {
+        GlvOff,
+        GlvOnTheFly,    // endomorphism images computed in the buckets
+        GlvPrecomputed  // images of all the point sections kept in memory
+    };
+
+    // Multiexps of a proof, as bits of ProverOptions::batchAffine.
+    enum ProofMultiexp {
+        MultiexpA  = 0x1,
+        MultiexpB1 = 0x2,
+        MultiexpB2 = 0x4,
+        MultiexpC  = 0x8,
+        MultiexpH  = 0x10
+    };
+
+    struct ProverOptions {
+        // Run the A, B1, B2 and C multiexps concurrently with the H
+        // polynomial pipeline instead of one stage after another.
+        bool taskGraph;
+
+        // Share of the cores given to the G2 (B2) and the G1 (A, B1, C)
+        // multiexp lanes in task-graph mode. The H pipeline runs on a pool
+        // with the remaining cores.
+        double g2CoreShare;
+        double g1CoreShare;
+
+        // Number of scratch sets (a, b, c and multiexp buckets) kept for
+        // reuse; it bounds the number of proofs running at the same time.
+        unsigned int scratchSets;
+
+        // Classify the witness before the A, B1, B2 and C multiexps, so zero
+        // scalars are skipped, ones are added up and short scalars use fewer
+        // windows.
+        bool witnessProfile;
+
+        // Split the full-width scalars of every multiexp with the BN254
+        // endomorphism into two halves of 128 bits.
+        GlvMode glv;
+
+        // Recode the multiexp windows to signed digits: half the buckets
+        // per window and one more bit per window.
+        bool signedDigits;
+
+        // ProofMultiexp bits of the multiexps whose buckets are accumulated
+        // with batch-affine additions.
+        unsigned int batchAffine;
+
+        // Keep this many copies of every point section, each shifted by a
+        // group of windows, so a multiexp doubles 1/shiftedCopies of the
+        // windows; the extra copies take shiftedCopies - 1 times the
+        // memory of the sections. 0 or 1 keeps only the sections.
+        unsigned int shiftedCopies;
+
+        // Split every multiexp by point ranges over the NUMA nodes. Each
+        // node keeps a copy of its range of the point sections (and of
+        // their endomorphism images and shifted copies) in its own memory
+        // and runs its range on a thread pool pinned to its cores. The
+        // copies take as much memory again as the sections.
+        bool numa;
+
+        // Pages of the point sections, copied out of the zkey into a
+        // buffer of such pages, and of the scratch sets. SmallPages keeps
+        // the sections in the zkey.
+        ScratchArena::PageMode hugePages;
+
+        // Bytes a proof may take at its peak, 0 for no limit. The passes
+        // of the multiexps keep their buckets and window digits within
+        // what the sections, the witness and the a, b and c vectors leave
+        // of it, taking narrower windows or fewer tasks past it (see
+        // getPeakMemory()).
+        u_int64_t memoryBudget;
+
+        ProverOptions()
+            : taskGraph(false),
+              g2CoreShare(0.25),
+              g1CoreShare(0.25),
+              scratchSets(2),
+              witnessProfile(true),
+              glv(GlvOff),
+              signedDigits(false),
+              batchAffine(0),
+              shiftedCopies(0),
+              numa(false),
+              hugePages(ScratchArena::SmallPages),
+              memoryBudget(0) {}
+    };
+
     template <typename Engine>
     class Prover {
 
@@ -62,13 +165,305 @@ namespace Groth16 {
         typename Engine::G1PointAffine &vk_delta1;
         typename Engine::G2PointAffine &vk_delta2;
         Coef<Engine> *coefs;
+        CoefPartition<Coef<Engine>> coefPartition;
         typename Engine::G1PointAffine *pointsA;
         typename Engine::G1PointAffine *pointsB1;
         typename Engine::G2PointAffine *pointsB2;
         typename Engine::G1PointAffine *pointsC;
         typename Engine::G1PointAffine *pointsH;
 
-        FFT<typename Engine::Fr> *fft;
+        // The point sections in the zkey, and their copy in huge pages.
+        typename Engine::G1PointAffine *zkeyPointsA;
+        typename Engine::G1PointAffine *zkeyPointsB1;
+        typename Engine::G2PointAffine *zkeyPointsB2;
+        typename Engine::G1PointAffine *zkeyPointsC;
+        typename Engine::G1PointAffine *zkeyPointsH;
+        std::unique_ptr<ScratchArena::Buffer> hugeSections;
+        std::atomic<u_int64_t> scratchHugePageBytes;
+
+        // Indices of the points at infinity of the A, B1 and B2 sections,
+        // found once per zkey by findZeroPoints. The witness profiles of
+        // those multiexps count their scalars as zeros, so the points are
+        // neither read nor added to a bucket.
+        std::vector<u_int32_t> zeroPointsA;
+        std::vector<u_int32_t> zeroPointsB1;
+        std::vector<u_int32_t> zeroPointsB2;
+
+        // Coefficients and point sections as faulted in and locked by
+        // warmUp. Declared after hugeSections so the locks go first.
+        Residency::Resident resident;
+
+        // Shared with the other provers of the domain size, taken from
+        // CosetFFTCache on the first proof.
+        std::shared_ptr<CosetFFT<typename Engine::Fr>> cosetFft;
+        std::mutex cosetFftMutex;
+
+        // Fr products of the coefficient pass and the ABC loops, one at a
+        // time and over arrays.
+        Montgomery::FieldMul<typename Engine::Fr> frMul;
+        FieldBatch::Batch<typename Engine::Fr> frBatch;
+
+        ProverOptions options;
+        std::unique_ptr<ThreadPool> g1Pool;
+        std::unique_ptr<ThreadPool> g2Pool;
+        std::unique_ptr<ThreadPool> hPool;
+        unsigned int g1Threads;
+        unsigned int g2Threads;
+        unsigned int hThreads;
+        unsigned int nThreads;
+
+        ThreadPool &hThreadPool() { return hPool ? *hPool : ThreadPool::defaultPool(); }
+
+        std::unique_ptr<MultiExp::Endomorphism<typename Engine::G1>> g1Endomorphism;
+        std::unique_ptr<MultiExp::Endomorphism<typename Engine::G2>> g2Endomorphism;
+        std::vector<typename Engine::G1PointAffine> endoPointsA;
+        std::vector<typename Engine::G1PointAffine> endoPointsB1;
+        std::vector<typename Engine::G2PointAffine> endoPointsB2;
+        std::vector<typename Engine::G1PointAffine> endoPointsC;
+        std::vector<typename Engine::G1PointAffine> endoPointsH;
+
+        MultiExp::ShiftedBases<typename Engine::G1> shiftedA;
+        MultiExp::ShiftedBases<typename Engine::G1> shiftedB1;
+        MultiExp::ShiftedBases<typename Engine::G2> shiftedB2;
+        MultiExp::ShiftedBases<typename Engine::G1> shiftedC;
+        MultiExp::ShiftedBases<typename Engine::G1> shiftedH;
+
+        MultiExp::TuningProfile tuning;
+
+        // Share of the multiexps taken by one NUMA node: the points
+        // [varsFrom, varsFrom + varsCount) of A, B1 and B2, [cFrom, cFrom +
+        // cCount) of C and [hFrom, hFrom + hCount) of H, copied into the
+        // memory of the node.
+        struct NumaPart {
+            Numa::Node node;
+            std::unique_ptr<ThreadPool> pool;
+            u_int64_t varsFrom;
+            u_int64_t varsCount;
+            u_int64_t cFrom;
+            u_int64_t cCount;
+            u_int64_t hFrom;
+            u_int64_t hCount;
+
+            std::vector<typename Engine::G1PointAffine> pointsA;
+            std::vector<typename Engine::G1PointAffine> pointsB1;
+            std::vector<typename Engine::G2PointAffine> pointsB2;
+            std::vector<typename Engine::G1PointAffine> pointsC;
+            std::vector<typename Engine::G1PointAffine> pointsH;
+
+            std::vector<typename Engine::G1PointAffine> endoPointsA;
+            std::vector<typename Engine::G1PointAffine> endoPointsB1;
+            std::vector<typename Engine::G2PointAffine> endoPointsB2;
+            std::vector<typename Engine::G1PointAffine> endoPointsC;
+            std::vector<typename Engine::G1PointAffine> endoPointsH;
+
+            MultiExp::ShiftedBases<typename Engine::G1> shiftedA;
+            MultiExp::ShiftedBases<typename Engine::G1> shiftedB1;
+            MultiExp::ShiftedBases<typename Engine::G2> shiftedB2;
+            MultiExp::ShiftedBases<typename Engine::G1> shiftedC;
+            MultiExp::ShiftedBases<typename Engine::G1> shiftedH;
+        };
+
+        std::vector<std::unique_ptr<NumaPart>> numaParts;
+
+        // Bytes of the G1 (A, B1, C), G2 (B2) and H multiexps: their
+        // bucket memory limits, 0 for none, or their bucket areas.
+        struct BucketBytes {
+            u_int64_t g1;
+            u_int64_t g2;
+            u_int64_t h;
+
+            BucketBytes() : g1(0), g2(0), h(0) {}
+        };
+
+        // Projected memory of a proof: 'fixed' for everything but the
+        // multiexps, 'multiexps' for their bucket areas, affine buckets and
+        // window digits past the b and c vectors the H buckets reuse, with
+        // the limits that keep the sum within the memory budget and the
+        // bucket areas the multiexps take under them.
+        struct MemoryPlan {
+            u_int64_t fixed;
+            u_int64_t multiexps;
+            BucketBytes limits;
+            BucketBytes areas;
+            std::vector<BucketBytes> numaLimits;
+            std::vector<BucketBytes> numaAreas;
+
+            MemoryPlan() : fixed(0), multiexps(0) {}
+
+            u_int64_t peak() const { return fixed + multiexps; }
+        };
+
+        // Scratch for a batch of up to 'batchSize' witnesses: a and b for
+        // every witness, one c shared by the batch and the bucket areas of
+        // the batched multiexps. In GLV mode also the split witnesses and
+        // the signs of the witness and of the H halves, which are split in
+        // place in a. The b vectors and c follow one another, so the H
+        // buckets take their place when they fit, as H runs after them.
+        struct ScratchSet {
+            ScratchArena::Buffer buffer;
+            u_int32_t batchSize;
+            std::vector<typename Engine::FrElement *> a;
+            std::vector<typename Engine::FrElement *> b;
+            typename Engine::FrElement *c;
+            void *g1Buckets;
+            void *g2Buckets;
+            void *hBuckets;
+            BucketBytes limits;
+            MultiExp::GlvScalars glvWitness;
+            MultiExp::GlvScalars glvH;
+
+            // Bucket areas of the NUMA parts, in the memory of their nodes.
+            std::vector<std::unique_ptr<ScratchArena::Buffer>> numaBuffers;
+            std::vector<void *> numaG1Buckets;
+            std::vector<void *> numaG2Buckets;
+            std::vector<void *> numaHBuckets;
+            std::vector<BucketBytes> numaLimits;
+
+            ScratchSet(size_t size, u_int32_t _batchSize, ScratchArena::PageMode pageMode)
+                : buffer(size, ThreadPool::defaultPool(), pageMode), batchSize(_batchSize), a(_batchSize), b(_batchSize) {}
+        };
+
+        typedef std::vector<std::unique_ptr<Proof<Engine>>> ProofList;
+
+        ScratchArena::Pool<ScratchSet> scratchPool;
+
+        std::mutex witnessHistogramMutex;
+        u_int64_t witnessHistogram[MultiExp::nScalarClasses];
+
+        // Witness profiles of the A, B1, B2 and C multiexps, with indices
+        // into the witness for A, B1 and B2 and past its public part for C.
+        struct WitnessProfiles {
+            MultiExp::ScalarProfile a;
+            MultiExp::ScalarProfile b1;
+            MultiExp::ScalarProfile b2;
+            MultiExp::ScalarProfile c;
+        };
+
+        void profileWitness(const std::vector<uint8_t *> &scalars, WitnessProfiles &profiles);
+
+        template <typename Curve>
+        void listZeroPoints(
+            std::vector<u_int32_t> &r,
+            Curve &g,
+            typename Curve::PointAffine *points,
+            u_int64_t n);
+
+        void splitWitness(const std::vector<uint8_t *> &scalars, ScratchSet &scratch);
+
+        // Lets the multiexps given 'cache' decode the window digits of the
+        // witness, and of its GLV split, once for the scalars [from, from + n)
+        // of which theirs are views.
+        void shareWitnessDigits(
+            MultiExp::DigitCache &cache,
+            const std::vector<uint8_t *> &scalars,
+            const MultiExp::GlvScalars &glvScalars,
+            u_int64_t from,
+            u_int64_t n);
+
+        template <typename Curve>
+        void mapEndomorphism(
+            std::vector<typename Curve::PointAffine> &r,
+            const std::unique_ptr<MultiExp::Endomorphism<Curve>> &endomorphism,
+            typename Curve::PointAffine *bases,
+            u_int64_t n);
+
+        template <typename Curve>
+        MultiExp::GlvInput<Curve> glvInput(
+            const std::unique_ptr<MultiExp::Endomorphism<Curve>> &endomorphism,
+            std::vector<typename Curve::PointAffine> &endoBases,
+            const MultiExp::GlvScalars &scalars);
+
+        template <typename Curve>
+        void multiexp(
+            MultiExp::Pippenger<Curve> &msm,
+            ProofMultiexp id,
+            typename Curve::Point *r,
+            typename Curve::PointAffine *bases,
+            const std::vector<uint8_t *> &scalars,
+            u_int64_t n,
+            const MultiExp::ScalarProfile &profile,
+            const MultiExp::GlvInput<Curve> &glv,
+            MultiExp::ShiftedBases<Curve> &shifted,
+            void *scratch);
+
+        void shiftBases();
+
+        // Points the multiexps at the zkey sections or at their copy in
+        // huge pages, as options.hugePages asks.
+        void placeSections();
+
+        void multiexpH(typename Engine::G1Point *r, ScratchSet &scratch, u_int32_t nWitnesses);
+
+        void runMultiexpH(
+            MultiExp::Pippenger<typename Engine::G1> &msm,
+            typename Engine::G1Point *r,
+            typename Engine::G1PointAffine *bases,
+            std::vector<typename Engine::G1PointAffine> &endoBases,
+            MultiExp::ShiftedBases<typename Engine::G1> &shifted,
+            const std::vector<uint8_t *> &scalars,
+            const MultiExp::GlvScalars &glvScalars,
+            u_int64_t n,
+            void *scratch);
+
+        // Runs fn(part, k) for every NUMA part k at once, each on a thread
+        // pinned to the node of the part.
+        template <typename Fn>
+        void onNumaNodes(Fn fn);
+
+        void buildNumaParts();
+
+        template <typename Curve>
+        MultiExp::Pippenger<Curve> numaMultiexp(
+            Curve &g,
+            typename BatchAffine::CurveField<Curve>::Type &F,
+            NumaPart &part,
+            MultiExp::CurveGroup group,
+            MultiExp::DigitCache *digitCache = nullptr);
+
+        void numaMultiexps(
+            typename Engine::G1Point *pi_a,
+            typename Engine::G1Point *pib1,
+            typename Engine::G2Point *pi_b,
+            typename Engine::G1Point *pi_c,
+            const std::vector<uint8_t *> &scalars,
+            const WitnessProfiles &profiles,
+            ScratchSet &scratch);
+
+        ScratchSet *createScratchSet(u_int32_t batchSize);
+
+        u_int64_t fixedMemory(u_int32_t batchSize) const;
+        u_int64_t witnessDigitsMemory(
+            const MultiExp::Pippenger<typename Engine::G1> &g1Msm,
+            const MultiExp::Pippenger<typename Engine::G2> &g2Msm,
+            u_int64_t n,
+            u_int32_t batchSize);
+
+        // Bytes of one multiexp under the bucket memory limit 'limit', less
+        // a bucket area that fits in the 'reused' bytes, and in 'area' that
+        // of its bucket area. The limit is set on 'msm', or dropped if the
+        // multiexp fits it without one.
+        template <typename Curve>
+        u_int64_t multiexpMemory(MultiExp::Pippenger<Curve> &msm, bool batchAffine, u_int64_t n, u_int32_t batchSize,
+                                 u_int64_t reused, u_int64_t &limit, u_int64_t &area);
+
+        void planMultiexps(MemoryPlan &plan, u_int32_t batchSize, u_int64_t limit);
+        MemoryPlan planMemory(u_int32_t batchSize);
+
+        MultiExp::Pippenger<typename Engine::G1> g1Multiexp(MultiExp::DigitCache *digitCache = nullptr);
+        MultiExp::Pippenger<typename Engine::G2> g2Multiexp(MultiExp::DigitCache *digitCache = nullptr);
+        MultiExp::Pippenger<typename Engine::G1> hMultiexp();
+
+        CosetFFT<typename Engine::Fr> &getCosetFft();
+        void computeH(const std::vector<typename Engine::FrElement *> &wtns, ScratchSet &scratch);
+        void finishProof(
+            Proof<Engine> &proof,
+            typename Engine::G1Point &pi_a,
+            typename Engine::G1Point &pib1,
+            typename Engine::G2Point &pi_b,
+            typename Engine::G1Point &pi_c,
+            typename Engine::G1Point &pih);
+        ProofList proveTaskGraph(const std::vector<typename Engine::FrElement *> &wtns);
+
     public:
         Prover(
             Engine &_E, 
@@ -103,16 +498,85 @@ namespace Groth16 {
             pointsB1(_pointsB1),
             pointsB2(_pointsB2),
             pointsC(_pointsC),
-            pointsH(_pointsH)
+            pointsH(_pointsH),
+            zkeyPointsA(_pointsA),
+            zkeyPointsB1(_pointsB1),
+            zkeyPointsB2(_pointsB2),
+            zkeyPointsC(_pointsC),
+            zkeyPointsH(_pointsH),
+            scratchHugePageBytes(0),
+            frMul(_E.fr),
+            frBatch(_E.fr),
+            g1Threads(0),
+            g2Threads(0),
+            hThreads(0),
+            nThreads(std::max(1u, std::thread::hardware_concurrency())),
+            scratchPool(options.scratchSets)
         { 
-            fft = new FFT<typename Engine::Fr>(domainSize*2);
+            std::fill(witnessHistogram, witnessHistogram + MultiExp::nScalarClasses, 0);
         }
 
-        ~Prover() {
-            delete fft;
+        void buildCoefPartition() {
+            const u_int64_t nPartitions = 4 * std::max(1u, std::thread::hardware_concurrency());
+            coefPartition.build(coefs, nCoefs, domainSize, nPartitions);
         }
 
+        // Finds the points at infinity of the A, B1 and B2 sections, which
+        // the multiexps skip. Reads the sections once.
+        void findZeroPoints();
+
+        // Number of points the multiexps skip as points at infinity.
+        u_int64_t getZeroPoints() const { return zeroPointsA.size() + zeroPointsB1.size() + zeroPointsB2.size(); }
+
+        void setOptions(const ProverOptions &_options);
+        const ProverOptions &getOptions() const { return options; }
+
+        // Tunes the window width and the task split of the multiexps of
+        // this circuit on this host. The choices are read from the profile
+        // at 'profilePath', the sizes it lacks for the current options are
+        // timed and added to it, and the multiexps of later proofs use them.
+        // Must not run concurrently with a proof.
+        void tune(const std::string &profilePath);
+
+        // Faults in the coefficients and the point sections the multiexps
+        // read, in parallel on the default pool, so the first proof does
+        // not wait on the disk, and with 'lock' locks them in RAM until the
+        // prover is destroyed or the huge page option moves the sections.
+        // Must not run concurrently with a proof.
+        void warmUp(bool lock, const Residency::Progress &progress);
+
+        // Bytes faulted in by the last warm-up and bytes locked in RAM.
+        u_int64_t getWarmBytes() const { return resident.warmBytes(); }
+        u_int64_t getLockedBytes() const { return resident.lockedBytes(); }
+
+        // Bytes taken by the shifted copies of the point sections.
+        u_int64_t getShiftedBasesSize() const;
+
+        // Number of NUMA nodes the multiexps are split over, 0 when the
+        // NUMA mode is off.
+        u_int64_t getNumaNodes() const { return numaParts.size(); }
+
+        // Bytes of the point sections in huge pages, and of the last
+        // scratch set created.
+        u_int64_t getSectionsHugePageBytes() const { return hugeSections ? hugeSections->hugePageBytes() : 0; }
+        u_int64_t getScratchHugePageBytes() const { return scratchHugePageBytes; }
+
+        // Projected peak bytes of a proof under the current options and
+        // memory budget: the zkey sections the proof reads and their
+        // copies, the witness, a scratch set and what the multiexps take
+        // past it. Above the budget when the smallest multiexps do not fit.
+        u_int64_t getPeakMemory() { return planMemory(1).peak(); }
+
+        // Number of witness scalars of every MultiExp::ScalarClass in the
+        // last proof made with the witness profile enabled.
+        void getWitnessHistogram(u_int64_t histogram[MultiExp::nScalarClasses]);
+
         std::unique_ptr<Proof<Engine>> prove(typename Engine::FrElement *wtns);
+
+        // Proves several witnesses of the circuit at once. Every multiexp
+        // streams its points once for the whole batch and the coefficient
+        // pass evaluates all the witnesses per coefficient read.
+        ProofList proveBatch(const std::vector<typename Engine::FrElement *> &wtns);
     };
 
     template <typename Engine>
@@ -0,0 +1,36 @@
+#include <gmp.h>
+#include <stdexcept>
+
+#include "lazy_butterfly.hpp"
+
+namespace LazyButterfly {
+
+void setModulus(Modulus &m, const uint64_t p[4])
+{
+    if (p[3] >> 62) {
+        throw std::invalid_argument("lazy butterflies need a modulus below 2^254");
+    }
+
+    for (int i = 0; i < 4; i++) {
+        m.p[i] = p[i];
+    }
+    add(m.p2, m.p, m.p);
+}
+
+void setTwiddle(Twiddle &t, const uint64_t w[4], const Modulus &m)
+{
+    // w' = floor(w * 2^256 / p), below 2^256 since w < p.
+    mp_limb_t num[8] = {0, 0, 0, 0, w[0], w[1], w[2], w[3]};
+    mp_limb_t den[4] = {m.p[0], m.p[1], m.p[2], m.p[3]};
+    mp_limb_t quot[5];
+    mp_limb_t rem[4];
+
+    mpn_tdiv_qr(quot, rem, 0, num, 8, den, 4);
+
+    for (int i = 0; i < 4; i++) {
+        t.w[i] = w[i];
+        t.wShoup[i] = quot[i];
+    }
+}
+
+} // Namespace
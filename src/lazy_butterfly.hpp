@@ -0,0 +1,149 @@
+#ifndef LAZY_BUTTERFLY_HPP
+#define LAZY_BUTTERFLY_HPP
+
+#include <cstdint>
+
+// Radix-2 FFT butterflies over a 4-limb prime field with a modulus p below
+// 2^254, after Harvey, "Faster arithmetic for number-theoretic transforms".
+// Values stay in [0, 2p) or [0, 4p) between layers and are only reduced to
+// [0, p) by the caller once the transform is done. Twiddles are multiplied
+// with Shoup's method: with w' = floor(w * 2^256 / p) precomputed, w * y
+// mod p is w * y - floor(w' * y / 2^256) * p, in [0, 2p) for any y below
+// 2^256, with no reduction loop. Montgomery form of the values is kept,
+// since w is applied as a plain integer.
+namespace LazyButterfly {
+
+    typedef unsigned __int128 u128;
+
+    struct Modulus {
+        uint64_t p[4];
+        uint64_t p2[4];     // 2p
+    };
+
+    // Twiddle w in [0, p), not in Montgomery form, and its Shoup quotient.
+    struct Twiddle {
+        uint64_t w[4];
+        uint64_t wShoup[4];
+    };
+
+    // Throws std::invalid_argument if p is not below 2^254.
+    void setModulus(Modulus &m, const uint64_t p[4]);
+
+    void setTwiddle(Twiddle &t, const uint64_t w[4], const Modulus &m);
+
+    inline void add(uint64_t *r, const uint64_t *a, const uint64_t *b) {
+        u128 s = 0;
+
+        for (int i = 0; i < 4; i++) {
+            s += (u128)a[i] + b[i];
+            r[i] = (uint64_t)s;
+            s >>= 64;
+        }
+    }
+
+    inline void sub(uint64_t *r, const uint64_t *a, const uint64_t *b) {
+        uint64_t borrow = 0;
+
+        for (int i = 0; i < 4; i++) {
+            const u128 d = (u128)a[i] - b[i] - borrow;
+            r[i] = (uint64_t)d;
+            borrow = (uint64_t)(d >> 64) & 1;
+        }
+    }
+
+    // x -= m if x >= m.
+    inline void reduceOnce(uint64_t *x, const uint64_t *m) {
+        uint64_t d[4];
+        uint64_t borrow = 0;
+
+        for (int i = 0; i < 4; i++) {
+            const u128 t = (u128)x[i] - m[i] - borrow;
+            d[i] = (uint64_t)t;
+            borrow = (uint64_t)(t >> 64) & 1;
+        }
+
+        if (!borrow) {
+            x[0] = d[0]; x[1] = d[1]; x[2] = d[2]; x[3] = d[3];
+        }
+    }
+
+    // [0, 4p) to [0, p).
+    inline void reduce(uint64_t *x, const Modulus &m) {
+        reduceOnce(x, m.p2);
+        reduceOnce(x, m.p);
+    }
+
+    // r = w * y mod p in [0, 2p), for y < 2^256. r may alias y.
+    inline void mulShoup(uint64_t *r, const uint64_t *y, const Twiddle &t, const Modulus &m) {
+        // q = floor(w' * y / 2^256), the high half of the 512-bit product.
+        uint64_t prod[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+
+        for (int i = 0; i < 4; i++) {
+            u128 carry = 0;
+
+            for (int j = 0; j < 4; j++) {
+                carry += (u128)t.wShoup[i] * y[j] + prod[i + j];
+                prod[i + j] = (uint64_t)carry;
+                carry >>= 64;
+            }
+            prod[i + 4] = (uint64_t)carry;
+        }
+
+        const uint64_t *q = prod + 4;
+
+        // w * y - q * p, both taken mod 2^256.
+        uint64_t wy[4] = {0, 0, 0, 0};
+        uint64_t qp[4] = {0, 0, 0, 0};
+
+        for (int i = 0; i < 4; i++) {
+            u128 c1 = 0;
+            u128 c2 = 0;
+
+            for (int j = 0; i + j < 4; j++) {
+                c1 += (u128)t.w[i] * y[j] + wy[i + j];
+                wy[i + j] = (uint64_t)c1;
+                c1 >>= 64;
+
+                c2 += (u128)q[i] * m.p[j] + qp[i + j];
+                qp[i + j] = (uint64_t)c2;
+                c2 >>= 64;
+            }
+        }
+
+        sub(r, wy, qp);
+    }
+
+    // Decimation-in-time butterfly x0 + w x1, x0 - w x1 for x0 and x1 in
+    // [0, 4p), leaving both in [0, 4p).
+    inline void forward(uint64_t *x0, uint64_t *x1, const Twiddle &t, const Modulus &m) {
+        uint64_t wx[4];
+
+        reduceOnce(x0, m.p2);
+        mulShoup(wx, x1, t, m);
+
+        add(x1, x0, m.p2);
+        sub(x1, x1, wx);
+        add(x0, x0, wx);
+    }
+
+    // Decimation-in-frequency butterfly x0 + x1, (x0 - x1) w for x0 and x1
+    // in [0, 2p), leaving both in [0, 2p). With 'negate' it applies -w, as
+    // (x1 - x0) w.
+    inline void inverse(uint64_t *x0, uint64_t *x1, const Twiddle &t, bool negate, const Modulus &m) {
+        uint64_t d[4];
+
+        if (negate) {
+            add(d, x1, m.p2);
+            sub(d, d, x0);
+        } else {
+            add(d, x0, m.p2);
+            sub(d, d, x1);
+        }
+
+        add(x0, x0, x1);
+        reduceOnce(x0, m.p2);
+        mulShoup(x1, d, t, m);
+    }
+}
+
+#endif // LAZY_BUTTERFLY_HPP
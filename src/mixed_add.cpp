@@ -0,0 +1,82 @@
+namespace MultiExp {
+
+template <typename Curve, typename Field>
+void MixedAdd<Curve, Field, 8>::madd(Point &r, PointAffine &p, Element &y2) {
+
+    if (g.isZero(p)) {
+        return;
+    }
+
+    if (g.isZero(r)) {
+        F.copy(r.x, p.x);
+        F.copy(r.y, y2);
+        F.copy(r.zz, F.one());
+        F.copy(r.zzz, F.one());
+        return;
+    }
+
+    Element u2, s2, pp, ppp, qq, t, y3;
+
+    // P = x2 zz1 - x1 in u2, R = y2 zzz1 - y1 in s2.
+    q.mul(u2, p.x, r.zz);
+    q.mul(s2, y2, r.zzz);
+    F.sub(u2, u2, r.x);
+    F.sub(s2, s2, r.y);
+
+    if (F.isZero(u2)) {
+        if (F.isZero(s2)) {
+            mdbl(r, p.x, y2);
+        } else {
+            g.copy(r, g.zero());
+        }
+        return;
+    }
+
+    q.square(pp, u2);
+    q.mul(ppp, u2, pp);
+    q.mul(qq, r.x, pp);
+
+    // x3 = R^2 - PPP - 2Q, y3 = R(Q - x3) - y1 PPP
+    q.square(r.x, s2);
+    F.sub(r.x, r.x, ppp);
+    F.sub(r.x, r.x, qq);
+    F.sub(r.x, r.x, qq);
+
+    F.sub(t, qq, r.x);
+    q.mul(y3, s2, t);
+    q.mul(t, r.y, ppp);
+    F.sub(r.y, y3, t);
+
+    q.mul(t, r.zz, pp);
+    F.copy(r.zz, t);
+    q.mul(t, r.zzz, ppp);
+    F.copy(r.zzz, t);
+}
+
+template <typename Curve, typename Field>
+void MixedAdd<Curve, Field, 8>::mdbl(Point &r, Element &x, Element &y) {
+    Element u, v, w, s, m, t, y3;
+
+    F.add(u, y, y);
+    q.square(v, u);
+    q.mul(w, u, v);
+    q.mul(s, x, v);
+    q.square(m, x);
+    F.add(t, m, m);
+    F.add(m, t, m);
+
+    // x3 = M^2 - 2S, y3 = M(S - x3) - W y
+    q.square(r.x, m);
+    F.sub(r.x, r.x, s);
+    F.sub(r.x, r.x, s);
+
+    F.sub(t, s, r.x);
+    q.mul(y3, m, t);
+    q.mul(t, w, y);
+    F.sub(r.y, y3, t);
+
+    F.copy(r.zz, v);
+    F.copy(r.zzz, w);
+}
+
+} // namespace
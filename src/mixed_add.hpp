@@ -0,0 +1,60 @@
+#ifndef MIXED_ADD_HPP
+#define MIXED_ADD_HPP
+
+#include <cstdint>
+
+#include "montgomery.hpp"
+
+namespace MultiExp {
+
+    // Mixed additions r += p and r -= p of an affine point to an xyzz
+    // point, the bucket additions of the bucket method. On curves over a
+    // quadratic extension (G2, 8-limb coordinates) the products go through
+    // Montgomery::QuadraticMul over 'Field', the base field of the curve;
+    // elsewhere these are the curve's own.
+    template <typename Curve, typename Field, uint64_t limbs = sizeof(decltype(Curve::PointAffine::x)) / sizeof(uint64_t)>
+    class MixedAdd {
+        typedef typename Curve::Point Point;
+        typedef typename Curve::PointAffine PointAffine;
+
+        Curve &g;
+
+    public:
+        MixedAdd(Curve &_g, Field &) : g(_g) {}
+
+        void add(Point &r, PointAffine &p) { g.add(r, r, p); }
+        void sub(Point &r, PointAffine &p) { g.sub(r, r, p); }
+    };
+
+    template <typename Curve, typename Field>
+    class MixedAdd<Curve, Field, 8> {
+        typedef typename Curve::Point Point;
+        typedef typename Curve::PointAffine PointAffine;
+        typedef decltype(PointAffine::x) Element;
+
+        Curve &g;
+        Field &F;
+        Montgomery::QuadraticMul<Field> q;
+
+        // madd-2008-s with y2 for the y of p.
+        void madd(Point &r, PointAffine &p, Element &y2);
+
+        // mdbl-2008-s-1 of (x, y).
+        void mdbl(Point &r, Element &x, Element &y);
+
+    public:
+        MixedAdd(Curve &_g, Field &_F) : g(_g), F(_F), q(_F) {}
+
+        void add(Point &r, PointAffine &p) { madd(r, p, p.y); }
+
+        void sub(Point &r, PointAffine &p) {
+            Element y2;
+            F.neg(y2, p.y);
+            madd(r, p, y2);
+        }
+    };
+}
+
+#include "mixed_add.cpp"
+
+#endif // MIXED_ADD_HPP
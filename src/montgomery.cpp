@@ -0,0 +1,65 @@
+#include <stdexcept>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+#include "montgomery.hpp"
+
+namespace Montgomery {
+
+void setModulus(Modulus &m, const uint64_t p[4])
+{
+    if ((p[0] & 1) == 0 || (p[3] >> 62)) {
+        throw std::invalid_argument("montgomery kernels need an odd modulus below 2^254");
+    }
+
+    // Newton's iteration doubles the correct low bits of p^-1 each step,
+    // from the 3 bits of inv = p, which holds for every odd p.
+    uint64_t inv = p[0];
+
+    for (int i = 0; i < 5; i++) {
+        inv *= 2 - p[0] * inv;
+    }
+
+    for (int i = 0; i < 4; i++) {
+        m.p[i] = p[i];
+    }
+    m.np = 0 - inv;
+
+    mulWide(m.p2, p, p);
+}
+
+#if defined(__x86_64__)
+
+static bool DetectMulx()
+{
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+
+    const unsigned int bmi2 = 1u << 8;
+    const unsigned int adx  = 1u << 19;
+
+    return (ebx & bmi2) && (ebx & adx);
+}
+
+bool hasMulx()
+{
+    static const bool supported = DetectMulx();
+
+    return supported;
+}
+
+#else
+
+bool hasMulx()
+{
+    return false;
+}
+
+#endif
+
+} // Namespace
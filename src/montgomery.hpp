@@ -0,0 +1,482 @@
+#ifndef MONTGOMERY_HPP
+#define MONTGOMERY_HPP
+
+#include <cstdint>
+#include <gmp.h>
+
+// Montgomery multiplication over a 4-limb prime field with a modulus p below
+// 2^254, written to be inlined into the loops that do most of the field
+// products. On x86-64 CPUs with BMI2 and ADX it uses MULX, which leaves the
+// flags alone, and ADCX/ADOX, which run two carry chains side by side, so
+// the product and the reduction of a row interleave without a call into the
+// field library. The kernel is inline assembly rather than intrinsics, so it
+// needs no target flags at the call site and is chosen at run time.
+namespace Montgomery {
+
+    struct Modulus {
+        uint64_t p[4];
+        uint64_t np;        // -p^-1 mod 2^64
+        uint64_t p2[8];     // p^2
+    };
+
+    // Throws std::invalid_argument if p is even or not below 2^254.
+    void setModulus(Modulus &m, const uint64_t p[4]);
+
+    // True on x86-64 CPUs with BMI2 and ADX. Read from CPUID once.
+    bool hasMulx();
+
+    typedef unsigned __int128 u128;
+
+#if defined(__x86_64__)
+
+    // r = a * b / 2^256 mod p for a, b in [0, p). Two rows of the CIOS
+    // method per limb of b: t += a * b[i] with the low halves of the
+    // products on the OF chain and the high halves on the CF chain, then
+    // t = (t + m * p) / 2^64 with m = t[0] * np. Since p < 2^254, t stays
+    // below 2p and fits in 4 limbs plus the carry word of the row.
+    inline void mulMulx(uint64_t *r, const uint64_t *a, const uint64_t *b, const Modulus &m) {
+        uint64_t t0, t1, t2, t3, carry, hi;
+
+#define MONTGOMERY_MULX_ROW(i) \
+        "xorq %%rax, %%rax\n\t" \
+        "movq " #i "*8(%[b]), %%rdx\n\t" \
+        "mulxq 0(%[a]), %%rax, %[hi]\n\t" \
+        "adoxq %%rax, %[t0]\n\t" \
+        "adcxq %[hi], %[t1]\n\t" \
+        "mulxq 8(%[a]), %%rax, %[hi]\n\t" \
+        "adoxq %%rax, %[t1]\n\t" \
+        "adcxq %[hi], %[t2]\n\t" \
+        "mulxq 16(%[a]), %%rax, %[hi]\n\t" \
+        "adoxq %%rax, %[t2]\n\t" \
+        "adcxq %[hi], %[t3]\n\t" \
+        "mulxq 24(%[a]), %%rax, %[carry]\n\t" \
+        "adoxq %%rax, %[t3]\n\t" \
+        "movq $0, %%rax\n\t" \
+        "adcxq %%rax, %[carry]\n\t" \
+        "adoxq %%rax, %[carry]\n\t" \
+        "movq %[t0], %%rdx\n\t" \
+        "imulq %[np], %%rdx\n\t" \
+        "xorq %%rax, %%rax\n\t" \
+        "mulxq 0(%[p]), %%rax, %[hi]\n\t" \
+        "adcxq %[t0], %%rax\n\t" \
+        "movq %[hi], %[t0]\n\t" \
+        "adcxq %[t1], %[t0]\n\t" \
+        "mulxq 8(%[p]), %%rax, %[t1]\n\t" \
+        "adoxq %%rax, %[t0]\n\t" \
+        "adcxq %[t2], %[t1]\n\t" \
+        "mulxq 16(%[p]), %%rax, %[t2]\n\t" \
+        "adoxq %%rax, %[t1]\n\t" \
+        "adcxq %[t3], %[t2]\n\t" \
+        "mulxq 24(%[p]), %%rax, %[t3]\n\t" \
+        "adoxq %%rax, %[t2]\n\t" \
+        "movq $0, %%rax\n\t" \
+        "adcxq %%rax, %[t3]\n\t" \
+        "adoxq %[carry], %[t3]\n\t"
+
+        __asm__ (
+            "xorq %[t0], %[t0]\n\t"
+            "xorq %[t1], %[t1]\n\t"
+            "xorq %[t2], %[t2]\n\t"
+            "xorq %[t3], %[t3]\n\t"
+            MONTGOMERY_MULX_ROW(0)
+            MONTGOMERY_MULX_ROW(1)
+            MONTGOMERY_MULX_ROW(2)
+            MONTGOMERY_MULX_ROW(3)
+            : [t0] "=&r" (t0), [t1] "=&r" (t1), [t2] "=&r" (t2), [t3] "=&r" (t3),
+              [carry] "=&r" (carry), [hi] "=&r" (hi)
+            : [a] "r" (a), [b] "r" (b), [p] "r" (m.p), [np] "r" (m.np)
+            : "rax", "rdx", "cc", "memory"
+        );
+
+#undef MONTGOMERY_MULX_ROW
+
+        // t - p, kept if it does not borrow.
+        const uint64_t t[4] = {t0, t1, t2, t3};
+        uint64_t d[4];
+        uint64_t borrow = 0;
+
+        for (int i = 0; i < 4; i++) {
+            const u128 s = (u128)t[i] - m.p[i] - borrow;
+            d[i] = (uint64_t)s;
+            borrow = (uint64_t)(s >> 64) & 1;
+        }
+
+        const uint64_t keep = 0 - borrow;
+
+        for (int i = 0; i < 4; i++) {
+            r[i] = (t[i] & keep) | (d[i] & ~keep);
+        }
+    }
+
+#endif
+
+    // Double-width products and their Montgomery reduction, for sums of
+    // products that are reduced once. Portable versions first.
+
+    // t = a * b, all 8 limbs.
+    inline void mulWide(uint64_t *t, const uint64_t *a, const uint64_t *b) {
+        for (int i = 0; i < 8; i++) {
+            t[i] = 0;
+        }
+        for (int i = 0; i < 4; i++) {
+            uint64_t carry = 0;
+
+            for (int j = 0; j < 4; j++) {
+                const u128 s = (u128)a[i] * b[j] + t[i + j] + carry;
+                t[i + j] = (uint64_t)s;
+                carry = (uint64_t)(s >> 64);
+            }
+            t[i + 4] = carry;
+        }
+    }
+
+    // x = x / 2^256 mod p, at most p: x + m p for the m that clears the low
+    // 256 bits is below (1 + p) 2^256.
+    inline void reduceLow(uint64_t *x, const Modulus &m) {
+        for (int i = 0; i < 4; i++) {
+            const uint64_t k = x[0] * m.np;
+            uint64_t carry = (uint64_t)(((u128)k * m.p[0] + x[0]) >> 64);
+
+            for (int j = 1; j < 4; j++) {
+                const u128 s = (u128)k * m.p[j] + x[j] + carry;
+                x[j - 1] = (uint64_t)s;
+                carry = (uint64_t)(s >> 64);
+            }
+            x[3] = carry;
+        }
+    }
+
+#if defined(__x86_64__)
+
+    // mulWide on MULX/ADCX/ADOX: a row per limb of a, over a window of five
+    // registers that moves up one limb per row.
+    inline void mulWideMulx(uint64_t *t, const uint64_t *a, const uint64_t *b) {
+        uint64_t w0, w1, w2, w3, w4, hi;
+
+#define MONTGOMERY_WIDE_ROW(i, A, B, C, D, E) \
+        "xorq %%rax, %%rax\n\t" \
+        "movq " #i "*8(%[a]), %%rdx\n\t" \
+        "mulxq 0(%[b]), %%rax, %[hi]\n\t" \
+        "adoxq %%rax, %[" #A "]\n\t" \
+        "adcxq %[hi], %[" #B "]\n\t" \
+        "mulxq 8(%[b]), %%rax, %[hi]\n\t" \
+        "adoxq %%rax, %[" #B "]\n\t" \
+        "adcxq %[hi], %[" #C "]\n\t" \
+        "mulxq 16(%[b]), %%rax, %[hi]\n\t" \
+        "adoxq %%rax, %[" #C "]\n\t" \
+        "adcxq %[hi], %[" #D "]\n\t" \
+        "mulxq 24(%[b]), %%rax, %[" #E "]\n\t" \
+        "adoxq %%rax, %[" #D "]\n\t" \
+        "movq $0, %%rax\n\t" \
+        "adcxq %%rax, %[" #E "]\n\t" \
+        "adoxq %%rax, %[" #E "]\n\t" \
+        "movq %[" #A "], " #i "*8(%[t])\n\t"
+
+        // Volatile: the results go to memory only, not to the outputs.
+        __asm__ volatile (
+            "xorq %[w0], %[w0]\n\t"
+            "xorq %[w1], %[w1]\n\t"
+            "xorq %[w2], %[w2]\n\t"
+            "xorq %[w3], %[w3]\n\t"
+            MONTGOMERY_WIDE_ROW(0, w0, w1, w2, w3, w4)
+            MONTGOMERY_WIDE_ROW(1, w1, w2, w3, w4, w0)
+            MONTGOMERY_WIDE_ROW(2, w2, w3, w4, w0, w1)
+            MONTGOMERY_WIDE_ROW(3, w3, w4, w0, w1, w2)
+            "movq %[w4], 32(%[t])\n\t"
+            "movq %[w0], 40(%[t])\n\t"
+            "movq %[w1], 48(%[t])\n\t"
+            "movq %[w2], 56(%[t])\n\t"
+            : [w0] "=&r" (w0), [w1] "=&r" (w1), [w2] "=&r" (w2), [w3] "=&r" (w3),
+              [w4] "=&r" (w4), [hi] "=&r" (hi)
+            : [t] "r" (t), [a] "r" (a), [b] "r" (b)
+            : "rax", "rdx", "cc", "memory"
+        );
+
+#undef MONTGOMERY_WIDE_ROW
+    }
+
+    // reduceLow on MULX/ADCX/ADOX, the reduction half of the rows of
+    // mulMulx.
+    inline void reduceLowMulx(uint64_t *x, const Modulus &m) {
+        uint64_t t0 = x[0], t1 = x[1], t2 = x[2], t3 = x[3], hi;
+
+#define MONTGOMERY_REDUCE_ROW \
+        "movq %[t0], %%rdx\n\t" \
+        "imulq %[np], %%rdx\n\t" \
+        "xorq %%rax, %%rax\n\t" \
+        "mulxq 0(%[p]), %%rax, %[hi]\n\t" \
+        "adcxq %[t0], %%rax\n\t" \
+        "movq %[hi], %[t0]\n\t" \
+        "adcxq %[t1], %[t0]\n\t" \
+        "mulxq 8(%[p]), %%rax, %[t1]\n\t" \
+        "adoxq %%rax, %[t0]\n\t" \
+        "adcxq %[t2], %[t1]\n\t" \
+        "mulxq 16(%[p]), %%rax, %[t2]\n\t" \
+        "adoxq %%rax, %[t1]\n\t" \
+        "adcxq %[t3], %[t2]\n\t" \
+        "mulxq 24(%[p]), %%rax, %[t3]\n\t" \
+        "adoxq %%rax, %[t2]\n\t" \
+        "movq $0, %%rax\n\t" \
+        "adcxq %%rax, %[t3]\n\t" \
+        "adoxq %%rax, %[t3]\n\t"
+
+        __asm__ (
+            MONTGOMERY_REDUCE_ROW
+            MONTGOMERY_REDUCE_ROW
+            MONTGOMERY_REDUCE_ROW
+            MONTGOMERY_REDUCE_ROW
+            : [t0] "+&r" (t0), [t1] "+&r" (t1), [t2] "+&r" (t2), [t3] "+&r" (t3),
+              [hi] "=&r" (hi)
+            : [p] "r" (m.p), [np] "r" (m.np)
+            : "rax", "rdx", "cc"
+        );
+
+#undef MONTGOMERY_REDUCE_ROW
+
+        x[0] = t0;
+        x[1] = t1;
+        x[2] = t2;
+        x[3] = t3;
+    }
+
+#endif
+
+    inline void mulWide(uint64_t *t, const uint64_t *a, const uint64_t *b, bool mulx) {
+#if defined(__x86_64__)
+        if (mulx) {
+            mulWideMulx(t, a, b);
+            return;
+        }
+#endif
+        mulWide(t, a, b);
+    }
+
+    // r = t / 2^256 mod p for t below p 2^256: the high half plus the low
+    // half reduced, less than 2p, brought below p by one subtraction.
+    inline void reduceWide(uint64_t *r, const uint64_t *t, const Modulus &m, bool mulx) {
+        uint64_t x[4] = {t[0], t[1], t[2], t[3]};
+
+#if defined(__x86_64__)
+        if (mulx) {
+            reduceLowMulx(x, m);
+        } else {
+            reduceLow(x, m);
+        }
+#else
+        reduceLow(x, m);
+#endif
+
+        uint64_t s[4], d[4];
+        uint64_t carry = 0, borrow = 0;
+
+        for (int i = 0; i < 4; i++) {
+            const u128 v = (u128)x[i] + t[i + 4] + carry;
+            s[i] = (uint64_t)v;
+            carry = (uint64_t)(v >> 64);
+        }
+        for (int i = 0; i < 4; i++) {
+            const u128 v = (u128)s[i] - m.p[i] - borrow;
+            d[i] = (uint64_t)v;
+            borrow = (uint64_t)(v >> 64) & 1;
+        }
+
+        const uint64_t keep = 0 - borrow;
+
+        for (int i = 0; i < 4; i++) {
+            r[i] = (s[i] & keep) | (d[i] & ~keep);
+        }
+    }
+
+    // r = a + b over n limbs, with no reduction. Returns the carry.
+    inline uint64_t addLimbs(uint64_t *r, const uint64_t *a, const uint64_t *b, int n) {
+        uint64_t carry = 0;
+
+        for (int i = 0; i < n; i++) {
+            const u128 s = (u128)a[i] + b[i] + carry;
+            r[i] = (uint64_t)s;
+            carry = (uint64_t)(s >> 64);
+        }
+        return carry;
+    }
+
+    // r = a - b over n limbs. Returns the borrow.
+    inline uint64_t subLimbs(uint64_t *r, const uint64_t *a, const uint64_t *b, int n) {
+        uint64_t borrow = 0;
+
+        for (int i = 0; i < n; i++) {
+            const u128 s = (u128)a[i] - b[i] - borrow;
+            r[i] = (uint64_t)s;
+            borrow = (uint64_t)(s >> 64) & 1;
+        }
+        return borrow;
+    }
+
+    // Products in Fp2 = Fp[u] / (u^2 + 1), elements as the 4 limbs of the
+    // real part then the 4 of the imaginary part, in Montgomery form. The
+    // Karatsuba terms are summed as full 512-bit products, with sums of
+    // inputs left unreduced below 2p, and each component of the result
+    // takes a single Montgomery reduction. p < 2^254 keeps every sum below
+    // p 2^256. 'mulx' picks the MULX kernels, see hasMulx().
+
+    // (a0 + a1 u)(b0 + b1 u) = a0 b0 - a1 b1 + ((a0 + a1)(b0 + b1) - a0 b0 - a1 b1) u
+    inline void mulQuadratic(uint64_t *r, const uint64_t *a, const uint64_t *b, const Modulus &m, bool mulx) {
+        uint64_t sa[4], sb[4];
+        uint64_t t0[8], t1[8], t2[8];
+
+        addLimbs(sa, a, a + 4, 4);
+        addLimbs(sb, b, b + 4, 4);
+        mulWide(t0, a, b, mulx);
+        mulWide(t1, a + 4, b + 4, mulx);
+        mulWide(t2, sa, sb, mulx);
+
+        // t2 - t0 - t1 = a0 b1 + a1 b0 < 2p^2, t0 + p^2 - t1 < 2p^2.
+        subLimbs(t2, t2, t0, 8);
+        subLimbs(t2, t2, t1, 8);
+        addLimbs(t0, t0, m.p2, 8);
+        subLimbs(t0, t0, t1, 8);
+
+        reduceWide(r, t0, m, mulx);
+        reduceWide(r + 4, t2, m, mulx);
+    }
+
+    // (a0 + a1 u)^2 = (a0 + a1)(a0 - a1) + 2 a0 a1 u
+    inline void squareQuadratic(uint64_t *r, const uint64_t *a, const Modulus &m, bool mulx) {
+        uint64_t s[4], d[4], a1x2[4];
+        uint64_t t0[8], t1[8];
+
+        // a0 + a1 and a0 + p - a1 are below 2p, their product below 4p^2.
+        addLimbs(s, a, a + 4, 4);
+        addLimbs(d, a, m.p, 4);
+        subLimbs(d, d, a + 4, 4);
+        addLimbs(a1x2, a + 4, a + 4, 4);
+        mulWide(t0, s, d, mulx);
+        mulWide(t1, a, a1x2, mulx);
+
+        reduceWide(r, t0, m, mulx);
+        reduceWide(r + 4, t1, m, mulx);
+    }
+
+    // Products of a Field whose Element holds the 4 limbs in Montgomery form
+    // in Element::v. Uses mulMulx where the CPU has it and the field's own
+    // kernels otherwise; the branch is the same on every call, so it costs
+    // next to nothing inside a loop.
+    template <typename Field>
+    class FieldMul {
+        Field &f;
+        Modulus modulus;
+        bool mulx;
+
+    public:
+        typedef typename Field::Element Element;
+
+        explicit FieldMul(Field &_f)
+            : f(_f)
+            , mulx(false)
+        {
+            mpz_t q;
+            mpz_init(q);
+
+            f.toMpz(q, f.negOne());
+            mpz_add_ui(q, q, 1);
+
+            uint64_t p[4] = {0, 0, 0, 0};
+            mpz_export(p, nullptr, -1, sizeof(uint64_t), 0, 0, q);
+            mpz_clear(q);
+
+            setModulus(modulus, p);
+#if defined(__x86_64__)
+            mulx = hasMulx();
+#endif
+        }
+
+        bool usesMulx() const { return mulx; }
+        const Modulus &getModulus() const { return modulus; }
+
+        void mul(Element &r, const Element &a, const Element &b) {
+#if defined(__x86_64__)
+            if (mulx) {
+                mulMulx(r.v, a.v, b.v, modulus);
+                return;
+            }
+#endif
+            f.mul(r, a, b);
+        }
+
+        void square(Element &r, const Element &a) {
+#if defined(__x86_64__)
+            if (mulx) {
+                mulMulx(r.v, a.v, a.v, modulus);
+                return;
+            }
+#endif
+            f.square(r, a);
+        }
+    };
+
+    // Products of a quadratic extension Field2 of a Field as above, such as
+    // the F2Field of G2, through mulQuadratic and squareQuadratic when the
+    // extension is by u^2 = -1 and the CPU has MULX, and through Field2's
+    // own kernels otherwise: without MULX the fused products are no faster
+    // than the field's.
+    template <typename Field2>
+    class QuadraticMul {
+        Field2 &f;
+        Modulus modulus;
+        bool fused;
+        bool mulx;
+
+    public:
+        typedef typename Field2::Element Element;
+
+        explicit QuadraticMul(Field2 &_f)
+            : f(_f)
+            , fused(false)
+            , mulx(hasMulx())
+        {
+            auto &F = f.F;
+
+            mpz_t q;
+            mpz_init(q);
+
+            F.toMpz(q, F.negOne());
+            mpz_add_ui(q, q, 1);
+
+            uint64_t p[4] = {0, 0, 0, 0};
+            mpz_export(p, nullptr, -1, sizeof(uint64_t), 0, 0, q);
+            mpz_clear(q);
+
+            setModulus(modulus, p);
+
+            Element u, uu;
+            F.copy(u.a, F.zero());
+            F.copy(u.b, F.one());
+            f.mul(uu, u, u);
+
+            fused = mulx
+                 && sizeof(Element) == 8 * sizeof(uint64_t)
+                 && F.eq(uu.a, F.negOne())
+                 && F.isZero(uu.b);
+        }
+
+        bool isFused() const { return fused; }
+        const Modulus &getModulus() const { return modulus; }
+
+        void mul(Element &r, Element &a, Element &b) {
+            if (fused) {
+                mulQuadratic((uint64_t *)&r, (const uint64_t *)&a, (const uint64_t *)&b, modulus, mulx);
+            } else {
+                f.mul(r, a, b);
+            }
+        }
+
+        void square(Element &r, Element &a) {
+            if (fused) {
+                squareQuadratic((uint64_t *)&r, (const uint64_t *)&a, modulus, mulx);
+            } else {
+                f.square(r, a);
+            }
+        }
+    };
+}
+
+#endif // MONTGOMERY_HPP
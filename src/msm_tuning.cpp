@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <cerrno>
+#include <cstdio>
+
+#include "msm_tuning.hpp"
+
+namespace MultiExp {
+
+uint64_t WindowTable::logSize(uint64_t n)
+{
+    uint64_t logN = 0;
+
+    while (n > 1) {
+        n >>= 1;
+        logN++;
+    }
+    return logN;
+}
+
+bool WindowTable::find(uint64_t n, bool signedDigits, uint64_t nTasks, WindowChoice &r) const
+{
+    auto it = choices.find(Key{logSize(n), signedDigits, nTasks});
+
+    if (it == choices.end()) {
+        return false;
+    }
+
+    r = it->second;
+    return true;
+}
+
+void WindowTable::set(uint64_t n, bool signedDigits, uint64_t nTasks, const WindowChoice &choice)
+{
+    choices[Key{logSize(n), signedDigits, nTasks}] = choice;
+}
+
+uint64_t WindowTable::maxBits(uint64_t n, bool signedDigits, uint64_t nTasks) const
+{
+    const uint64_t logN = logSize(n);
+    uint64_t bits = 0;
+
+    for (const auto &entry : choices) {
+        if (entry.first.logN <= logN &&
+            entry.first.signedDigits == signedDigits &&
+            entry.first.nTasks == nTasks)
+        {
+            bits = std::max(bits, entry.second.bitsPerChunk);
+        }
+    }
+    return bits;
+}
+
+TuningProfile::TuningProfile()
+    : host(hostKey())
+{
+}
+
+std::string TuningProfile::hostKey()
+{
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    std::string model = "unknown";
+
+    while (std::getline(cpuinfo, line)) {
+        if (line.compare(0, 10, "model name") == 0) {
+            auto pos = line.find(':');
+
+            if (pos != std::string::npos) {
+                pos = line.find_first_not_of(" \t", pos + 1);
+                model = pos != std::string::npos ? line.substr(pos) : "unknown";
+            }
+            break;
+        }
+    }
+
+    // The key is the first field of a tab-separated line.
+    for (char &c : model) {
+        if (c == '\t') {
+            c = ' ';
+        }
+    }
+
+    return model + "/" + std::to_string(std::thread::hardware_concurrency());
+}
+
+static const char *groupNames[nCurveGroups] = {"g1", "g2"};
+static const char *strategyNames[] = {"points", "windows"};
+
+void TuningProfile::load(const std::string &path)
+{
+    std::ifstream file(path);
+
+    if (!file) {
+        if (errno == ENOENT) {
+            return;
+        }
+        throw std::system_error(errno, std::generic_category(), "open " + path);
+    }
+
+    std::string line;
+
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        std::string lineHost, group, strategy;
+        uint64_t logN, signedDigits, nTasks, bits;
+
+        if (!std::getline(fields, lineHost, '\t') || lineHost != host) {
+            continue;
+        }
+
+        if (!(fields >> group >> logN >> signedDigits >> nTasks >> bits >> strategy) ||
+            bits < 2 || bits > 16)
+        {
+            throw std::invalid_argument("Invalid tuning profile line: " + line);
+        }
+
+        WindowTable *t = nullptr;
+        for (int g = 0; g < nCurveGroups; g++) {
+            if (group == groupNames[g]) {
+                t = &tables[g];
+            }
+        }
+
+        WindowChoice choice;
+        choice.bitsPerChunk = bits;
+
+        if (strategy == strategyNames[SplitPoints]) {
+            choice.strategy = SplitPoints;
+        } else if (strategy == strategyNames[SplitWindows]) {
+            choice.strategy = SplitWindows;
+        } else {
+            t = nullptr;
+        }
+
+        if (t == nullptr) {
+            throw std::invalid_argument("Invalid tuning profile line: " + line);
+        }
+
+        t->choices[WindowTable::Key{logN, signedDigits != 0, nTasks}] = choice;
+    }
+}
+
+void TuningProfile::save(const std::string &path) const
+{
+    std::vector<std::string> lines;
+
+    {
+        std::ifstream file(path);
+        std::string line;
+
+        while (std::getline(file, line)) {
+            if (line.compare(0, line.find('\t'), host) != 0) {
+                lines.push_back(line);
+            }
+        }
+    }
+
+    for (int g = 0; g < nCurveGroups; g++) {
+        for (const auto &entry : tables[g].choices) {
+            std::ostringstream line;
+
+            line << host << '\t'
+                 << groupNames[g] << '\t'
+                 << entry.first.logN << '\t'
+                 << entry.first.signedDigits << '\t'
+                 << entry.first.nTasks << '\t'
+                 << entry.second.bitsPerChunk << '\t'
+                 << strategyNames[entry.second.strategy];
+
+            lines.push_back(line.str());
+        }
+    }
+
+    // Written aside and renamed, so concurrent provers never read half a file.
+    const std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::trunc);
+
+        for (const std::string &line : lines) {
+            file << line << '\n';
+        }
+
+        if (!file.flush()) {
+            throw std::system_error(errno, std::generic_category(), "write " + tmpPath);
+        }
+    }
+
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        throw std::system_error(errno, std::generic_category(), "rename " + path);
+    }
+}
+
+} // Namespace
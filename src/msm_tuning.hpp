@@ -0,0 +1,87 @@
+#ifndef MSM_TUNING_HPP
+#define MSM_TUNING_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace MultiExp {
+
+    // How the bucket method is spread over the tasks: ranges of points
+    // with all the windows each, or groups of windows, split further by
+    // ranges of points when there are more tasks than windows.
+    enum Strategy {
+        SplitPoints,
+        SplitWindows
+    };
+
+    struct WindowChoice {
+        uint64_t bitsPerChunk;
+        Strategy strategy;
+    };
+
+    // Tuned window choices of the multiexps of one curve group, by size
+    // (log2 of the number of points), digit mode and number of tasks.
+    class WindowTable {
+
+        struct Key {
+            uint64_t logN;
+            bool signedDigits;
+            uint64_t nTasks;
+
+            bool operator<(const Key &k) const {
+                if (logN != k.logN) return logN < k.logN;
+                if (signedDigits != k.signedDigits) return signedDigits < k.signedDigits;
+                return nTasks < k.nTasks;
+            }
+        };
+
+        std::map<Key, WindowChoice> choices;
+
+        friend class TuningProfile;
+
+    public:
+        static uint64_t logSize(uint64_t n);
+
+        bool empty() const { return choices.empty(); }
+
+        bool find(uint64_t n, bool signedDigits, uint64_t nTasks, WindowChoice &r) const;
+        void set(uint64_t n, bool signedDigits, uint64_t nTasks, const WindowChoice &choice);
+
+        // Widest window chosen for multiexps of at most 'n' points.
+        uint64_t maxBits(uint64_t n, bool signedDigits, uint64_t nTasks) const;
+    };
+
+    enum CurveGroup {
+        GroupG1,
+        GroupG2,
+        nCurveGroups
+    };
+
+    // Window tables of this host. The profile file holds the tables of
+    // any number of hosts, keyed by CPU model and hardware thread count,
+    // one choice per line.
+    class TuningProfile {
+
+        std::string host;
+        WindowTable tables[nCurveGroups];
+
+    public:
+        TuningProfile();
+
+        static std::string hostKey();
+
+        const std::string &getHost() const { return host; }
+
+        WindowTable &table(CurveGroup group) { return tables[group]; }
+        const WindowTable &table(CurveGroup group) const { return tables[group]; }
+
+        // Reads the choices of this host; a missing file reads as empty.
+        void load(const std::string &path);
+
+        // Rewrites the choices of this host, keeping those of other hosts.
+        void save(const std::string &path) const;
+    };
+}
+
+#endif // MSM_TUNING_HPP
@@ -0,0 +1,679 @@
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+namespace MultiExp {
+
+template <typename Curve>
+uint64_t Pippenger<Curve>::log2(uint64_t n) {
+    uint64_t r = 0;
+    while ((n >> r) > 1) {
+        r++;
+    }
+    return r;
+}
+
+template <typename Curve>
+uint64_t Pippenger<Curve>::calcBitsPerChunk(uint64_t n) {
+#ifdef MSM_BITS_PER_CHUNK
+    return MSM_BITS_PER_CHUNK;
+#else
+    const uint64_t bits = log2(n);
+
+    return std::min<uint64_t>(16, std::max<uint64_t>(2, bits > 3 ? bits - 3 : 2));
+#endif
+}
+
+template <typename Curve>
+uint64_t Pippenger<Curve>::windowBits(uint64_t n) const {
+#ifdef MSM_BITS_PER_CHUNK
+    return MSM_BITS_PER_CHUNK;
+#else
+    // Signed digits get one more bit for the same bucket memory.
+    return signedDigits ? std::min<uint64_t>(16, calcBitsPerChunk(n) + 1) : calcBitsPerChunk(n);
+#endif
+}
+
+template <typename Curve>
+WindowChoice Pippenger<Curve>::windowChoice(uint64_t n) const {
+    WindowChoice choice;
+
+    if (windowTable == nullptr || !windowTable->find(n, signedDigits, nTasks, choice)) {
+        choice.bitsPerChunk = windowBits(n);
+        choice.strategy = SplitPoints;
+    }
+
+#ifdef MSM_BITS_PER_CHUNK
+    choice.bitsPerChunk = MSM_BITS_PER_CHUNK;
+#endif
+    return choice;
+}
+
+template <typename Curve>
+uint64_t Pippenger<Curve>::bucketCount(uint64_t bitsPerChunk) const {
+    return signedDigits ? 1ULL << (bitsPerChunk - 1) : (1ULL << bitsPerChunk) - 1;
+}
+
+template <typename Curve>
+uint64_t Pippenger<Curve>::chunkCount(uint64_t scalarBits, uint64_t bitsPerChunk) const {
+    return windowCount(scalarBits, bitsPerChunk, signedDigits);
+}
+
+template <typename Curve>
+uint64_t Pippenger<Curve>::affineBatchSize(uint64_t nBuckets, uint64_t nBatch) const {
+
+    // With too few buckets the batches of affine additions would be too
+    // small to pay for their inversion.
+    const uint64_t affineBatch = std::min(BatchAffine::BucketSum<Curve>::maxBatchSize, nBatch * nBuckets / 4);
+
+    return batchAffine && affineBatch >= 64 ? affineBatch : 0;
+}
+
+template <typename Curve>
+typename Pippenger<Curve>::Pass Pippenger<Curve>::makePass(
+    uint64_t scalarBits,
+    uint64_t n,
+    uint64_t bitsPerChunk,
+    Strategy strategy,
+    uint64_t tasks,
+    const ShiftedBases<Curve> *shifted) const
+{
+    Pass pass;
+
+    pass.bitsPerChunk = bitsPerChunk;
+    pass.nChunks = chunkCount(scalarBits, bitsPerChunk);
+    pass.windowsPerCopy = shifted ? std::min(pass.nChunks, shifted->windowsPerCopy) : pass.nChunks;
+    pass.nCopies = (pass.nChunks + pass.windowsPerCopy - 1) / pass.windowsPerCopy;
+    pass.nBuckets = bucketCount(bitsPerChunk);
+
+    // A task takes a range of points (a slice) and a group of windows.
+    // Split by points, every task passes over all the windows of its
+    // slice; split by windows, the tasks share the windows and the points
+    // are only sliced for the tasks left over.
+    pass.nGroups = 1;
+    pass.nSlices = std::min(tasks, n);
+
+    if (strategy == SplitWindows) {
+        pass.nGroups = std::min(tasks, pass.windowsPerCopy);
+        pass.nSlices = std::max<uint64_t>(1, std::min(n, tasks / pass.nGroups));
+    }
+
+    return pass;
+}
+
+template <typename Curve>
+uint64_t Pippenger<Curve>::passScratch(const Pass &pass, uint64_t nBatch) const {
+    return nBatch * (pass.nSlices * pass.nGroups * pass.nBuckets + pass.nSlices * pass.windowsPerCopy) * sizeof(Point);
+}
+
+template <typename Curve>
+uint64_t Pippenger<Curve>::passAffine(const Pass &pass, uint64_t nBatch) const {
+    if (affineBatchSize(pass.nBuckets, nBatch) == 0) {
+        return 0;
+    }
+
+    // Every running task holds a set of affine buckets and their states.
+    return std::min(nTasks, pass.nSlices * pass.nGroups) * nBatch * pass.nBuckets * (sizeof(PointAffine) + 1);
+}
+
+template <typename Curve>
+uint64_t Pippenger<Curve>::passDigits(const Pass &pass, uint64_t n, uint64_t nBatch) const {
+    return signedDigits || digitCache ? nBatch * n * pass.nChunks * sizeof(uint16_t) : 0;
+}
+
+template <typename Curve>
+uint64_t Pippenger<Curve>::passMemory(const Pass &pass, uint64_t n, uint64_t nBatch) const {
+    return passScratch(pass, nBatch) + passAffine(pass, nBatch) + passDigits(pass, n, nBatch);
+}
+
+template <typename Curve>
+void Pippenger<Curve>::bitsRange(uint64_t &minBits, uint64_t &maxBits) {
+#ifdef MSM_BITS_PER_CHUNK
+    minBits = maxBits = MSM_BITS_PER_CHUNK;
+#else
+    // The digits are kept in 16 bits.
+    minBits = 2;
+    maxBits = 16;
+#endif
+}
+
+template <typename Curve>
+typename Pippenger<Curve>::Pass Pippenger<Curve>::leastPass(uint64_t scalarBits, uint64_t n, uint64_t nBatch) const {
+    uint64_t minBits, maxBits;
+    bitsRange(minBits, maxBits);
+
+    // Narrow windows take fewer buckets but more digits. The affine
+    // buckets are left out, so the pass does not depend on them.
+    Pass least = makePass(scalarBits, n, minBits, SplitPoints, 1, nullptr);
+    uint64_t leastMemory = passScratch(least, nBatch) + passDigits(least, n, nBatch);
+
+    for (uint64_t bits = minBits + 1; bits <= maxBits; bits++) {
+        const Pass pass = makePass(scalarBits, n, bits, SplitPoints, 1, nullptr);
+        const uint64_t memory = passScratch(pass, nBatch) + passDigits(pass, n, nBatch);
+
+        if (memory < leastMemory) {
+            least = pass;
+            leastMemory = memory;
+        }
+    }
+
+    return least;
+}
+
+template <typename Curve>
+typename Pippenger<Curve>::Pass Pippenger<Curve>::fitPass(uint64_t scalarBits, uint64_t n, uint64_t nBatch) const {
+    uint64_t minBits, maxBits;
+    bitsRange(minBits, maxBits);
+
+    // Narrower windows take more passes over the points and fewer tasks
+    // take longer each, so the pass of the least time that fits is taken,
+    // with the time of a task taken as its point additions plus the bucket
+    // reductions, window by window.
+    Pass best = leastPass(scalarBits, n, nBatch);
+    double bestTime = std::numeric_limits<double>::max();
+
+    for (uint64_t bits = minBits; bits <= maxBits; bits++) {
+        for (uint64_t tasks = 1; tasks <= nTasks; tasks++) {
+            const Pass pass = makePass(scalarBits, n, bits, SplitPoints, tasks, nullptr);
+
+            if (passMemory(pass, n, nBatch) > memoryLimit) {
+                break;
+            }
+
+            const double time = pass.nChunks * ((double)n / pass.nSlices + 2.0 * pass.nBuckets);
+
+            if (time < bestTime) {
+                bestTime = time;
+                best = pass;
+            }
+        }
+    }
+
+    return best;
+}
+
+template <typename Curve>
+typename Pippenger<Curve>::Pass Pippenger<Curve>::choosePass(
+    uint64_t scalarBits,
+    uint64_t n,
+    uint64_t nBatch,
+    ShiftedBases<Curve> *&shifted) const
+{
+    if (shifted && shifted->nCopies * shifted->windowsPerCopy < chunkCount(scalarBits, shifted->bitsPerChunk)) {
+        shifted = nullptr;
+    }
+
+    const WindowChoice choice = windowChoice(n);
+    const Pass pass = makePass(scalarBits, n, shifted ? shifted->bitsPerChunk : choice.bitsPerChunk, choice.strategy, nTasks, shifted);
+
+    if (memoryLimit == 0 || passMemory(pass, n, nBatch) <= memoryLimit) {
+        return pass;
+    }
+
+    // Past the memory limit the pass goes without the shifted copies and
+    // with the window width and number of tasks that fit it best.
+    shifted = nullptr;
+    return fitPass(scalarBits, n, nBatch);
+}
+
+template <typename Curve>
+uint64_t Pippenger<Curve>::windowWidth(uint64_t scalarBits, uint64_t n, uint64_t nBatch) const {
+    ShiftedBases<Curve> *shifted = nullptr;
+
+    return choosePass(scalarBits, n, nBatch, shifted).bitsPerChunk;
+}
+
+template <typename Curve>
+void Pippenger<Curve>::reduceBuckets(Point &r, Point *buckets, uint64_t nBuckets) {
+    Point acc;
+    Point sum;
+
+    g.copy(acc, g.zero());
+    g.copy(sum, g.zero());
+
+    for (int64_t k = nBuckets - 1; k >= 0; k--) {
+        g.add(acc, acc, buckets[k]);
+        g.add(sum, sum, acc);
+    }
+
+    g.copy(r, sum);
+}
+
+template <typename Curve>
+uint64_t Pippenger<Curve>::windowScratch(uint64_t scalarBits, uint64_t n) const {
+
+    // MSMs over a subset of the points may use narrower windows, and so
+    // more of them, so take the largest need of any narrower window too.
+    // Tuned windows may be wider than the default ones, and splitting by
+    // windows takes a bucket set per task even for fewer points.
+    const uint64_t nSlices = std::min(nTasks, n);
+    const uint64_t nSets = windowTable ? nTasks : nSlices;
+    uint64_t maxBits = windowBits(n);
+    uint64_t nPoints = 0;
+
+#ifndef MSM_BITS_PER_CHUNK
+    if (windowTable) {
+        maxBits = std::max(maxBits, windowTable->maxBits(n, signedDigits, nTasks));
+    }
+#endif
+
+    for (uint64_t bitsPerChunk = 2; bitsPerChunk <= maxBits; bitsPerChunk++) {
+        const uint64_t nChunks = chunkCount(scalarBits, bitsPerChunk);
+        const uint64_t nBuckets = bucketCount(bitsPerChunk);
+
+        nPoints = std::max(nPoints, nSets * nBuckets + nSlices * nChunks);
+    }
+
+    return nPoints;
+}
+
+template <typename Curve>
+uint64_t Pippenger<Curve>::scratchSize(uint64_t scalarSize, uint64_t n, uint64_t nBatch, bool glv) const {
+    if (n == 0) {
+        return 0;
+    }
+
+    uint64_t nPoints = windowScratch(scalarSize*8, n);
+
+    if (glv) {
+        nPoints = std::max(nPoints, windowScratch(GlvSplit::halfSize*8, 2*n));
+    }
+
+    const uint64_t size = nBatch * nPoints * sizeof(Point);
+
+    if (memoryLimit == 0) {
+        return size;
+    }
+
+    // A pass keeps its scratch within the limit or, when none fits it,
+    // takes the one of the least memory; both may be wider than the
+    // passes without a limit.
+    uint64_t leastScratch = passScratch(leastPass(scalarSize*8, n, nBatch), nBatch);
+
+    if (glv) {
+        leastScratch = std::max(leastScratch, passScratch(leastPass(GlvSplit::halfSize*8, 2*n, nBatch), nBatch));
+    }
+
+    return std::max(memoryLimit, leastScratch);
+}
+
+template <typename Curve>
+uint64_t Pippenger<Curve>::memorySize(uint64_t scalarSize, uint64_t n, uint64_t nBatch, bool glv) const {
+    if (n == 0) {
+        return 0;
+    }
+
+    // Past the scratch area a pass takes the affine buckets of its tasks
+    // and, without a digit cache, the signed digits it decodes.
+    uint64_t heap = 0;
+
+    for (int half = 0; half < (glv ? 2 : 1); half++) {
+        const uint64_t scalarBits = half ? GlvSplit::halfSize*8 : scalarSize*8;
+        const uint64_t nScalars = half ? 2*n : n;
+        ShiftedBases<Curve> *shifted = nullptr;
+        const Pass pass = choosePass(scalarBits, nScalars, nBatch, shifted);
+        const uint64_t passHeap = passAffine(pass, nBatch) + (digitCache ? 0 : passDigits(pass, nScalars, nBatch));
+
+        heap = std::max(heap, passHeap);
+    }
+
+    return scratchSize(scalarSize, n, nBatch, glv) + heap;
+}
+
+template <typename Curve>
+void Pippenger<Curve>::run(Point &r, PointAffine *bases, uint8_t *scalars, uint64_t scalarSize, uint64_t n, void *scratch) {
+    runBatch(&r, bases, &scalars, scalarSize, n, 1, scratch);
+}
+
+template <typename Curve>
+void Pippenger<Curve>::tune(WindowTable &table, PointAffine *bases, uint8_t *scalars, uint64_t scalarSize, uint64_t n) {
+    WindowChoice best;
+
+    if (n == 0 || table.find(n, signedDigits, nTasks, best)) {
+        return;
+    }
+
+    const uint64_t defaultBits = windowBits(n);
+#ifdef MSM_BITS_PER_CHUNK
+    const uint64_t minBits = defaultBits;
+    const uint64_t maxBits = defaultBits;
+#else
+    const uint64_t minBits = std::max<uint64_t>(2, defaultBits - 2);
+    const uint64_t maxBits = std::min<uint64_t>(16, defaultBits + 2);
+#endif
+    // With one task both splits are the same.
+    const int nStrategies = nTasks > 1 ? 2 : 1;
+
+    const WindowTable *savedTable = windowTable;
+    WindowTable candidate;
+    double bestTime = std::numeric_limits<double>::max();
+    Point r;
+
+    for (uint64_t bits = minBits; bits <= maxBits; bits++) {
+        for (int strategy = 0; strategy < nStrategies; strategy++) {
+            const WindowChoice choice = {bits, (Strategy)strategy};
+
+            candidate.set(n, signedDigits, nTasks, choice);
+            windowTable = &candidate;
+
+            auto start = std::chrono::steady_clock::now();
+            run(r, bases, scalars, scalarSize, n);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+            if (elapsed.count() < bestTime) {
+                bestTime = elapsed.count();
+                best = choice;
+            }
+        }
+    }
+
+    windowTable = savedTable;
+    table.set(n, signedDigits, nTasks, best);
+}
+
+template <typename Curve>
+void Pippenger<Curve>::shiftBases(ShiftedBases<Curve> &r, PointAffine *bases, uint64_t scalarSize, uint64_t n, uint64_t nCopies) {
+
+    r.bitsPerChunk = windowChoice(n).bitsPerChunk;
+    r.nCopies = std::max<uint64_t>(1, std::min(nCopies, chunkCount(scalarSize*8, r.bitsPerChunk)));
+    r.windowsPerCopy = (chunkCount(scalarSize*8, r.bitsPerChunk) + r.nCopies - 1) / r.nCopies;
+    r.n = n;
+    r.points.resize((r.nCopies - 1) * n);
+
+    const uint64_t shift = r.windowsPerCopy * r.bitsPerChunk;
+
+    threadPool.parallelFor(0, n, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        Point p;
+
+        for (int64_t i = begin; i < end; i++) {
+            g.copy(p, bases[i]);
+
+            for (uint64_t k = 1; k < r.nCopies; k++) {
+                for (uint64_t d = 0; d < shift; d++) {
+                    g.dbl(p, p);
+                }
+                g.copy(r.points[(k - 1)*n + i], p);
+            }
+        }
+    });
+}
+
+template <typename Curve>
+void Pippenger<Curve>::runBatch(
+    Point *r,
+    PointAffine *bases,
+    uint8_t *const *scalars,
+    uint64_t scalarSize,
+    uint64_t n,
+    uint64_t nBatch,
+    void *scratch,
+    ShiftedBases<Curve> *shifted)
+{
+    PlainSource source = {bases};
+
+    accumulate(r, source, scalars, scalarSize, scalarSize*8, nullptr, n, nBatch, scratch, shifted);
+}
+
+template <typename Curve>
+void Pippenger<Curve>::runGlv(Point *r, PointAffine *bases, const GlvInput<Curve> &glv, uint64_t n, uint64_t nBatch, void *scratch) {
+    GlvSource source = {bases, glv};
+
+    accumulate(r, source, glv.scalars->halves.data(), GlvSplit::halfSize, GlvSplit::halfSize*8, nullptr, 2*n, nBatch, scratch);
+}
+
+template <typename Curve>
+void Pippenger<Curve>::runProfiled(
+    Point *r,
+    PointAffine *bases,
+    uint8_t *const *scalars,
+    uint64_t scalarSize,
+    uint64_t nBatch,
+    const ScalarProfile &profile,
+    void *scratch,
+    const GlvInput<Curve> *glv,
+    ShiftedBases<Curve> *shifted)
+{
+    PlainSource source = {bases};
+    std::vector<Point> partial(nBatch);
+
+    sumOnes(r, bases, scalars, scalarSize, nBatch, profile);
+
+    accumulate(partial.data(), source, scalars, scalarSize, shortScalarBits,
+               profile.indices(ScalarShort).data(), profile.count(ScalarShort), nBatch, scratch, shifted);
+
+    for (uint64_t w = 0; w < nBatch; w++) {
+        g.add(r[w], r[w], partial[w]);
+    }
+
+    if (glv && !shifted) {
+        const std::vector<uint32_t> &full = profile.indices(ScalarFull);
+        std::vector<uint32_t> halves(2*full.size());
+
+        for (uint64_t i = 0; i < full.size(); i++) {
+            halves[2*i] = 2*full[i];
+            halves[2*i + 1] = 2*full[i] + 1;
+        }
+
+        GlvSource glvSource = {bases, *glv};
+
+        accumulate(partial.data(), glvSource, glv->scalars->halves.data(), GlvSplit::halfSize, GlvSplit::halfSize*8,
+                   halves.data(), halves.size(), nBatch, scratch);
+    } else {
+        accumulate(partial.data(), source, scalars, scalarSize, scalarSize*8,
+                   profile.indices(ScalarFull).data(), profile.count(ScalarFull), nBatch, scratch, shifted);
+    }
+
+    for (uint64_t w = 0; w < nBatch; w++) {
+        g.add(r[w], r[w], partial[w]);
+    }
+}
+
+template <typename Curve>
+void Pippenger<Curve>::sumOnes(Point *r, PointAffine *bases, uint8_t *const *scalars, uint64_t scalarSize, uint64_t nBatch, const ScalarProfile &profile) {
+
+    const std::vector<uint32_t> &ones = profile.indices(ScalarOne);
+    const uint64_t n = ones.size();
+    const uint64_t nSlices = std::max<uint64_t>(1, std::min(nTasks, n / BatchAffine::PointSum<Curve>::chunkSize));
+
+    std::vector<Point> sums(nSlices * nBatch);
+
+    threadPool.parallelFor(0, nSlices, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        BatchAffine::PointSum<Curve> pointSum(g, F);
+        std::vector<uint32_t> selected;
+
+        for (int64_t s = begin; s < end; s++) {
+            const uint64_t from = n * s / nSlices;
+            const uint64_t to = n * (s + 1) / nSlices;
+
+            for (uint64_t w = 0; w < nBatch; w++) {
+                Point &sum = sums[s*nBatch + w];
+                g.copy(sum, g.zero());
+
+                if (nBatch == 1) {
+                    pointSum.add(sum, bases, ones.data() + from, to - from);
+                    continue;
+                }
+
+                // In a batch the other scalars of the class are zero.
+                selected.clear();
+                for (uint64_t i = from; i < to; i++) {
+                    if (classifyScalar(scalars[w] + ones[i]*scalarSize, scalarSize) == ScalarOne) {
+                        selected.push_back(ones[i]);
+                    }
+                }
+                pointSum.add(sum, bases, selected.data(), selected.size());
+            }
+        }
+    });
+
+    for (uint64_t w = 0; w < nBatch; w++) {
+        g.copy(r[w], g.zero());
+
+        for (uint64_t s = 0; s < nSlices; s++) {
+            g.add(r[w], r[w], sums[s*nBatch + w]);
+        }
+    }
+}
+
+template <typename Curve>
+template <typename Source>
+void Pippenger<Curve>::accumulate(
+    Point *r,
+    const Source &source,
+    uint8_t *const *scalars,
+    uint64_t scalarSize,
+    uint64_t scalarBits,
+    const uint32_t *indices,
+    uint64_t n,
+    uint64_t nBatch,
+    void *scratch,
+    ShiftedBases<Curve> *shifted)
+{
+    if (n == 0) {
+        for (uint64_t w = 0; w < nBatch; w++) {
+            g.copy(r[w], g.zero());
+        }
+        return;
+    }
+
+    // Shifted copies of the bases stand for groups of windows: window
+    // k*windowsPerCopy + t is added with copy k in the pass over window t.
+    const Pass pass = choosePass(scalarBits, n, nBatch, shifted);
+    const uint64_t bitsPerChunk = pass.bitsPerChunk;
+    const uint64_t nChunks = pass.nChunks;
+    const uint64_t windowsPerCopy = pass.windowsPerCopy;
+    const uint64_t nCopies = pass.nCopies;
+    const uint64_t nBuckets = pass.nBuckets;
+    const uint64_t nGroups = pass.nGroups;
+    const uint64_t nSlices = pass.nSlices;
+
+    // The digits cover every scalar up to the last one used. Without a
+    // cache only the signed ones are decoded ahead, as they need the
+    // carries of the lower windows.
+    const uint64_t nScalars = indices ? indices[n - 1] + 1 : n;
+    DigitView digits = {nullptr, 0};
+    WindowDigits ownDigits;
+
+    if (digitCache) {
+        digits = digitCache->get(scalars, scalarSize, scalarBits, nScalars, nBatch, bitsPerChunk, signedDigits, threadPool);
+    } else if (signedDigits) {
+        ownDigits.build(scalars, scalarSize, scalarBits, nScalars, nBatch, bitsPerChunk, true, threadPool);
+        digits.digits = &ownDigits;
+    }
+
+    std::vector<Point> ownScratch;
+
+    if (scratch == nullptr) {
+        ownScratch.resize(nBatch * (nSlices * nGroups * nBuckets + nSlices * windowsPerCopy));
+        scratch = ownScratch.data();
+    }
+
+    // chunkSums[(s*windowsPerCopy + t)*nBatch + w] is the sum of the pass
+    // over window t of slice s for the scalar vector w.
+    Point *chunkSums = (Point *)scratch;
+    Point *allBuckets = chunkSums + nSlices * windowsPerCopy * nBatch;
+
+    const uint64_t affineBatch = affineBatchSize(nBuckets, nBatch);
+    const bool affineBuckets = affineBatch != 0;
+
+    // Every task owns its buckets and writes the sums of distinct windows
+    // of its slice, so the tasks need no synchronization until the final
+    // combination. Each point is read once per window for all the scalar
+    // vectors.
+    threadPool.parallelFor(0, nSlices * nGroups, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        MixedAdd<Curve, Field> mixedAdd(g, F);
+        std::unique_ptr<BatchAffine::BucketSum<Curve>> bucketSum;
+
+        if (affineBuckets) {
+            bucketSum.reset(new BatchAffine::BucketSum<Curve>(g, F, nBatch * nBuckets, affineBatch));
+        }
+
+        for (int64_t q = begin; q < end; q++) {
+            const uint64_t s = q / nGroups;
+            const uint64_t group = q % nGroups;
+            const uint64_t from = n * s / nSlices;
+            const uint64_t to = n * (s + 1) / nSlices;
+            Point *buckets = allBuckets + q * nBatch * nBuckets;
+
+            for (uint64_t t = windowsPerCopy * group / nGroups; t < windowsPerCopy * (group + 1) / nGroups; t++) {
+                for (uint64_t k = 0; k < nBatch * nBuckets; k++) {
+                    g.copy(buckets[k], g.zero());
+                }
+
+                if (bucketSum) {
+                    bucketSum->start(buckets);
+                }
+
+                for (uint64_t i = from; i < to; i++) {
+                    const uint64_t p = indices ? indices[i] : i;
+
+                    for (uint64_t c = 0; c < nCopies; c++) {
+                        const uint64_t j = c*windowsPerCopy + t;
+                        PointAffine tmp;
+                        PointAffine *base = nullptr;
+
+                        if (j >= nChunks) {
+                            break;
+                        }
+
+                        for (uint64_t w = 0; w < nBatch; w++) {
+                            int32_t digit = digits.digits ? digits.digit(p, w, j)
+                                                   : windowDigit(scalars[w] + p*scalarSize, scalarSize, j*bitsPerChunk, bitsPerChunk);
+
+                            if (digit == 0) {
+                                continue;
+                            }
+
+                            if (base == nullptr) {
+                                base = c ? &shifted->points[(c - 1)*shifted->n + p] : &source.point(p, tmp);
+                            }
+
+                            bool negative = source.negative(p, w);
+
+                            if (digit < 0) {
+                                digit = -digit;
+                                negative = !negative;
+                            }
+
+                            const uint64_t k = w*nBuckets + digit - 1;
+
+                            if (bucketSum) {
+                                bucketSum->add(k, *base, negative);
+                            } else if (negative) {
+                                mixedAdd.sub(buckets[k], *base);
+                            } else {
+                                mixedAdd.add(buckets[k], *base);
+                            }
+                        }
+                    }
+                }
+
+                if (bucketSum) {
+                    bucketSum->finish();
+                }
+
+                for (uint64_t w = 0; w < nBatch; w++) {
+                    reduceBuckets(chunkSums[(s*windowsPerCopy + t)*nBatch + w], buckets + w*nBuckets, nBuckets);
+                }
+            }
+        }
+    });
+
+    for (uint64_t w = 0; w < nBatch; w++) {
+        Point acc;
+        g.copy(acc, g.zero());
+
+        for (int64_t t = windowsPerCopy - 1; t >= 0; t--) {
+            for (uint64_t k = 0; k < bitsPerChunk; k++) {
+                g.dbl(acc, acc);
+            }
+            for (uint64_t s = 0; s < nSlices; s++) {
+                g.add(acc, acc, chunkSums[(s*windowsPerCopy + t)*nBatch + w]);
+            }
+        }
+
+        g.copy(r[w], acc);
+    }
+}
+
+} // namespace
@@ -0,0 +1,238 @@
+#ifndef MULTIEXP_HPP
+#define MULTIEXP_HPP
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "threadpool.hpp"
+#include "scalar_profile.hpp"
+#include "batch_affine.hpp"
+#include "mixed_add.hpp"
+#include "glv.hpp"
+#include "window_digits.hpp"
+#include "msm_tuning.hpp"
+
+namespace MultiExp {
+
+    // Copies 2^(k*windowsPerCopy*bitsPerChunk)*P of the bases P, for
+    // 0 < k < nCopies, at points[(k-1)*n + i]. A multiexp over them adds
+    // every window group with its own copy into the same buckets, so only
+    // the doubling chain of windowsPerCopy windows remains.
+    template <typename Curve>
+    struct ShiftedBases {
+        uint64_t bitsPerChunk;
+        uint64_t windowsPerCopy;
+        uint64_t nCopies;
+        uint64_t n;
+        std::vector<typename Curve::PointAffine> points;
+    };
+
+    // Bucket (Pippenger) multi-scalar multiplication that runs on an
+    // explicitly given thread pool, so that several MSMs can be executed at
+    // the same time on disjoint sets of cores.
+    template <typename Curve>
+    class Pippenger {
+
+        typedef typename Curve::Point Point;
+        typedef typename Curve::PointAffine PointAffine;
+        typedef typename BatchAffine::CurveField<Curve>::Type Field;
+
+        Curve &g;
+        Field &F;
+        ThreadPool &threadPool;
+        uint64_t nTasks;
+        bool signedDigits;
+        DigitCache *digitCache;
+        bool batchAffine;
+        const WindowTable *windowTable;
+        uint64_t memoryLimit;
+
+        // Windows and tasks of the bucket method over a set of points.
+        struct Pass {
+            uint64_t bitsPerChunk;
+            uint64_t nChunks;
+            uint64_t windowsPerCopy;
+            uint64_t nCopies;
+            uint64_t nBuckets;
+            uint64_t nGroups;
+            uint64_t nSlices;
+        };
+
+        static uint64_t log2(uint64_t n);
+
+        // Points of the bucket method: point(p) is the base of scalar p and
+        // negative(p, w) tells whether it is subtracted for scalar vector w.
+        struct PlainSource {
+            PointAffine *bases;
+
+            PointAffine &point(uint64_t p, PointAffine &) const { return bases[p]; }
+            bool negative(uint64_t, uint64_t) const { return false; }
+        };
+
+        // Scalar v of a GLV split belongs to bases[v/2] for even v and to
+        // its endomorphism image for odd v.
+        struct GlvSource {
+            PointAffine *bases;
+            const GlvInput<Curve> &glv;
+
+            PointAffine &point(uint64_t v, PointAffine &tmp) const {
+                if ((v & 1) == 0) {
+                    return bases[v >> 1];
+                }
+                if (glv.endoBases) {
+                    return glv.endoBases[v >> 1];
+                }
+                glv.endomorphism->apply(tmp, bases[v >> 1]);
+                return tmp;
+            }
+            bool negative(uint64_t v, uint64_t w) const { return glv.scalars->negative[w][v]; }
+        };
+
+        uint64_t windowBits(uint64_t n) const;
+        WindowChoice windowChoice(uint64_t n) const;
+        uint64_t bucketCount(uint64_t bitsPerChunk) const;
+        uint64_t chunkCount(uint64_t scalarBits, uint64_t bitsPerChunk) const;
+        uint64_t windowScratch(uint64_t scalarBits, uint64_t n) const;
+
+        // Batch of the affine bucket additions, 0 if they are not used.
+        uint64_t affineBatchSize(uint64_t nBuckets, uint64_t nBatch) const;
+
+        Pass makePass(uint64_t scalarBits, uint64_t n, uint64_t bitsPerChunk, Strategy strategy, uint64_t tasks,
+                      const ShiftedBases<Curve> *shifted) const;
+
+        // Bytes of the memory of a pass over n points: the xyzz buckets
+        // and window sums of its scratch area, the affine buckets of its
+        // tasks and the window digits it decodes ahead.
+        uint64_t passScratch(const Pass &pass, uint64_t nBatch) const;
+        uint64_t passAffine(const Pass &pass, uint64_t nBatch) const;
+        uint64_t passDigits(const Pass &pass, uint64_t n, uint64_t nBatch) const;
+        uint64_t passMemory(const Pass &pass, uint64_t n, uint64_t nBatch) const;
+
+        // Window widths a pass may take.
+        static void bitsRange(uint64_t &minBits, uint64_t &maxBits);
+
+        // Pass of one task of the least buckets and digits.
+        Pass leastPass(uint64_t scalarBits, uint64_t n, uint64_t nBatch) const;
+
+        // Pass of the least time within the memory limit, or else the
+        // one of the least memory.
+        Pass fitPass(uint64_t scalarBits, uint64_t n, uint64_t nBatch) const;
+
+        // Pass of the bucket method over n points, which drops 'shifted'
+        // when it does not cover the windows or the memory limit.
+        Pass choosePass(uint64_t scalarBits, uint64_t n, uint64_t nBatch, ShiftedBases<Curve> *&shifted) const;
+
+        void reduceBuckets(Point &r, Point *buckets, uint64_t nBuckets);
+
+        // Bucket method over the points of 'source' with the scalars
+        // indices[i] (i if 'indices' is null) for i < n, using only the low
+        // 'scalarBits' of the scalars.
+        template <typename Source>
+        void accumulate(
+            Point *r,
+            const Source &source,
+            uint8_t *const *scalars,
+            uint64_t scalarSize,
+            uint64_t scalarBits,
+            const uint32_t *indices,
+            uint64_t n,
+            uint64_t nBatch,
+            void *scratch,
+            ShiftedBases<Curve> *shifted = nullptr);
+
+        void sumOnes(Point *r, PointAffine *bases, uint8_t *const *scalars, uint64_t scalarSize, uint64_t nBatch, const ScalarProfile &profile);
+
+    public:
+        // With '_signedDigits' the windows are recoded to signed digits,
+        // which halves the buckets of a window and so allows one more bit
+        // per window. Multiexps given the same '_digitCache' decode the
+        // window digits of their common scalars only once.
+        Pippenger(Curve &_g, Field &_F, ThreadPool &_threadPool, uint64_t _nTasks,
+                  bool _signedDigits = false, DigitCache *_digitCache = nullptr)
+            : g(_g), F(_F), threadPool(_threadPool), nTasks(_nTasks ? _nTasks : 1),
+              signedDigits(_signedDigits), digitCache(_digitCache), batchAffine(false),
+              windowTable(nullptr), memoryLimit(0) {}
+
+        // Accumulate the buckets with batch-affine additions instead of
+        // mixed xyzz ones.
+        void setBatchAffine(bool _batchAffine) { batchAffine = _batchAffine; }
+
+        // Take the window width and the task split of every multiexp size
+        // found in 'table' instead of the defaults. The table must outlive
+        // the multiexp.
+        void setWindowTable(const WindowTable *table) {
+            windowTable = table && !table->empty() ? table : nullptr;
+        }
+
+        // Keep the buckets and window digits of every pass within 'bytes',
+        // 0 for no limit: passes past it take the window width and number
+        // of tasks that fit best, and go without the shifted copies.
+        void setMemoryLimit(uint64_t bytes) { memoryLimit = bytes; }
+
+        static uint64_t calcBitsPerChunk(uint64_t n);
+
+        // Times this multiexp over bases[0..n) with widths around the
+        // default one and both task splits, and records the fastest in
+        // 'table' unless it already has a choice for the size.
+        void tune(WindowTable &table, PointAffine *bases, uint8_t *scalars, uint64_t scalarSize, uint64_t n);
+
+        // Bytes of bucket memory that run() needs for 'n' points and
+        // 'nBatch' scalar vectors, also in GLV mode if 'glv' is set. When
+        // the caller passes such an area as 'scratch' nothing is allocated.
+        uint64_t scratchSize(uint64_t scalarSize, uint64_t n, uint64_t nBatch = 1, bool glv = false) const;
+
+        // Bytes of memory of run() with the same arguments: the scratch
+        // area and what the passes allocate past it. The digits decoded
+        // into a digit cache are left to its owner.
+        uint64_t memorySize(uint64_t scalarSize, uint64_t n, uint64_t nBatch = 1, bool glv = false) const;
+
+        // Window width of run() over n points with 'scalarBits' bit
+        // scalars and no shifted copies.
+        uint64_t windowWidth(uint64_t scalarBits, uint64_t n, uint64_t nBatch = 1) const;
+
+        // Builds 'nCopies' - 1 shifted copies of bases[0..n) for the
+        // windows this multiexp uses with 'scalarSize' byte scalars.
+        void shiftBases(ShiftedBases<Curve> &r, PointAffine *bases, uint64_t scalarSize, uint64_t n, uint64_t nCopies);
+
+        void run(Point &r, PointAffine *bases, uint8_t *scalars, uint64_t scalarSize, uint64_t n, void *scratch = nullptr);
+
+        // Computes r[w] = sum(scalars[w][i] * bases[i]) for 'nBatch' scalar
+        // vectors over the same bases, streaming the bases only once. With
+        // 'shifted' copies of the bases fewer windows are doubled.
+        void runBatch(
+            Point *r,
+            PointAffine *bases,
+            uint8_t *const *scalars,
+            uint64_t scalarSize,
+            uint64_t n,
+            uint64_t nBatch,
+            void *scratch = nullptr,
+            ShiftedBases<Curve> *shifted = nullptr);
+
+        // Same as runBatch() over the GLV split scalars: 2n half-width
+        // scalars over the bases and their endomorphism images, so the
+        // bucket method needs half the windows.
+        void runGlv(Point *r, PointAffine *bases, const GlvInput<Curve> &glv, uint64_t n, uint64_t nBatch, void *scratch = nullptr);
+
+        // Same as runBatch() but driven by the classes of the scalars: zeros
+        // are skipped, ones are summed with batch-affine additions, short
+        // scalars go to a bucket method with fewer windows and only the
+        // rest goes through the full-width one, or through the GLV one if
+        // 'glv' is given and there are no 'shifted' bases.
+        void runProfiled(
+            Point *r,
+            PointAffine *bases,
+            uint8_t *const *scalars,
+            uint64_t scalarSize,
+            uint64_t nBatch,
+            const ScalarProfile &profile,
+            void *scratch = nullptr,
+            const GlvInput<Curve> *glv = nullptr,
+            ShiftedBases<Curve> *shifted = nullptr);
+    };
+}
+
+#include "multiexp.cpp"
+
+#endif // MULTIEXP_HPP
@@ -0,0 +1,204 @@
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <system_error>
+#include <thread>
+#include <algorithm>
+
+#include "numa.hpp"
+
+namespace Numa {
+
+#ifdef __linux__
+
+static const char *nodeDir = "/sys/devices/system/node";
+
+// Parses a sysfs list such as "0-3,8-11".
+static std::vector<int> ParseList(const std::string &list)
+{
+    std::vector<int> r;
+    std::istringstream ss(list);
+    std::string range;
+
+    while (std::getline(ss, range, ',')) {
+        if (range.empty() || range == "\n") {
+            continue;
+        }
+
+        const auto dash = range.find('-');
+        const int first = std::atoi(range.c_str());
+        const int last = dash == std::string::npos ? first : std::atoi(range.c_str() + dash + 1);
+
+        for (int i = first; i <= last; i++) {
+            r.push_back(i);
+        }
+    }
+    return r;
+}
+
+static std::string ReadLine(const std::string &path)
+{
+    std::ifstream file(path);
+    std::string line;
+
+    std::getline(file, line);
+    return line;
+}
+
+// Bionic has no pthread_setaffinity_np, but there the affinity of a
+// thread id is that of the thread alone.
+static int SetThreadAffinity(const cpu_set_t &cpus)
+{
+#ifdef __ANDROID__
+    return sched_setaffinity(gettid(), sizeof(cpus), &cpus) == 0 ? 0 : errno;
+#else
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#endif
+}
+
+bool supported()
+{
+    return true;
+}
+
+std::vector<Node> nodes()
+{
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        throw std::system_error(errno, std::generic_category(), "sched_getaffinity");
+    }
+
+    std::vector<Node> r;
+
+    for (int id : ParseList(ReadLine(std::string(nodeDir) + "/online"))) {
+        Node node;
+        node.id = id;
+
+        for (int cpu : ParseList(ReadLine(std::string(nodeDir) + "/node" + std::to_string(id) + "/cpulist"))) {
+            if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) {
+                node.cpus.push_back(cpu);
+            }
+        }
+
+        if (!node.cpus.empty()) {
+            r.push_back(node);
+        }
+    }
+
+    if (r.empty()) {
+        Node node;
+        node.id = 0;
+
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &allowed)) {
+                node.cpus.push_back(cpu);
+            }
+        }
+        r.push_back(node);
+    }
+
+    return r;
+}
+
+void pinThread(const Node &node)
+{
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+
+    for (int cpu : node.cpus) {
+        CPU_SET(cpu, &cpus);
+    }
+
+    const int err = SetThreadAffinity(cpus);
+
+    if (err != 0) {
+        throw std::system_error(err, std::generic_category(), "thread affinity");
+    }
+}
+
+std::unique_ptr<ThreadPool> createPool(const Node &node)
+{
+    const int64_t nThreads = std::max<int64_t>(1, node.cpus.size());
+    std::unique_ptr<ThreadPool> pool(new ThreadPool(nThreads));
+
+    // A loop of one index per thread need not hand an index to every thread,
+    // so each chunk pins its thread once by id and then waits a little for
+    // the others, which keeps a fast thread from taking several chunks. The
+    // loop is repeated until every thread has pinned. The caller may run
+    // chunks too and is left alone.
+    const std::thread::id caller = std::this_thread::get_id();
+    const size_t maxRounds = 16;
+    std::set<std::thread::id> pinned;
+    std::mutex mutex;
+    std::condition_variable allPinned;
+
+    for (size_t round = 0; round < maxRounds && pinned.size() < size_t(nThreads); round++) {
+        pool->parallelFor(0, nThreads, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+            const std::thread::id id = std::this_thread::get_id();
+
+            if (id == caller) {
+                return;
+            }
+
+            std::unique_lock<std::mutex> lock(mutex);
+
+            if (pinned.insert(id).second) {
+                pinThread(node);
+                allPinned.notify_all();
+            }
+
+            allPinned.wait_for(lock, std::chrono::milliseconds(10), [&] () {
+                return pinned.size() >= size_t(nThreads);
+            });
+        });
+    }
+
+    return pool;
+}
+
+#else
+
+// No node or affinity interface: every CPU is in node 0 and threads are
+// not pinned.
+
+bool supported()
+{
+    return false;
+}
+
+std::vector<Node> nodes()
+{
+    Node node;
+    node.id = 0;
+
+    for (unsigned cpu = 0; cpu < std::max(1U, std::thread::hardware_concurrency()); cpu++) {
+        node.cpus.push_back(cpu);
+    }
+
+    return std::vector<Node>(1, node);
+}
+
+void pinThread(const Node &node)
+{
+}
+
+std::unique_ptr<ThreadPool> createPool(const Node &node)
+{
+    return std::unique_ptr<ThreadPool>(new ThreadPool(std::max<int64_t>(1, node.cpus.size())));
+}
+
+#endif
+
+} // Namespace
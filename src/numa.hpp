@@ -0,0 +1,32 @@
+#ifndef NUMA_HPP
+#define NUMA_HPP
+
+#include <memory>
+#include <vector>
+
+#include "threadpool.hpp"
+
+namespace Numa {
+
+    struct Node {
+        int id;
+        std::vector<int> cpus;
+    };
+
+    // Whether threads can be pinned to the nodes on this platform. Where
+    // they cannot, nodes() is a single node of all the CPUs.
+    bool supported();
+
+    // Online nodes with CPUs this process may run on, as reported by
+    // sysfs. Without NUMA information all the allowed CPUs form node 0.
+    std::vector<Node> nodes();
+
+    // Restricts the calling thread to the CPUs of 'node'. Memory the thread
+    // touches first is then placed on the node under the default policy.
+    void pinThread(const Node &node);
+
+    // Pool with a thread per CPU of 'node', every thread pinned to it.
+    std::unique_ptr<ThreadPool> createPool(const Node &node);
+}
+
+#endif // NUMA_HPP
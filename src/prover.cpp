@@ -3,6 +3,8 @@
 #include <cstring>
 #include <cstdarg>
 #include <stdexcept>
+#include <vector>
+#include <memory>
 #include <alt_bn128.hpp>
 #include <nlohmann/json.hpp>
 #include "prover.h"
@@ -11,6 +13,7 @@
 #include "wtns_utils.hpp"
 #include "binfile_utils.hpp"
 #include "fileloader.hpp"
+#include "numa.hpp"
 
 using json = nlohmann::json;
 
@@ -100,12 +103,7 @@ class Groth16Prover
     std::unique_ptr<ZKeyUtils::Header> zkeyHeader;
     std::unique_ptr<Groth16::Prover<AltBn128::Engine>> prover;
 
-public:
-    Groth16Prover(const void         *zkey_buffer,
-                  unsigned long long  zkey_size)
-
-        : zkey(zkey_buffer, zkey_size, "zkey", 1),
-          zkeyHeader(ZKeyUtils::loadHeader(&zkey))
+    void init()
     {
         if (!PrimeIsValid(zkeyHeader->rPrime)) {
             throw std::invalid_argument("zkey curve not supported");
@@ -130,31 +128,191 @@ public:
         );
     }
 
+public:
+    Groth16Prover(const void         *zkey_buffer,
+                  unsigned long long  zkey_size)
+
+        : zkey(zkey_buffer, zkey_size, "zkey", 1),
+          zkeyHeader(ZKeyUtils::loadHeader(&zkey))
+    {
+        init();
+    }
+
+    // The zkey file stays mapped for the lifetime of the prover.
+    explicit Groth16Prover(const std::string &zkeyFileName)
+
+        : zkey(zkeyFileName, "zkey", 1),
+          zkeyHeader(ZKeyUtils::loadHeader(&zkey))
+    {
+        init();
+    }
+
+    void setOption(int option, long long value)
+    {
+        Groth16::ProverOptions options = prover->getOptions();
+
+        switch (option) {
+        case PROVER_OPTION_TASK_GRAPH:
+            options.taskGraph = (value != 0);
+            break;
+        case PROVER_OPTION_G2_CORE_SHARE:
+            options.g2CoreShare = value / 100.0;
+            break;
+        case PROVER_OPTION_G1_CORE_SHARE:
+            options.g1CoreShare = value / 100.0;
+            break;
+        case PROVER_OPTION_SCRATCH_SETS:
+            options.scratchSets = value < 0 ? 0 : value;
+            break;
+        case PROVER_OPTION_WITNESS_PROFILE:
+            options.witnessProfile = (value != 0);
+            break;
+        case PROVER_OPTION_GLV:
+            if (value < Groth16::GlvOff || value > Groth16::GlvPrecomputed) {
+                throw std::invalid_argument("invalid GLV mode: " + std::to_string(value));
+            }
+            options.glv = (Groth16::GlvMode)value;
+            break;
+        case PROVER_OPTION_SIGNED_DIGITS:
+            options.signedDigits = (value != 0);
+            break;
+        case PROVER_OPTION_BATCH_AFFINE:
+            if (value < 0 || value > 0x1f) {
+                throw std::invalid_argument("invalid multiexp set: " + std::to_string(value));
+            }
+            options.batchAffine = value;
+            break;
+        case PROVER_OPTION_SHIFTED_COPIES:
+            if (value < 0 || value > 256) {
+                throw std::invalid_argument("invalid number of shifted copies: " + std::to_string(value));
+            }
+            options.shiftedCopies = value;
+            break;
+        case PROVER_OPTION_NUMA:
+            if (value != 0 && !Numa::supported()) {
+                throw std::invalid_argument("NUMA mode is not supported on this platform");
+            }
+            options.numa = (value != 0);
+            break;
+        case PROVER_OPTION_HUGE_PAGES:
+            if (value < ScratchArena::SmallPages || value > ScratchArena::HugeTlb1G) {
+                throw std::invalid_argument("invalid page mode: " + std::to_string(value));
+            }
+            options.hugePages = (ScratchArena::PageMode)value;
+            break;
+        case PROVER_OPTION_MEMORY_BUDGET:
+            if (value < 0) {
+                throw std::invalid_argument("invalid memory budget: " + std::to_string(value));
+            }
+            options.memoryBudget = value;
+            break;
+        default:
+            throw std::invalid_argument("unknown prover option: " + std::to_string(option));
+        }
+
+        prover->setOptions(options);
+    }
+
+    void tune(const std::string &profilePath)
+    {
+        prover->tune(profilePath);
+    }
+
+    void warmUp(int flags, groth16_progress_callback callback, void *context)
+    {
+        Residency::Progress progress;
+
+        if (callback) {
+            progress = [callback, context] (uint64_t done, uint64_t total) {
+                callback(context, done, total);
+            };
+        }
+
+        prover->warmUp((flags & PROVER_WARM_UP_LOCK) != 0, progress);
+    }
+
+    unsigned long long getInfo(int info)
+    {
+        u_int64_t histogram[MultiExp::nScalarClasses];
+
+        switch (info) {
+        case PROVER_INFO_WITNESS_ZEROS:
+        case PROVER_INFO_WITNESS_ONES:
+        case PROVER_INFO_WITNESS_SHORT:
+        case PROVER_INFO_WITNESS_FULL:
+            prover->getWitnessHistogram(histogram);
+            return histogram[MultiExp::ScalarZero + info - PROVER_INFO_WITNESS_ZEROS];
+        case PROVER_INFO_SHIFTED_SIZE:
+            return prover->getShiftedBasesSize();
+        case PROVER_INFO_NUMA_NODES:
+            return prover->getNumaNodes();
+        case PROVER_INFO_HUGE_SECTIONS:
+            return prover->getSectionsHugePageBytes();
+        case PROVER_INFO_HUGE_SCRATCH:
+            return prover->getScratchHugePageBytes();
+        case PROVER_INFO_WARM_BYTES:
+            return prover->getWarmBytes();
+        case PROVER_INFO_LOCKED_BYTES:
+            return prover->getLockedBytes();
+        case PROVER_INFO_ZERO_POINTS:
+            return prover->getZeroPoints();
+        case PROVER_INFO_PEAK_BYTES:
+            return prover->getPeakMemory();
+        default:
+            throw std::invalid_argument("unknown prover info: " + std::to_string(info));
+        }
+    }
+
     void prove(const void         *wtns_buffer,
                unsigned long long  wtns_size,
                std::string        &stringProof,
                std::string        &stringPublic)
     {
-        BinFileUtils::BinFile wtns(wtns_buffer, wtns_size, "wtns", 2);
-        auto wtnsHeader = WtnsUtils::loadHeader(&wtns);
-
-        if (zkeyHeader->nVars != wtnsHeader->nVars) {
-            throw InvalidWitnessLengthException("Invalid witness length. Circuit: "
-                                        + std::to_string(zkeyHeader->nVars)
-                                        + ", witness: "
-                                        + std::to_string(wtnsHeader->nVars));
-        }
+        std::vector<std::string> stringProofs;
+        std::vector<std::string> stringPublics;
+
+        proveBatch(1, &wtns_buffer, &wtns_size, stringProofs, stringPublics);
+
+        stringProof = stringProofs[0];
+        stringPublic = stringPublics[0];
+    }
 
-        if (!PrimeIsValid(wtnsHeader->prime)) {
-            throw std::invalid_argument("different wtns curve");
+    void proveBatch(unsigned long long        count,
+                    const void *const        *wtns_buffers,
+                    const unsigned long long *wtns_sizes,
+                    std::vector<std::string> &stringProofs,
+                    std::vector<std::string> &stringPublics)
+    {
+        std::vector<std::unique_ptr<BinFileUtils::BinFile>> wtnsFiles;
+        std::vector<AltBn128::FrElement *> wtnsData;
+
+        for (unsigned long long i = 0; i < count; i++) {
+            wtnsFiles.emplace_back(new BinFileUtils::BinFile(wtns_buffers[i], wtns_sizes[i], "wtns", 2));
+            auto wtnsHeader = WtnsUtils::loadHeader(wtnsFiles.back().get());
+
+            if (zkeyHeader->nVars != wtnsHeader->nVars) {
+                throw InvalidWitnessLengthException("Invalid witness length. Circuit: "
+                                            + std::to_string(zkeyHeader->nVars)
+                                            + ", witness: "
+                                            + std::to_string(wtnsHeader->nVars));
+            }
+
+            if (!PrimeIsValid(wtnsHeader->prime)) {
+                throw std::invalid_argument("different wtns curve");
+            }
+
+            wtnsData.push_back((AltBn128::FrElement *)wtnsFiles.back()->getSectionData(2));
         }
 
-        AltBn128::FrElement *wtnsData = (AltBn128::FrElement *)wtns.getSectionData(2);
+        auto proofs = prover->proveBatch(wtnsData);
 
-        auto proof = prover->prove(wtnsData);
+        stringProofs.clear();
+        stringPublics.clear();
 
-        stringProof = proof->toJson().dump();
-        stringPublic = BuildPublicString(wtnsData, zkeyHeader->nPublic);
+        for (unsigned long long i = 0; i < count; i++) {
+            stringProofs.push_back(proofs[i]->toJson().dump());
+            stringPublics.push_back(BuildPublicString(wtnsData[i], zkeyHeader->nPublic));
+        }
     }
 };
 
@@ -261,22 +419,159 @@ groth16_prover_create_zkey_file(
     char                *error_msg,
     unsigned long long   error_msg_maxsize)
 {
-    BinFileUtils::FileLoader fileLoader;
+    try {
+        if (prover_object == NULL) {
+            throw std::invalid_argument("Null prover object");
+        }
+
+        if (zkey_file_path == NULL) {
+            throw std::invalid_argument("Null zkey file path");
+        }
+
+        Groth16Prover *prover = new Groth16Prover(std::string(zkey_file_path));
+
+        *prover_object = prover;
+
+    } catch (std::exception& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR;
+
+    } catch (...) {
+        CopyErrorFmt(error_msg, error_msg_maxsize, "unknown error");
+        return PROVER_ERROR;
+    }
+
+    return PROVER_OK;
+}
+
+int
+groth16_prover_set_option(
+    void                *prover_object,
+    int                  option,
+    long long            value,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize)
+{
+    if (!prover_object) {
+        CopyErrorFmt(error_msg, error_msg_maxsize, "Null prover object");
+        return PROVER_ERROR;
+    }
+
+    auto prover = static_cast<Groth16Prover*>(prover_object);
 
     try {
-        fileLoader.load(zkey_file_path);
+        prover->setOption(option, value);
 
     } catch (std::exception& e) {
         CopyError(error_msg, error_msg_maxsize, e);
         return PROVER_ERROR;
+
+    } catch (...) {
+        CopyErrorFmt(error_msg, error_msg_maxsize, "unknown error");
+        return PROVER_ERROR;
     }
 
-    return groth16_prover_create(
-                prover_object,
-                fileLoader.dataBuffer(),
-                fileLoader.dataSize(),
-                error_msg,
-                error_msg_maxsize);
+    return PROVER_OK;
+}
+
+int
+groth16_prover_tune(
+    void                *prover_object,
+    const char          *profile_path,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize)
+{
+    if (!prover_object) {
+        CopyErrorFmt(error_msg, error_msg_maxsize, "Null prover object");
+        return PROVER_ERROR;
+    }
+
+    if (!profile_path) {
+        CopyErrorFmt(error_msg, error_msg_maxsize, "Null profile path");
+        return PROVER_ERROR;
+    }
+
+    auto prover = static_cast<Groth16Prover*>(prover_object);
+
+    try {
+        prover->tune(profile_path);
+
+    } catch (std::exception& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR;
+
+    } catch (...) {
+        CopyErrorFmt(error_msg, error_msg_maxsize, "unknown error");
+        return PROVER_ERROR;
+    }
+
+    return PROVER_OK;
+}
+
+int
+groth16_prover_warm_up(
+    void                      *prover_object,
+    int                        flags,
+    groth16_progress_callback  progress,
+    void                      *progress_context,
+    char                      *error_msg,
+    unsigned long long         error_msg_maxsize)
+{
+    if (!prover_object) {
+        CopyErrorFmt(error_msg, error_msg_maxsize, "Null prover object");
+        return PROVER_ERROR;
+    }
+
+    auto prover = static_cast<Groth16Prover*>(prover_object);
+
+    try {
+        prover->warmUp(flags, progress, progress_context);
+
+    } catch (std::exception& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR;
+
+    } catch (...) {
+        CopyErrorFmt(error_msg, error_msg_maxsize, "unknown error");
+        return PROVER_ERROR;
+    }
+
+    return PROVER_OK;
+}
+
+int
+groth16_prover_get_info(
+    void                *prover_object,
+    int                  info,
+    unsigned long long  *value,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize)
+{
+    if (!prover_object) {
+        CopyErrorFmt(error_msg, error_msg_maxsize, "Null prover object");
+        return PROVER_ERROR;
+    }
+
+    if (!value) {
+        CopyErrorFmt(error_msg, error_msg_maxsize, "Null value");
+        return PROVER_ERROR;
+    }
+
+    auto prover = static_cast<Groth16Prover*>(prover_object);
+
+    try {
+        *value = prover->getInfo(info);
+
+    } catch (std::exception& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR;
+
+    } catch (...) {
+        CopyErrorFmt(error_msg, error_msg_maxsize, "unknown error");
+        return PROVER_ERROR;
+    }
+
+    return PROVER_OK;
 }
 
 int
@@ -306,28 +601,96 @@ groth16_prover_prove(
         return PROVER_ERROR;
     }
 
-    if (!proof_size) {
+    if (!public_buffer) {
+        CopyErrorFmt(error_msg, error_msg_maxsize, "Null public buffer");
+        return PROVER_ERROR;
+    }
+
+    return groth16_prover_prove_batch(
+                prover_object,
+                1,
+                &wtns_buffer,
+                &wtns_size,
+                &proof_buffer,
+                proof_size,
+                &public_buffer,
+                public_size,
+                error_msg,
+                error_msg_maxsize);
+}
+
+int
+groth16_prover_prove_batch(
+    void                      *prover_object,
+    unsigned long long         count,
+    const void *const         *wtns_buffers,
+    const unsigned long long  *wtns_sizes,
+    char *const               *proof_buffers,
+    unsigned long long        *proof_sizes,
+    char *const               *public_buffers,
+    unsigned long long        *public_sizes,
+    char                      *error_msg,
+    unsigned long long         error_msg_maxsize)
+{
+    if (!prover_object) {
+        CopyErrorFmt(error_msg, error_msg_maxsize, "Null prover object");
+        return PROVER_ERROR;
+    }
+
+    if (count == 0) {
+        CopyErrorFmt(error_msg, error_msg_maxsize, "Empty witness batch");
+        return PROVER_ERROR;
+    }
+
+    if (!wtns_buffers || !wtns_sizes) {
+        CopyErrorFmt(error_msg, error_msg_maxsize, "Null witness buffer");
+        return PROVER_ERROR;
+    }
+
+    if (!proof_buffers) {
+        CopyErrorFmt(error_msg, error_msg_maxsize, "Null proof buffer");
+        return PROVER_ERROR;
+    }
+
+    if (!proof_sizes) {
         CopyErrorFmt(error_msg, error_msg_maxsize, "Null proof size");
         return PROVER_ERROR;
     }
 
-    if (!public_buffer) {
+    if (!public_buffers) {
         CopyErrorFmt(error_msg, error_msg_maxsize, "Null public buffer");
         return PROVER_ERROR;
     }
 
-    if (!public_size) {
+    if (!public_sizes) {
         CopyErrorFmt(error_msg, error_msg_maxsize, "Null public size");
         return PROVER_ERROR;
     }
 
+    for (unsigned long long i = 0; i < count; i++) {
+        if (!wtns_buffers[i]) {
+            CopyErrorFmt(error_msg, error_msg_maxsize, "Null witness buffer #%llu", i);
+            return PROVER_ERROR;
+        }
+
+        if (!proof_buffers[i]) {
+            CopyErrorFmt(error_msg, error_msg_maxsize, "Null proof buffer #%llu", i);
+            return PROVER_ERROR;
+        }
+
+        if (!public_buffers[i]) {
+            CopyErrorFmt(error_msg, error_msg_maxsize, "Null public buffer #%llu", i);
+            return PROVER_ERROR;
+        }
+    }
+
     auto prover = static_cast<Groth16Prover*>(prover_object);
 
-    std::string stringProof;
-    std::string stringPublic;
+    std::vector<std::string> stringProofs;
+    std::vector<std::string> stringPublics;
 
     try {
-        prover->prove(wtns_buffer, wtns_size, stringProof, stringPublic);
+        prover->proveBatch(count, wtns_buffers, wtns_sizes, stringProofs, stringPublics);
 
     } catch(InvalidWitnessLengthException& e) {
         CopyError(error_msg, error_msg_maxsize, e);
@@ -347,34 +710,46 @@ groth16_prover_prove(
         return PROVER_ERROR;
     }
 
-    // Check for overflow before adding 1 for null terminator
-    if (stringProof.length() >= ULLONG_MAX || stringPublic.length() >= ULLONG_MAX) {
-        CopyErrorFmt(error_msg, error_msg_maxsize, "Proof or public data too large");
-        return PROVER_ERROR;
-    }
+    bool shortBuffer = false;
 
-    unsigned long long requiredProofSize = stringProof.length() + 1;
-    unsigned long long requiredPublicSize = stringPublic.length() + 1;
+    for (unsigned long long i = 0; i < count; i++) {
 
-    if (*proof_size < requiredProofSize || *public_size < requiredPublicSize) {
-        unsigned long long origProofSize = *proof_size;
-        unsigned long long origPublicSize = *public_size;
-        *proof_size = requiredProofSize;
-        *public_size = requiredPublicSize;
+        // Check for overflow before adding 1 for null terminator
+        if (stringProofs[i].length() >= ULLONG_MAX || stringPublics[i].length() >= ULLONG_MAX) {
+            CopyErrorFmt(error_msg, error_msg_maxsize, "Proof or public data too large");
+            return PROVER_ERROR;
+        }
 
-        CopyErrorFmt(error_msg, error_msg_maxsize,
-            "Buffer insufficient for generated proof. Required - proof: %llu (provided: %llu), public: %llu (provided: %llu)",
-            requiredProofSize, origProofSize, requiredPublicSize, origPublicSize);
+        unsigned long long requiredProofSize = stringProofs[i].length() + 1;
+        unsigned long long requiredPublicSize = stringPublics[i].length() + 1;
+
+        if (proof_sizes[i] < requiredProofSize || public_sizes[i] < requiredPublicSize) {
+            if (!shortBuffer) {
+                CopyErrorFmt(error_msg, error_msg_maxsize,
+                    "Buffer insufficient for generated proof. Required - proof: %llu (provided: %llu), public: %llu (provided: %llu)",
+                    requiredProofSize, proof_sizes[i], requiredPublicSize, public_sizes[i]);
+            }
+            shortBuffer = true;
+        }
+    }
+
+    if (shortBuffer) {
+        for (unsigned long long i = 0; i < count; i++) {
+            proof_sizes[i] = stringProofs[i].length() + 1;
+            public_sizes[i] = stringPublics[i].length() + 1;
+        }
         return PROVER_ERROR_SHORT_BUFFER;
     }
 
-    std::memcpy(proof_buffer, stringProof.c_str(), stringProof.length());
-    proof_buffer[stringProof.length()] = '\0';
-    *proof_size = stringProof.length();
+    for (unsigned long long i = 0; i < count; i++) {
+        std::memcpy(proof_buffers[i], stringProofs[i].c_str(), stringProofs[i].length());
+        proof_buffers[i][stringProofs[i].length()] = '\0';
+        proof_sizes[i] = stringProofs[i].length();
 
-    std::memcpy(public_buffer, stringPublic.c_str(), stringPublic.length());
-    public_buffer[stringPublic.length()] = '\0';
-    *public_size = stringPublic.length();
+        std::memcpy(public_buffers[i], stringPublics[i].c_str(), stringPublics[i].length());
+        public_buffers[i][stringPublics[i].length()] = '\0';
+        public_sizes[i] = stringPublics[i].length();
+    }
 
     return PROVER_OK;
 }
@@ -11,6 +11,53 @@ extern "C" {
 #define PROVER_ERROR_SHORT_BUFFER     0x2
 #define PROVER_INVALID_WITNESS_LENGTH 0x3
 
+// Options accepted by groth16_prover_set_option.
+#define PROVER_OPTION_TASK_GRAPH      0x1 // 0 - run stages one after another, 1 - overlap multiexps with H
+#define PROVER_OPTION_G2_CORE_SHARE   0x2 // percent of cores for the B2 multiexp in task-graph mode
+#define PROVER_OPTION_G1_CORE_SHARE   0x3 // percent of cores for the A, B1, C multiexps in task-graph mode
+#define PROVER_OPTION_SCRATCH_SETS    0x4 // number of reusable scratch sets, bounds concurrent proofs
+#define PROVER_OPTION_WITNESS_PROFILE 0x5 // 1 - skip zero, sum one and shorten small witness scalars in multiexps
+#define PROVER_OPTION_GLV             0x6 // 0 - off, 1 - GLV multiexps, 2 - GLV with precomputed endomorphism points
+#define PROVER_OPTION_SIGNED_DIGITS   0x7 // 1 - signed-digit multiexp windows, half the buckets per window
+#define PROVER_OPTION_BATCH_AFFINE    0x8 // PROVER_MULTIEXP_* bits of the multiexps with batch-affine bucket additions
+#define PROVER_OPTION_SHIFTED_COPIES  0x9 // copies of the point sections shifted by window groups, 0 or 1 - none
+#define PROVER_OPTION_NUMA            0xA // 1 - split the multiexps over the NUMA nodes, sections copied per node, Linux only
+#define PROVER_OPTION_HUGE_PAGES      0xB // sections and scratch in 0 - small pages, 1 - THP, 2 - 2 MB, 3 - 1 GB hugetlbfs pages
+#define PROVER_OPTION_MEMORY_BUDGET   0xC // bytes a proof may take at its peak, multiexps narrow their windows to fit, 0 - no limit
+// In task-graph mode the H pipeline runs on a pool with the cores left by the two
+// shares. In NUMA mode the multiexps run on the pools of the nodes instead, the
+// shares are ignored and the H multiexp starts once A, B1, B2 and C are done.
+
+// Multiexps of a proof, for PROVER_OPTION_BATCH_AFFINE.
+#define PROVER_MULTIEXP_A             0x1
+#define PROVER_MULTIEXP_B1            0x2
+#define PROVER_MULTIEXP_B2            0x4
+#define PROVER_MULTIEXP_C             0x8
+#define PROVER_MULTIEXP_H             0x10
+
+// Values reported by groth16_prover_get_info.
+#define PROVER_INFO_WITNESS_ZEROS     0x1 // zero scalars in the witness of the last proof
+#define PROVER_INFO_WITNESS_ONES      0x2 // scalars equal to one
+#define PROVER_INFO_WITNESS_SHORT     0x3 // other scalars of at most 64 bits
+#define PROVER_INFO_WITNESS_FULL      0x4 // remaining scalars
+#define PROVER_INFO_SHIFTED_SIZE      0x5 // bytes of memory taken by the shifted point copies
+#define PROVER_INFO_NUMA_NODES        0x6 // NUMA nodes the multiexps are split over, 0 - NUMA mode off
+#define PROVER_INFO_HUGE_SECTIONS     0x7 // bytes of the point sections backed by huge pages
+#define PROVER_INFO_HUGE_SCRATCH      0x8 // bytes of the last scratch set backed by huge pages
+#define PROVER_INFO_WARM_BYTES        0x9 // bytes of the zkey sections faulted in by the last warm-up
+#define PROVER_INFO_LOCKED_BYTES      0xA // bytes of the zkey sections locked in RAM
+#define PROVER_INFO_ZERO_POINTS       0xB // points at infinity of the A, B1 and B2 sections, skipped by the multiexps
+#define PROVER_INFO_PEAK_BYTES        0xC // projected peak bytes of a proof under the current options and memory budget
+
+// Flags of groth16_prover_warm_up.
+#define PROVER_WARM_UP_LOCK           0x1 // also lock the sections in RAM (mlock)
+
+// Warm-up progress: bytes faulted in so far out of 'total'.
+typedef void (*groth16_progress_callback)(
+    void                *context,
+    unsigned long long   done,
+    unsigned long long   total);
+
 /**
  * Calculates buffer size to output public signals as json string
  * @returns PROVER_OK in case of success, and the size of public buffer is written to public_size
@@ -61,7 +108,9 @@ groth16_prover_create(
     unsigned long long   error_msg_maxsize);
 
 /**
- * Initializes 'prover_object' with a pointer to a new prover object.
+ * Initializes 'prover_object' with a pointer to a new prover object for the
+ * zkey file at 'zkey_file_path'. The file stays mapped until the prover
+ * object is destroyed.
  * @return error code:
  *         PROVER_OK - in case of success
  *         PROVER_ERROR - in case of an error
@@ -73,6 +122,74 @@ groth16_prover_create_zkey_file(
     char                *error_msg,
     unsigned long long   error_msg_maxsize);
 
+/**
+ * Sets one of the PROVER_OPTION_* options of 'prover_object'.
+ * Options must not be changed while a proof is being generated.
+ * @return error code:
+ *         PROVER_OK - in case of success
+ *         PROVER_ERROR - in case of an error, error_msg contains the error message
+ */
+int
+groth16_prover_set_option(
+    void                *prover_object,
+    int                  option,
+    long long            value,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize);
+
+/**
+ * Tunes the multiexp window widths and task splits of 'prover_object' for
+ * this host and its current options. Choices found in the profile file at
+ * 'profile_path' for the CPU model and thread count of the host are reused,
+ * missing ones are benchmarked and written back to the file, which is
+ * created if needed. Later proofs use the tuned choices.
+ * @return error code:
+ *         PROVER_OK - in case of success
+ *         PROVER_ERROR - in case of an error, error_msg contains the error message
+ */
+int
+groth16_prover_tune(
+    void                *prover_object,
+    const char          *profile_path,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize);
+
+/**
+ * Faults in the coefficients and point sections of 'prover_object' with all
+ * the cores, so the first proof runs as fast as later ones. With
+ * PROVER_WARM_UP_LOCK in 'flags' the sections are also locked in RAM until
+ * the prover object is destroyed or PROVER_OPTION_HUGE_PAGES is changed;
+ * locking fails past RLIMIT_MEMLOCK. 'progress', if not NULL, is called on
+ * the calling thread about every 100 ms and once more with done equal to
+ * total when the warm-up completes.
+ * @return error code:
+ *         PROVER_OK - in case of success
+ *         PROVER_ERROR - in case of an error, error_msg contains the error message
+ */
+int
+groth16_prover_warm_up(
+    void                      *prover_object,
+    int                        flags,
+    groth16_progress_callback  progress,
+    void                      *progress_context,
+    char                      *error_msg,
+    unsigned long long         error_msg_maxsize);
+
+/**
+ * Reads one of the PROVER_INFO_* values of 'prover_object' into 'value'.
+ * The witness histogram is only updated while PROVER_OPTION_WITNESS_PROFILE is on.
+ * @return error code:
+ *         PROVER_OK - in case of success
+ *         PROVER_ERROR - in case of an error, error_msg contains the error message
+ */
+int
+groth16_prover_get_info(
+    void                *prover_object,
+    int                  info,
+    unsigned long long  *value,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize);
+
 /**
  * Proves 'wtns_buffer' and saves results to 'proof_buffer' and 'public_buffer'.
  *
@@ -105,6 +222,42 @@ groth16_prover_prove(
     char                *error_msg,
     unsigned long long   error_msg_maxsize);
 
+/**
+ * Proves 'count' witnesses of the same circuit at once. Every multiexp
+ * streams the zkey points once for the whole batch, so this is cheaper than
+ * 'count' calls to groth16_prover_prove.
+ *
+ * @param prover_object Prover object created by groth16_prover_create
+ * @param count Number of witnesses
+ * @param wtns_buffers Array of 'count' witness data buffers
+ * @param wtns_sizes Array of 'count' witness buffer sizes
+ * @param proof_buffers Array of 'count' buffers for proof output (JSON string)
+ * @param proof_sizes [in/out] Array of 'count' sizes, as proof_size of groth16_prover_prove
+ * @param public_buffers Array of 'count' buffers for public signals output (JSON string)
+ * @param public_sizes [in/out] Array of 'count' sizes, as public_size of groth16_prover_prove
+ * @param error_msg Buffer for error message
+ * @param error_msg_maxsize Size of error message buffer
+ *
+ * @return error code:
+ *         PROVER_OK - success, all proof_sizes and public_sizes contain bytes written (excluding null terminator)
+ *         PROVER_ERROR_SHORT_BUFFER - some buffers too small, nothing is written and all
+ *                                      proof_sizes and public_sizes are updated with required sizes
+ *         PROVER_INVALID_WITNESS_LENGTH - a witness length doesn't match circuit
+ *         PROVER_ERROR - other error, see error_msg
+ */
+int
+groth16_prover_prove_batch(
+    void                      *prover_object,
+    unsigned long long         count,
+    const void *const         *wtns_buffers,
+    const unsigned long long  *wtns_sizes,
+    char *const               *proof_buffers,
+    unsigned long long        *proof_sizes,
+    char *const               *public_buffers,
+    unsigned long long        *public_sizes,
+    char                      *error_msg,
+    unsigned long long         error_msg_maxsize);
+
 /**
  * Destroys 'prover_object'.
  */
@@ -0,0 +1,141 @@
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <future>
+#include <system_error>
+
+#include "residency.hpp"
+
+namespace Residency {
+
+#ifndef MADV_POPULATE_READ
+#define MADV_POPULATE_READ 22
+#endif
+
+static const uint64_t blockSize = 8 << 20;
+static const auto progressInterval = std::chrono::milliseconds(100);
+
+static size_t PageSize()
+{
+    const long pageSize = sysconf(_SC_PAGESIZE);
+
+    return pageSize > 0 ? pageSize : 4096;
+}
+
+// Page aligned cover of a range, as mlock and madvise need.
+static Range PageRange(const Range &range)
+{
+    const uintptr_t pageSize = PageSize();
+    const uintptr_t begin = (uintptr_t)range.addr / pageSize * pageSize;
+    const uintptr_t end = ((uintptr_t)range.addr + range.size + pageSize - 1) / pageSize * pageSize;
+
+    return Range{(const void *)begin, end - begin};
+}
+
+// Faults the pages of a block in. MADV_POPULATE_READ does it in one call
+// on Linux 5.14 and later, older kernels get a read per page.
+static void Populate(const Range &block)
+{
+    if (madvise((void *)block.addr, block.size, MADV_POPULATE_READ) == 0) {
+        return;
+    }
+
+    const size_t pageSize = PageSize();
+    const volatile uint8_t *bytes = (const uint8_t *)block.addr;
+    uint8_t sum = 0;
+
+    for (size_t i = 0; i < block.size; i += pageSize) {
+        sum += bytes[i];
+    }
+    (void)sum;
+}
+
+void Resident::warmUp(const std::vector<Range> &ranges, bool lock, ThreadPool &pool, const Progress &progress)
+{
+    std::vector<Range> pageRanges;
+    std::vector<Range> blocks;
+    uint64_t total = 0;
+
+    for (const Range &range : ranges) {
+        if (range.addr == nullptr || range.size == 0) {
+            continue;
+        }
+
+        const Range pages = PageRange(range);
+
+        // Starts the read-ahead of file backed ranges before any thread
+        // waits on a page.
+        madvise((void *)pages.addr, pages.size, MADV_WILLNEED);
+
+        for (uint64_t from = 0; from < pages.size; from += blockSize) {
+            blocks.push_back(Range{(const uint8_t *)pages.addr + from, std::min(blockSize, pages.size - from)});
+        }
+
+        pageRanges.push_back(pages);
+        total += pages.size;
+    }
+
+    if (lock) {
+        unlock();
+    }
+
+    std::atomic<uint64_t> done(0);
+    std::atomic<int> lockError(0);
+
+    auto worker = std::async(std::launch::async, [&] () {
+        pool.parallelFor(0, blocks.size(), [&] (int64_t begin, int64_t end, uint64_t idThread) {
+            for (int64_t i = begin; i < end; i++) {
+                if (lock && lockError == 0) {
+                    // mlock faults the pages in as well.
+                    if (mlock(blocks[i].addr, blocks[i].size) != 0) {
+                        int expected = 0;
+                        lockError.compare_exchange_strong(expected, errno);
+                    }
+                } else {
+                    Populate(blocks[i]);
+                }
+                done += blocks[i].size;
+            }
+        });
+    });
+
+    while (worker.wait_for(progressInterval) != std::future_status::ready) {
+        if (progress) {
+            progress(done, total);
+        }
+    }
+    worker.get();
+
+    if (lockError != 0) {
+        for (const Range &pages : pageRanges) {
+            munlock(pages.addr, pages.size);
+        }
+        throw std::system_error(lockError, std::generic_category(), "mlock");
+    }
+
+    warm = total;
+
+    if (lock) {
+        locked = pageRanges;
+        lockedTotal = total;
+    }
+
+    if (progress) {
+        progress(total, total);
+    }
+}
+
+void Resident::unlock()
+{
+    for (const Range &pages : locked) {
+        munlock(pages.addr, pages.size);
+    }
+
+    locked.clear();
+    lockedTotal = 0;
+}
+
+} // Namespace
@@ -0,0 +1,52 @@
+#ifndef RESIDENCY_HPP
+#define RESIDENCY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "threadpool.hpp"
+
+namespace Residency {
+
+    struct Range {
+        const void *addr;
+        size_t      size;
+    };
+
+    // Called with the bytes of the ranges warmed so far and their total.
+    typedef std::function<void (uint64_t done, uint64_t total)> Progress;
+
+    // Ranges of memory, typically of a mapped zkey, faulted in ahead of
+    // the first proof and optionally locked in RAM. The locks are released
+    // when the object is destroyed.
+    class Resident {
+        std::vector<Range> locked;
+        uint64_t warm;
+        uint64_t lockedTotal;
+
+    public:
+        Resident() : warm(0), lockedTotal(0) {}
+        ~Resident() { unlock(); }
+
+        Resident(const Resident&) = delete;
+        Resident& operator=(const Resident&) = delete;
+
+        // Faults in all the pages of 'ranges' in blocks spread over
+        // 'pool' and, with 'lock', locks them in RAM in place of the ranges
+        // locked before. 'progress' is called on the calling thread while
+        // the pool works, and a last time with done equal to total once
+        // all the pages are in. Throws std::system_error if the pages
+        // cannot be locked, e.g. over RLIMIT_MEMLOCK, leaving none of the
+        // ranges locked.
+        void warmUp(const std::vector<Range> &ranges, bool lock, ThreadPool &pool, const Progress &progress);
+
+        void unlock();
+
+        uint64_t warmBytes() const { return warm; }
+        uint64_t lockedBytes() const { return lockedTotal; }
+    };
+}
+
+#endif // RESIDENCY_HPP
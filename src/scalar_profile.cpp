@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <cstring>
+
+#include "scalar_profile.hpp"
+
+namespace MultiExp {
+
+ScalarClass classifyScalar(const uint8_t *scalar, uint64_t scalarSize)
+{
+    const uint64_t shortBytes = shortScalarBits / 8;
+    uint64_t low = 0;
+
+    std::memcpy(&low, scalar, std::min(scalarSize, shortBytes));
+
+    for (uint64_t i = shortBytes; i < scalarSize; i++) {
+        if (scalar[i] != 0) {
+            return ScalarFull;
+        }
+    }
+
+    if (low == 0) {
+        return ScalarZero;
+    }
+    return low == 1 ? ScalarOne : ScalarShort;
+}
+
+ScalarProfile::ScalarProfile()
+{
+    std::fill(counts, counts + nScalarClasses, 0);
+}
+
+void ScalarProfile::build(uint8_t *const *scalars, uint64_t scalarSize, uint64_t n, uint64_t nBatch, ThreadPool &threadPool)
+{
+    const uint64_t rangeSize = 1 << 16;
+    const uint64_t nRanges = (n + rangeSize - 1) / rangeSize;
+
+    std::vector<std::vector<uint32_t>> rangeLists(nRanges * nScalarClasses);
+
+    threadPool.parallelFor(0, nRanges, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        for (int64_t k = begin; k < end; k++) {
+            const uint64_t to = std::min(n, (k + 1) * rangeSize);
+
+            for (uint64_t i = k * rangeSize; i < to; i++) {
+                ScalarClass c = ScalarZero;
+
+                for (uint64_t w = 0; w < nBatch && c != ScalarFull; w++) {
+                    c = std::max(c, classifyScalar(scalars[w] + i*scalarSize, scalarSize));
+                }
+
+                rangeLists[k*nScalarClasses + c].push_back(i);
+            }
+        }
+    });
+
+    for (int c = 0; c < nScalarClasses; c++) {
+        lists[c].clear();
+        counts[c] = 0;
+
+        for (uint64_t k = 0; k < nRanges; k++) {
+            counts[c] += rangeLists[k*nScalarClasses + c].size();
+        }
+
+        // Zero scalars are only counted.
+        if (c == ScalarZero) {
+            continue;
+        }
+
+        lists[c].reserve(counts[c]);
+
+        for (uint64_t k = 0; k < nRanges; k++) {
+            const std::vector<uint32_t> &l = rangeLists[k*nScalarClasses + c];
+            lists[c].insert(lists[c].end(), l.begin(), l.end());
+        }
+    }
+}
+
+void ScalarProfile::slice(ScalarProfile &r, uint64_t from, uint64_t n) const
+{
+    uint64_t nonZero = 0;
+
+    for (int c = 0; c < nScalarClasses; c++) {
+        r.lists[c].clear();
+
+        if (c == ScalarZero) {
+            continue;
+        }
+
+        auto begin = std::lower_bound(lists[c].begin(), lists[c].end(), from);
+        auto end = std::lower_bound(begin, lists[c].end(), from + n);
+
+        for (auto it = begin; it != end; ++it) {
+            r.lists[c].push_back(*it - from);
+        }
+
+        r.counts[c] = r.lists[c].size();
+        nonZero += r.counts[c];
+    }
+
+    r.counts[ScalarZero] = n - nonZero;
+}
+
+void ScalarProfile::exclude(ScalarProfile &r, const std::vector<uint32_t> &excluded) const
+{
+    uint64_t removed = 0;
+
+    for (int c = 0; c < nScalarClasses; c++) {
+        r.lists[c].clear();
+
+        if (c == ScalarZero) {
+            continue;
+        }
+
+        r.lists[c].reserve(lists[c].size());
+
+        auto next = excluded.begin();
+
+        for (uint32_t i : lists[c]) {
+            next = std::lower_bound(next, excluded.end(), i);
+
+            if (next == excluded.end() || *next != i) {
+                r.lists[c].push_back(i);
+            }
+        }
+
+        r.counts[c] = r.lists[c].size();
+        removed += counts[c] - r.counts[c];
+    }
+
+    r.counts[ScalarZero] = counts[ScalarZero] + removed;
+}
+
+} // Namespace
@@ -0,0 +1,49 @@
+#ifndef SCALAR_PROFILE_HPP
+#define SCALAR_PROFILE_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "threadpool.hpp"
+
+namespace MultiExp {
+
+    // Classes of scalars, from the cheapest to the most expensive one.
+    enum ScalarClass {
+        ScalarZero,
+        ScalarOne,
+        ScalarShort,
+        ScalarFull,
+        nScalarClasses
+    };
+
+    // Scalars with no more significant bits than this are short.
+    const uint64_t shortScalarBits = 64;
+
+    ScalarClass classifyScalar(const uint8_t *scalar, uint64_t scalarSize);
+
+    // Indices of the scalars of every class. For a batch of scalar vectors
+    // the class of an index is the most expensive class among the vectors.
+    class ScalarProfile {
+
+        std::vector<uint32_t> lists[nScalarClasses];
+        uint64_t counts[nScalarClasses];
+
+    public:
+        ScalarProfile();
+
+        void build(uint8_t *const *scalars, uint64_t scalarSize, uint64_t n, uint64_t nBatch, ThreadPool &threadPool);
+
+        // Profile of the scalars [from, from + n) with indices relative to 'from'.
+        void slice(ScalarProfile &r, uint64_t from, uint64_t n) const;
+
+        // Profile of the same scalars with those of the sorted indices
+        // 'excluded' counted as zeros, for the scalars of points at infinity.
+        void exclude(ScalarProfile &r, const std::vector<uint32_t> &excluded) const;
+
+        uint64_t count(ScalarClass c) const { return counts[c]; }
+        const std::vector<uint32_t> &indices(ScalarClass c) const { return lists[c]; }
+    };
+}
+
+#endif // SCALAR_PROFILE_HPP
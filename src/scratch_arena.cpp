@@ -0,0 +1,178 @@
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <system_error>
+
+#include "scratch_arena.hpp"
+#include "threadpool.hpp"
+
+namespace ScratchArena {
+
+static size_t PageSize()
+{
+    const long pageSize = sysconf(_SC_PAGESIZE);
+
+    return pageSize > 0 ? pageSize : 4096;
+}
+
+Buffer::Buffer(size_t _size)
+    : Buffer(_size, ThreadPool::defaultPool())
+{
+}
+
+#if defined(MAP_HUGETLB) && !defined(MAP_HUGE_SHIFT)
+#define MAP_HUGE_SHIFT 26
+#endif
+
+#ifdef MADV_HUGEPAGE
+static const size_t hugePageSize = 2 << 20;
+#endif
+
+void Buffer::map(PageMode mode)
+{
+#if defined(MAP_HUGETLB)
+    if (mode == HugeTlb2M || mode == HugeTlb1G) {
+        const int sizeShift = mode == HugeTlb1G ? 30 : 21;
+        const size_t pageSize = (size_t)1 << sizeShift;
+        const size_t hugeSize = (size + pageSize - 1) / pageSize * pageSize;
+
+        addr = mmap(nullptr, hugeSize, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (sizeShift << MAP_HUGE_SHIFT), -1, 0);
+
+        if (addr != MAP_FAILED) {
+            size = hugeSize;
+            hugeTlb = true;
+            return;
+        }
+    }
+#endif
+
+#ifdef MADV_HUGEPAGE
+    // hugetlbfs modes without free huge pages fall back to these.
+    if (mode != SmallPages) {
+        // Huge pages need 2 MB aligned ranges, so the mapping is trimmed to
+        // a 2 MB boundary at both ends.
+        const size_t hugeSize = (size + hugePageSize - 1) / hugePageSize * hugePageSize;
+        const size_t mapSize = hugeSize + hugePageSize;
+
+        uint8_t *base = (uint8_t *)mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (base == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "scratch mmap failed");
+        }
+
+        uint8_t *aligned = (uint8_t *)(((uintptr_t)base + hugePageSize - 1) / hugePageSize * hugePageSize);
+
+        if (aligned > base) {
+            munmap(base, aligned - base);
+        }
+        if (base + mapSize > aligned + hugeSize) {
+            munmap(aligned + hugeSize, base + mapSize - (aligned + hugeSize));
+        }
+
+        addr = aligned;
+        size = hugeSize;
+
+        // Not fatal: the kernel may have transparent huge pages disabled.
+        madvise(addr, size, MADV_HUGEPAGE);
+        return;
+    }
+#endif
+
+    addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (addr == MAP_FAILED) {
+        throw std::system_error(errno, std::generic_category(), "scratch mmap failed");
+    }
+}
+
+Buffer::Buffer(size_t _size, ThreadPool &touchPool, PageMode mode)
+    : addr(nullptr)
+    , size(_size)
+    , hugeTlb(false)
+{
+    const size_t pageSize = PageSize();
+
+    size = (size + pageSize - 1) / pageSize * pageSize;
+
+    if (size == 0) {
+        return;
+    }
+
+    try {
+        map(mode);
+    } catch (...) {
+        addr = nullptr;
+        throw;
+    }
+
+    volatile uint8_t *bytes = (uint8_t *)addr;
+    const int64_t nPages = size / pageSize;
+
+    touchPool.parallelFor(0, nPages, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        for (int64_t i = begin; i < end; i++) {
+            bytes[i * pageSize] = 0;
+        }
+    });
+}
+
+Buffer::~Buffer()
+{
+    if (addr) {
+        munmap(addr, size);
+    }
+}
+
+size_t Buffer::hugePageBytes() const
+{
+    if (addr == nullptr) {
+        return 0;
+    }
+
+    if (hugeTlb) {
+        return size;
+    }
+
+    // Sums the AnonHugePages of the mappings that overlap the buffer.
+    const uintptr_t begin = (uintptr_t)addr;
+    const uintptr_t end = begin + size;
+    std::ifstream smaps("/proc/self/smaps");
+    std::string line;
+    bool inside = false;
+    size_t bytes = 0;
+
+    while (std::getline(smaps, line)) {
+        const auto dash = line.find('-');
+        const auto space = line.find(' ');
+
+        if (dash != std::string::npos && space != std::string::npos && dash < space &&
+            line.find(':') > space)
+        {
+            const uintptr_t first = std::strtoull(line.c_str(), nullptr, 16);
+            const uintptr_t last = std::strtoull(line.c_str() + dash + 1, nullptr, 16);
+
+            inside = first < end && last > begin;
+            continue;
+        }
+
+        if (inside && line.compare(0, 14, "AnonHugePages:") == 0) {
+            bytes += std::strtoull(line.c_str() + 14, nullptr, 10) * 1024;
+        }
+    }
+
+    return std::min(bytes, size);
+}
+
+size_t Layout::add(size_t size)
+{
+    const size_t cacheLine = 64;
+
+    offsets.push_back(total);
+    total += (size + cacheLine - 1) / cacheLine * cacheLine;
+
+    return offsets.size() - 1;
+}
+
+} // Namespace
@@ -0,0 +1,178 @@
+#ifndef SCRATCH_ARENA_HPP
+#define SCRATCH_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+#include "threadpool.hpp"
+
+namespace ScratchArena {
+
+    // Pages backing a Buffer. The hugetlbfs modes fall back to transparent
+    // huge pages when the kernel has no huge pages of that size reserved.
+    // Outside Linux every mode maps small pages.
+    enum PageMode {
+        SmallPages,
+        TransparentHugePages,   // 2 MB aligned, MADV_HUGEPAGE
+        HugeTlb2M,              // MAP_HUGETLB with 2 MB pages
+        HugeTlb1G               // MAP_HUGETLB with 1 GB pages
+    };
+
+    // Page aligned anonymous mapping. All its pages are touched when it is
+    // created, so later users pay neither allocator calls nor first-touch
+    // page faults. The pages are touched on 'touchPool', by default the
+    // default pool, and so land on the NUMA nodes of its threads.
+    class Buffer {
+        void   *addr;
+        size_t  size;
+        bool    hugeTlb;
+
+        void map(PageMode mode);
+
+    public:
+        explicit Buffer(size_t _size);
+        Buffer(size_t _size, ThreadPool &touchPool, PageMode mode = SmallPages);
+        ~Buffer();
+
+        Buffer(const Buffer&) = delete;
+        Buffer& operator=(const Buffer&) = delete;
+
+        void   *data() { return addr; }
+        size_t  dataSize() const { return size; }
+
+        // Bytes of the buffer the kernel backs with huge pages.
+        size_t  hugePageBytes() const;
+    };
+
+    // Carves consecutive, cache line aligned regions out of one Buffer.
+    class Layout {
+        std::vector<size_t> offsets;
+        size_t total;
+
+    public:
+        Layout() : total(0) {}
+
+        size_t add(size_t size);
+        size_t size() const { return total; }
+        void  *region(Buffer &buffer, size_t id) const { return (uint8_t *)buffer.data() + offsets[id]; }
+    };
+
+    // Small pool of scratch sets. Every caller checks one set out for the
+    // duration of its work; sets are created on demand up to 'maxSets' and
+    // further callers wait until one is returned.
+    template <typename T>
+    class Pool {
+        std::mutex mutex;
+        std::condition_variable released;
+        std::vector<std::unique_ptr<T>> idle;
+        size_t maxSets;
+        size_t nSets;
+        uint64_t generation;
+
+        void release(T *set, uint64_t setGeneration) {
+            std::unique_ptr<T> owned(set);
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+
+                if (setGeneration == generation) {
+                    idle.push_back(std::move(owned));
+                } else {
+                    nSets--;
+                }
+            }
+            released.notify_one();
+        }
+
+    public:
+        class Handle {
+            Pool *pool;
+            T *set;
+            uint64_t setGeneration;
+
+        public:
+            Handle(Pool *_pool, T *_set, uint64_t _setGeneration)
+                : pool(_pool), set(_set), setGeneration(_setGeneration) {}
+
+            Handle(Handle &&other)
+                : pool(other.pool), set(other.set), setGeneration(other.setGeneration) {
+                other.pool = nullptr;
+                other.set = nullptr;
+            }
+
+            ~Handle() {
+                if (pool) {
+                    pool->release(set, setGeneration);
+                }
+            }
+
+            Handle(const Handle&) = delete;
+            Handle& operator=(const Handle&) = delete;
+
+            T &operator*() { return *set; }
+            T *operator->() { return set; }
+        };
+
+        explicit Pool(size_t _maxSets = 1)
+            : maxSets(_maxSets ? _maxSets : 1), nSets(0), generation(0) {}
+
+        // Drops the idle sets; the ones checked out are freed when returned.
+        // Used when the size of the sets changes.
+        void reset(size_t _maxSets) {
+            std::lock_guard<std::mutex> guard(mutex);
+
+            nSets -= idle.size();
+            idle.clear();
+            generation++;
+            maxSets = _maxSets ? _maxSets : 1;
+            released.notify_all();
+        }
+
+        template <typename Factory>
+        Handle checkout(Factory factory) {
+            return checkout(factory, [] (const T &) { return true; });
+        }
+
+        // Checks out an idle set accepted by 'fits'. When none fits, an idle
+        // set is dropped, if needed, to make room for a new one.
+        template <typename Factory, typename Fits>
+        Handle checkout(Factory factory, Fits fits) {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            released.wait(lock, [this] { return !idle.empty() || nSets < maxSets; });
+
+            for (size_t i = 0; i < idle.size(); i++) {
+                if (fits(*idle[i])) {
+                    T *set = idle[i].release();
+                    idle.erase(idle.begin() + i);
+                    return Handle(this, set, generation);
+                }
+            }
+
+            if (nSets >= maxSets) {
+                idle.pop_back();
+                nSets--;
+            }
+
+            const uint64_t setGeneration = generation;
+            nSets++;
+            lock.unlock();
+
+            T *set;
+            try {
+                set = factory();
+            } catch (...) {
+                lock.lock();
+                nSets--;
+                released.notify_one();
+                throw;
+            }
+            return Handle(this, set, setGeneration);
+        }
+    };
+}
+
+#endif // SCRATCH_ARENA_HPP
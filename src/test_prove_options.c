@@ -0,0 +1,187 @@
+/**
+ * Test that groth16_prover_prove gives valid proofs under the scheduling
+ * options, in particular NUMA mode with and without the task graph and a
+ * memory budget no proof fits.
+ *
+ * Run it as
+ * ./test_prove_options <zkey_file> <wtns_file> <verification_key_file>
+ * it will prove the witness under every option set and verify each proof
+ * against the verification key. Option sets the platform rejects, such as
+ * NUMA mode off Linux, are skipped. Return 0 if success.
+ * Return 1 if failure. Also prints the time taken by each proof.
+ */
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include "prover.h"
+#include "verifier.h"
+
+struct option_value {
+    int option;
+    long long value;
+};
+
+struct option_set {
+    const char *name;
+    int count;
+    struct option_value values[2];
+};
+
+static const struct option_set option_sets[] = {
+    { "default",         0, { { 0, 0 } } },
+    { "task graph",      1, { { PROVER_OPTION_TASK_GRAPH, 1 } } },
+    { "numa",            1, { { PROVER_OPTION_NUMA, 1 } } },
+    { "numa task graph", 2, { { PROVER_OPTION_NUMA, 1 }, { PROVER_OPTION_TASK_GRAPH, 1 } } },
+    { "memory budget",   1, { { PROVER_OPTION_MEMORY_BUDGET, 1 } } },
+};
+
+/* Reads 'fname' into a new buffer with a terminating zero. */
+static char *
+read_file(const char *fname, unsigned long long *size) {
+    char *buf = NULL;
+
+    int fd = open(fname, O_RDONLY);
+    if (fd == -1) {
+        printf("Error: open %s\n", fname);
+        return NULL;
+    }
+
+    struct stat sb = {0};
+    if (fstat(fd, &sb) == -1) {
+        printf("Error: fstat %s\n", fname);
+        goto cleanup;
+    }
+
+    buf = malloc(sb.st_size + 1);
+    if (buf == NULL) {
+        printf("Error: %s\n", "malloc");
+        goto cleanup;
+    }
+
+    ssize_t bytes_read = read(fd, buf, sb.st_size);
+    if (bytes_read != sb.st_size) {
+        printf("Error: read %s\n", fname);
+        free(buf);
+        buf = NULL;
+        goto cleanup;
+    }
+
+    buf[sb.st_size] = 0;
+    *size = sb.st_size;
+
+cleanup:
+
+    if (close(fd) == -1)
+        printf("Error: %s\n", "close");
+
+    return buf;
+}
+
+/* Returns 0 if the proof is valid, 1 if it is not and -1 if the set is skipped. */
+static int
+test_option_set(const struct option_set *set, const char *zkey, unsigned long long zkey_size,
+                const char *wtns, unsigned long long wtns_size, const char *vkey) {
+    int ret_val = 1;
+    enum { error_sz = 256, proof_sz = 4096 };
+    char error_msg[error_sz];
+    char proof[proof_sz];
+    char *public_buf = NULL;
+    void *prover = NULL;
+
+    unsigned long long public_size = 0;
+    if (groth16_public_size_for_zkey_buf(zkey, zkey_size, &public_size, error_msg, error_sz) != PROVER_OK) {
+        printf("Error: %s\n", error_msg);
+        goto cleanup;
+    }
+
+    public_buf = malloc(public_size);
+    if (public_buf == NULL) {
+        printf("Error: %s\n", "malloc");
+        goto cleanup;
+    }
+
+    if (groth16_prover_create(&prover, zkey, zkey_size, error_msg, error_sz) != PROVER_OK) {
+        printf("Error: %s\n", error_msg);
+        goto cleanup;
+    }
+
+    for (int i = 0; i < set->count; i++) {
+        if (groth16_prover_set_option(prover, set->values[i].option, set->values[i].value,
+                                      error_msg, error_sz) != PROVER_OK) {
+            printf("%s skipped: %s\n", set->name, error_msg);
+            ret_val = -1;
+            goto cleanup;
+        }
+    }
+
+    clock_t start = clock();
+    unsigned long long proof_size = proof_sz;
+
+    if (groth16_prover_prove(prover, wtns, wtns_size, proof, &proof_size,
+                             public_buf, &public_size, error_msg, error_sz) != PROVER_OK) {
+        printf("Error: %s\n", error_msg);
+        goto cleanup;
+    }
+
+    clock_t end = clock();
+
+    int verified = groth16_verify(proof, public_buf, vkey, error_msg, error_sz);
+    if (verified == VERIFIER_VALID_PROOF) {
+        printf("%s proof verified, proved in %f seconds\n", set->name,
+               (double)(end - start) / CLOCKS_PER_SEC);
+        ret_val = 0;
+    } else if (verified == VERIFIER_INVALID_PROOF) {
+        printf("%s proof is invalid\n", set->name);
+    } else {
+        printf("Error: %s\n", error_msg);
+    }
+
+cleanup:
+
+    if (prover != NULL)
+        groth16_prover_destroy(prover);
+    free(public_buf);
+
+    return ret_val;
+}
+
+int
+main(int argc, char *argv[]) {
+    if (argc < 4) {
+        printf("Usage: %s <zkey_file> <wtns_file> <verification_key_file>\n", argv[0]);
+        return 1;
+    }
+
+    unsigned long long zkey_size = 0;
+    unsigned long long wtns_size = 0;
+    unsigned long long vkey_size = 0;
+    char *zkey = read_file(argv[1], &zkey_size);
+    char *wtns = read_file(argv[2], &wtns_size);
+    char *vkey = read_file(argv[3], &vkey_size);
+
+    if (zkey == NULL || wtns == NULL || vkey == NULL) {
+        free(zkey);
+        free(wtns);
+        free(vkey);
+        return 1;
+    }
+
+    int ret_val = 0;
+
+    for (size_t i = 0; i < sizeof(option_sets) / sizeof(option_sets[0]); i++) {
+        if (test_option_set(&option_sets[i], zkey, zkey_size, wtns, wtns_size, vkey) > 0) {
+            printf("test_prove_options %s failed\n", option_sets[i].name);
+            ret_val = 1;
+        }
+    }
+
+    free(zkey);
+    free(wtns);
+    free(vkey);
+
+    return ret_val;
+}
@@ -4,8 +4,25 @@
 #include <string>
 #include <cstdint>
 #include <cstring>
+#include <vector>
 #include "fr.hpp"
 #include "fq.hpp"
+#include "threadpool.hpp"
+#include "coef_partition.hpp"
+#include "alt_bn128.hpp"
+#include "glv.hpp"
+#include "window_digits.hpp"
+#include "multiexp.hpp"
+
+// Small blocks and tiles, so the test domains go through the in-block, the
+// layered and the tiled passes of CosetFFT.
+#define COSET_FFT_BLOCK_BITS 2
+#define COSET_FFT_TILED_BITS 6
+#define COSET_FFT_TILE_COLUMNS 2
+#include "fft.hpp"
+#include "coset_fft.hpp"
+#include "montgomery.hpp"
+#include "field_batch.hpp"
 
 int tests_run = 0;
 int tests_failed = 0;
@@ -10923,6 +10940,1030 @@ void Fq_bnot_unit_test()
     Fq_bnot_test(r23, m3, 23);
 }
 
+// Element i of operand stream 'stream' of the field tests. Squarings
+// spread the small seeds over the whole field.
+template <typename Field>
+void test_element(Field &f, typename Field::Element &x, u_int64_t i, u_int64_t stream, int squarings = 3)
+{
+    f.fromUI(x, (i + 1) * 2654435761ULL + stream * 40503ULL);
+
+    for (int k = 0; k < squarings; k++) {
+        f.square(x, x);
+    }
+}
+
+struct TestCoef {
+    u_int32_t m;
+    u_int32_t c;
+    u_int32_t s;
+    RawFr::Element coef;
+};
+
+// Coefficients on random constraints. With 'skewed' set, half of them go
+// to constraint 3, as the long linear combinations of real circuits do.
+void CoefPartition_coefs(std::vector<TestCoef> &coefs, u_int64_t nCoefs, u_int32_t domainSize, u_int32_t nWitness, bool skewed)
+{
+    RawFr &f = RawFr::field;
+    u_int64_t seed = 88172645463325252ULL;
+
+    coefs.resize(nCoefs);
+
+    for (u_int64_t i = 0; i < nCoefs; i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+
+        coefs[i].m = seed & 1;
+        coefs[i].c = (skewed && (i & 1)) ? 3 % domainSize : (seed >> 8) % domainSize;
+        coefs[i].s = (seed >> 40) % nWitness;
+        test_element(f, coefs[i].coef, i, 0);
+    }
+}
+
+// Checks that the partition ranges tile [0, domainSize) and [0, nCoefs)
+// and that every partition holds exactly the coefficients of its range.
+void CoefPartition_test(u_int64_t nCoefs, u_int32_t domainSize, u_int64_t nPartitions, bool skewed)
+{
+    std::vector<TestCoef> coefs;
+    Groth16::CoefPartition<TestCoef> partition;
+
+    CoefPartition_coefs(coefs, nCoefs, domainSize, 1, skewed);
+    partition.build(coefs.data(), nCoefs, domainSize, nPartitions);
+
+    std::vector<int> seen(nCoefs, 0);
+    bool ok = !partition.empty() &&
+              partition.constraintBegin(0) == 0 &&
+              partition.coefBegin(0) == 0 &&
+              partition.constraintEnd(partition.size() - 1) == domainSize &&
+              partition.coefEnd(partition.size() - 1) == nCoefs;
+
+    for (u_int64_t p = 0; ok && p < partition.size(); p++) {
+        if (p > 0 && (partition.constraintBegin(p) != partition.constraintEnd(p - 1) ||
+                      partition.coefBegin(p) != partition.coefEnd(p - 1))) {
+            ok = false;
+        }
+        if (partition.constraintBegin(p) >= partition.constraintEnd(p) ||
+            partition.coefBegin(p) > partition.coefEnd(p)) {
+            ok = false;
+        }
+        for (u_int64_t k = partition.coefBegin(p); ok && k < partition.coefEnd(p); k++) {
+            const u_int32_t i = partition.coef(k);
+
+            if (i >= nCoefs || seen[i]++ ||
+                coefs[i].c < partition.constraintBegin(p) ||
+                coefs[i].c >= partition.constraintEnd(p)) {
+                ok = false;
+            }
+        }
+    }
+
+    if (!ok) {
+        std::cout << __func__ << ":" << nCoefs << "," << domainSize << "," << nPartitions
+                  << (skewed ? ",skewed" : "") << " failed!" << std::endl;
+        std::cout << std::endl;
+        tests_failed++;
+    }
+    tests_run++;
+}
+
+// Accumulates a and b over the partitions on the thread pool, as the
+// prover does, and compares them with the serial loop over all the
+// coefficients.
+void CoefPartition_accumulate_test(u_int64_t nCoefs, u_int32_t domainSize, u_int64_t nPartitions, bool skewed)
+{
+    RawFr &f = RawFr::field;
+    const u_int32_t nWitness = 64;
+
+    std::vector<TestCoef> coefs;
+    std::vector<RawFr::Element> wtns(nWitness);
+    Groth16::CoefPartition<TestCoef> partition;
+
+    CoefPartition_coefs(coefs, nCoefs, domainSize, nWitness, skewed);
+    for (u_int32_t i = 0; i < nWitness; i++) {
+        test_element(f, wtns[i], i, 1);
+    }
+    partition.build(coefs.data(), nCoefs, domainSize, nPartitions);
+
+    std::vector<RawFr::Element> expected[2];
+    std::vector<RawFr::Element> computed[2];
+
+    for (int m = 0; m < 2; m++) {
+        expected[m].resize(domainSize);
+        computed[m].resize(domainSize);
+
+        for (u_int32_t i = 0; i < domainSize; i++) {
+            f.copy(expected[m][i], f.zero());
+            f.copy(computed[m][i], f.one());
+        }
+    }
+
+    for (u_int64_t i = 0; i < nCoefs; i++) {
+        RawFr::Element aux;
+
+        f.mul(aux, wtns[coefs[i].s], coefs[i].coef);
+        f.add(expected[coefs[i].m][coefs[i].c], expected[coefs[i].m][coefs[i].c], aux);
+    }
+
+    ThreadPool::defaultPool().parallelFor(0, partition.size(), [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        for (int64_t p = begin; p < end; p++) {
+            for (u_int32_t i = partition.constraintBegin(p); i < partition.constraintEnd(p); i++) {
+                f.copy(computed[0][i], f.zero());
+                f.copy(computed[1][i], f.zero());
+            }
+
+            for (u_int64_t k = partition.coefBegin(p); k < partition.coefEnd(p); k++) {
+                const TestCoef &coef = coefs[partition.coef(k)];
+                RawFr::Element aux;
+
+                f.mul(aux, wtns[coef.s], coef.coef);
+                f.add(computed[coef.m][coef.c], computed[coef.m][coef.c], aux);
+            }
+        }
+    });
+
+    for (int m = 0; m < 2; m++) {
+        for (u_int32_t i = 0; i < domainSize; i++) {
+            if (!is_equal(expected[m][i].v, computed[m][i].v)) {
+                std::cout << __func__ << ":" << nCoefs << "," << domainSize << "," << nPartitions
+                          << (skewed ? ",skewed" : "") << " failed at " << (m ? "b" : "a") << ", index " << i << "!" << std::endl;
+                std::cout << "Expected: " << expected[m][i].v << std::endl;
+                std::cout << "Computed: " << computed[m][i].v << std::endl;
+                std::cout << std::endl;
+                tests_failed++;
+                break;
+            }
+        }
+        tests_run++;
+    }
+}
+
+// Zkeys with more than 2^32 coefficients and empty domains are left to
+// the locked fallback.
+void CoefPartition_empty_test()
+{
+    std::vector<TestCoef> coefs;
+    Groth16::CoefPartition<TestCoef> partition;
+
+    CoefPartition_coefs(coefs, 16, 8, 1, false);
+
+    // build() returns before reading the coefficients of a zkey that big.
+    partition.build(coefs.data(), (u_int64_t)UINT32_MAX + 1, 8, 4);
+    const bool large = partition.empty() && partition.size() == 0;
+
+    partition.build(coefs.data(), 16, 8, 4);
+    partition.build(coefs.data(), 0, 0, 4);
+    const bool noDomain = partition.empty() && partition.size() == 0;
+
+    if (!large || !noDomain) {
+        std::cout << __func__ << " failed!" << std::endl;
+        std::cout << std::endl;
+        tests_failed++;
+    }
+    tests_run++;
+}
+
+void CoefPartition_unit_test()
+{
+    const u_int64_t nPartitions[] = {1, 3, 16, 1000};
+
+    for (u_int64_t np : nPartitions) {
+        CoefPartition_test(0, 16, np, false);
+        CoefPartition_test(1, 1, np, false);
+        CoefPartition_test(100, 16, np, false);
+        CoefPartition_test(5000, 1024, np, false);
+        CoefPartition_test(5000, 1024, np, true);
+        CoefPartition_accumulate_test(5000, 1024, np, false);
+        CoefPartition_accumulate_test(5000, 1024, np, true);
+    }
+
+    CoefPartition_empty_test();
+}
+
+// Little-endian bytes of test_element() i of Fr, a scalar below r.
+void test_scalar(uint8_t *scalar, u_int64_t i, u_int64_t stream)
+{
+    RawFr &f = RawFr::field;
+    RawFr::Element x;
+
+    test_element(f, x, i, stream);
+    f.fromMontgomery(x, x);
+    std::memcpy(scalar, x.v, sizeof(x.v));
+}
+
+// Recombines the halves of GlvSplit as k1 + k2*lambda (mod r) and compares
+// them with the scalars, over random scalars and the edge cases: 0, 1,
+// 2^128 - 1 (left whole), 2^128, lambda and r - 1.
+void GlvSplit_test()
+{
+    const MultiExp::GlvSplit &glv = MultiExp::GlvSplit::bn254();
+    const u_int64_t scalarSize = 32;
+    const u_int64_t halfSize = MultiExp::GlvSplit::halfSize;
+    const u_int64_t nEdge = 6;
+    const u_int64_t n = 64 + nEdge;
+
+    std::vector<uint8_t> scalars(n * scalarSize, 0);
+    std::vector<uint8_t> halves(n * 2 * halfSize);
+    std::vector<uint8_t> negative(n * 2);
+
+    scalars[1 * scalarSize] = 1;
+    std::memset(&scalars[2 * scalarSize], 0xff, halfSize);
+    scalars[3 * scalarSize + halfSize] = 1;
+    glv.getLambda(&scalars[4 * scalarSize], scalarSize);
+
+    RawFr::Element rMinusOne;
+    RawFr::field.fromMontgomery(rMinusOne, RawFr::field.negOne());
+    std::memcpy(&scalars[5 * scalarSize], rMinusOne.v, scalarSize);
+
+    for (u_int64_t i = nEdge; i < n; i++) {
+        test_scalar(&scalars[i * scalarSize], i, 0);
+    }
+
+    glv.split(scalars.data(), scalarSize, n, halves.data(), negative.data(), ThreadPool::defaultPool());
+
+    mpz_t r, lambda, k, k1, k2, sum;
+    mpz_inits(r, lambda, k, k1, k2, sum, NULL);
+    mpz_set_str(r, "21888242871839275222246405745257275088548364400416034343698204186575808495617", 10);
+    mpz_import(lambda, scalarSize, -1, 1, -1, 0, &scalars[4 * scalarSize]);
+
+    for (u_int64_t i = 0; i < n; i++) {
+        mpz_import(k, scalarSize, -1, 1, -1, 0, &scalars[i * scalarSize]);
+        mpz_import(k1, halfSize, -1, 1, -1, 0, &halves[2 * i * halfSize]);
+        mpz_import(k2, halfSize, -1, 1, -1, 0, &halves[(2 * i + 1) * halfSize]);
+
+        if (negative[2 * i]) {
+            mpz_neg(k1, k1);
+        }
+        if (negative[2 * i + 1]) {
+            mpz_neg(k2, k2);
+        }
+
+        mpz_set(sum, k1);
+        mpz_addmul(sum, k2, lambda);
+        mpz_sub(sum, sum, k);
+        mpz_mod(sum, sum, r);
+
+        if (mpz_sgn(sum) != 0 || (i < 3 && mpz_cmp(k1, k) != 0)) {
+            std::cout << __func__ << ":" << i << " failed!" << std::endl;
+            gmp_printf("k: %Zd\nk1: %Zd\nk2: %Zd\n\n", k, k1, k2);
+            tests_failed++;
+        }
+        tests_run++;
+    }
+
+    mpz_clears(r, lambda, k, k1, k2, sum, NULL);
+}
+
+// Compares the images of the GLV endomorphism with lambda*P, for multiples
+// P of the generator of the group.
+template <typename Curve>
+void Endomorphism_test(Curve &g, const std::string &name)
+{
+    typedef typename Curve::Point Point;
+    typedef typename Curve::PointAffine PointAffine;
+    const u_int64_t n = 8;
+
+    MultiExp::Endomorphism<Curve> endomorphism(g);
+    uint8_t lambda[32];
+    uint8_t scalar[32];
+
+    MultiExp::GlvSplit::bn254().getLambda(lambda, sizeof(lambda));
+
+    std::vector<PointAffine> points(n), images(n);
+
+    for (u_int64_t i = 0; i < n; i++) {
+        Point p;
+
+        test_scalar(scalar, i, 1);
+        g.mulByScalar(p, g.oneAffine(), scalar, sizeof(scalar));
+        g.copy(points[i], p);
+    }
+
+    endomorphism.applyAll(images.data(), points.data(), n, ThreadPool::defaultPool());
+
+    for (u_int64_t i = 0; i < n; i++) {
+        Point expected, computed;
+
+        g.mulByScalar(expected, points[i], lambda, sizeof(lambda));
+        g.copy(computed, images[i]);
+
+        if (!g.eq(expected, computed)) {
+            std::cout << name << ":" << i << " failed!" << std::endl;
+            tests_failed++;
+        }
+        tests_run++;
+    }
+}
+
+void Glv_unit_test()
+{
+    GlvSplit_test();
+    Endomorphism_test(AltBn128::Engine::engine.g1, "G1_Endomorphism");
+    Endomorphism_test(AltBn128::Engine::engine.g2, "G2_Endomorphism");
+}
+
+// Decodes the windows of two scalar vectors with WindowDigits, for a width
+// and scalar length, and checks that every scalar is the sum of its digits
+// times 2^(j*bitsPerChunk) and that the digits are in range. Among the
+// scalars are those whose windows are all at the top, so the carry runs
+// into the last window.
+void WindowDigits_test(u_int64_t scalarSize, u_int64_t scalarBits, u_int64_t bitsPerChunk, bool signedDigits)
+{
+    const u_int64_t nBatch = 2;
+    const u_int64_t nEdge = 4;
+    const u_int64_t n = 16 + nEdge;
+
+    std::vector<std::vector<uint8_t>> scalars(nBatch, std::vector<uint8_t>(n * scalarSize, 0));
+    uint8_t *scalarPtrs[nBatch];
+    uint8_t full[32];
+
+    for (u_int64_t w = 0; w < nBatch; w++) {
+        uint8_t *s = scalars[w].data();
+
+        // 0, the largest scalar of scalarBits bits, and 0b1010... and
+        // 0b0101... over those bits.
+        for (u_int64_t b = 0; b < scalarBits; b++) {
+            s[scalarSize + b / 8] |= 1 << (b % 8);
+            s[(2 + b % 2) * scalarSize + b / 8] |= 1 << (b % 8);
+        }
+
+        for (u_int64_t i = nEdge; i < n; i++) {
+            test_scalar(full, i, w);
+            std::memcpy(s + i * scalarSize, full, scalarSize);
+        }
+
+        scalarPtrs[w] = s;
+    }
+
+    MultiExp::WindowDigits digits;
+    digits.build(scalarPtrs, scalarSize, scalarBits, n, nBatch, bitsPerChunk, signedDigits, ThreadPool::defaultPool());
+
+    const u_int64_t nChunks = MultiExp::windowCount(scalarBits, bitsPerChunk, signedDigits);
+    const int32_t maxDigit = signedDigits ? 1 << (bitsPerChunk - 1) : (1 << bitsPerChunk) - 1;
+    const int32_t minDigit = signedDigits ? 1 - maxDigit : 0;
+
+    mpz_t k, sum, term;
+    mpz_inits(k, sum, term, NULL);
+
+    for (u_int64_t w = 0; w < nBatch; w++) {
+        bool failed = false;
+
+        for (u_int64_t i = 0; i < n && !failed; i++) {
+            mpz_import(k, scalarSize, -1, 1, -1, 0, scalarPtrs[w] + i * scalarSize);
+            mpz_set_ui(sum, 0);
+
+            for (u_int64_t j = 0; j < nChunks; j++) {
+                const int32_t d = digits.digit(i, w, j);
+
+                failed |= d < minDigit || d > maxDigit;
+                mpz_set_si(term, d);
+                mpz_mul_2exp(term, term, j * bitsPerChunk);
+                mpz_add(sum, sum, term);
+            }
+
+            if (failed || mpz_cmp(sum, k) != 0) {
+                std::cout << __func__ << ":" << scalarBits << "/" << bitsPerChunk << (signedDigits ? " signed" : "")
+                          << " failed at vector " << w << ", index " << i << "!" << std::endl;
+                gmp_printf("Expected: %Zd\nComputed: %Zd\n\n", k, sum);
+                tests_failed++;
+                failed = true;
+            }
+        }
+        tests_run++;
+    }
+
+    mpz_clears(k, sum, term, NULL);
+}
+
+void WindowDigits_unit_test()
+{
+    for (u_int64_t bitsPerChunk = 1; bitsPerChunk <= 16; bitsPerChunk++) {
+        for (int signedDigits = 0; signedDigits < 2; signedDigits++) {
+            WindowDigits_test(32, 254, bitsPerChunk, signedDigits);
+            WindowDigits_test(MultiExp::GlvSplit::halfSize, 128, bitsPerChunk, signedDigits);
+        }
+    }
+}
+
+// Bases for the multiexp tests: random multiples of the generator, then a
+// copy and the negation of each of them, then the first one over and over,
+// so that affine additions meet points of equal x.
+template <typename Curve>
+void BatchAffine_bases(Curve &g, std::vector<typename Curve::PointAffine> &bases, u_int64_t nRandom)
+{
+    uint8_t scalar[32];
+
+    bases.resize(4 * nRandom);
+
+    for (u_int64_t i = 0; i < nRandom; i++) {
+        typename Curve::Point p;
+
+        test_scalar(scalar, i, 2);
+        g.mulByScalar(p, g.oneAffine(), scalar, sizeof(scalar));
+        g.copy(bases[i], p);
+        g.copy(bases[nRandom + i], bases[i]);
+        g.neg(bases[2 * nRandom + i], bases[i]);
+        g.copy(bases[3 * nRandom + i], bases[0]);
+    }
+}
+
+// Compares runBatch with batch-affine buckets with runBatch with xyzz ones.
+// In the first scalar vector the copies and negations of a base have its
+// scalar, so they land in its buckets; the second one is random.
+template <typename Curve>
+void BatchAffine_test(Curve &g, typename BatchAffine::CurveField<Curve>::Type &F, const std::string &name, bool signedDigits, u_int64_t nTasks)
+{
+    typedef typename Curve::Point Point;
+    typedef typename Curve::PointAffine PointAffine;
+    const u_int64_t nRandom = 128;
+    const u_int64_t scalarSize = 32;
+    const u_int64_t nBatch = 2;
+
+    std::vector<PointAffine> bases;
+    BatchAffine_bases(g, bases, nRandom);
+
+    const u_int64_t n = bases.size();
+    std::vector<std::vector<uint8_t>> scalars(nBatch, std::vector<uint8_t>(n * scalarSize));
+    uint8_t *scalarPtrs[nBatch];
+
+    for (u_int64_t i = 0; i < n; i++) {
+        test_scalar(&scalars[0][i * scalarSize], i < 3 * nRandom ? i % nRandom : 0, 3);
+        test_scalar(&scalars[1][i * scalarSize], i, 4);
+    }
+    for (u_int64_t w = 0; w < nBatch; w++) {
+        scalarPtrs[w] = scalars[w].data();
+    }
+
+    // Wide enough windows for the affine batches to be taken.
+    MultiExp::WindowTable table;
+    table.set(n, signedDigits, nTasks, MultiExp::WindowChoice{10, MultiExp::SplitPoints});
+
+    Point expected[nBatch], computed[nBatch];
+
+    MultiExp::Pippenger<Curve> xyzz(g, F, ThreadPool::defaultPool(), nTasks, signedDigits);
+    xyzz.setWindowTable(&table);
+    xyzz.runBatch(expected, bases.data(), scalarPtrs, scalarSize, n, nBatch);
+
+    MultiExp::Pippenger<Curve> affine(g, F, ThreadPool::defaultPool(), nTasks, signedDigits);
+    affine.setWindowTable(&table);
+    affine.setBatchAffine(true);
+    affine.runBatch(computed, bases.data(), scalarPtrs, scalarSize, n, nBatch);
+
+    for (u_int64_t w = 0; w < nBatch; w++) {
+        if (!g.eq(expected[w], computed[w])) {
+            std::cout << name << ":" << w << (signedDigits ? " signed" : "") << ", " << nTasks << " tasks failed!" << std::endl;
+            tests_failed++;
+        }
+        tests_run++;
+    }
+}
+
+// Compares the sums of PointSum with those of xyzz additions, over orders
+// of the bases that pair every point with its copy or its negation in the
+// first level of the reduction.
+template <typename Curve>
+void PointSum_test(Curve &g, typename BatchAffine::CurveField<Curve>::Type &F, const std::string &name)
+{
+    typedef typename Curve::Point Point;
+    typedef typename Curve::PointAffine PointAffine;
+    const u_int64_t nRandom = 128;
+
+    std::vector<PointAffine> bases;
+    BatchAffine_bases(g, bases, nRandom);
+
+    std::vector<uint32_t> indices;
+
+    for (u_int64_t i = 0; i < nRandom; i++) {
+        indices.push_back(i);
+        indices.push_back(nRandom + i);
+        indices.push_back(2 * nRandom + i);
+        indices.push_back(i);
+        indices.push_back(3 * nRandom + i);
+    }
+
+    BatchAffine::PointSum<Curve> pointSum(g, F);
+
+    for (u_int64_t count = 1; count <= indices.size(); count = count * 3 + 1) {
+        Point expected, computed;
+
+        g.copy(expected, g.zero());
+        for (u_int64_t i = 0; i < count; i++) {
+            g.add(expected, expected, bases[indices[i]]);
+        }
+
+        g.copy(computed, g.zero());
+        pointSum.add(computed, bases.data(), indices.data(), count);
+
+        if (!g.eq(expected, computed)) {
+            std::cout << name << ":" << count << " failed!" << std::endl;
+            tests_failed++;
+        }
+        tests_run++;
+    }
+}
+
+// Compares the mixed additions of MixedAdd with those of the curve, from
+// xyzz points with zz != 1 to the batch-affine bases and the point at
+// infinity, so that doublings and opposite points come up.
+template <typename Curve, typename Field>
+void MixedAdd_test(Curve &g, Field &F, const std::string &name)
+{
+    typedef typename Curve::Point Point;
+    typedef typename Curve::PointAffine PointAffine;
+
+    MultiExp::MixedAdd<Curve, Field> mixedAdd(g, F);
+    std::vector<PointAffine> bases;
+
+    BatchAffine_bases(g, bases, 4);
+    bases.push_back(g.zeroAffine());
+
+    for (u_int64_t i = 0; i < bases.size(); i++) {
+        Point start;
+
+        g.dbl(start, bases[i]);
+        g.sub(start, start, bases[i]);
+
+        for (u_int64_t j = 0; j < bases.size(); j++) {
+            for (int negative = 0; negative < 2; negative++) {
+                Point expected, computed;
+
+                g.copy(computed, start);
+                if (negative) {
+                    g.sub(expected, start, bases[j]);
+                    mixedAdd.sub(computed, bases[j]);
+                } else {
+                    g.add(expected, start, bases[j]);
+                    mixedAdd.add(computed, bases[j]);
+                }
+
+                if (!g.eq(expected, computed)) {
+                    std::cout << name << ":" << i << "," << j << "," << negative << " failed!" << std::endl;
+                    tests_failed++;
+                }
+                tests_run++;
+            }
+        }
+    }
+}
+
+void BatchAffine_unit_test()
+{
+    AltBn128::Engine &E = AltBn128::Engine::engine;
+
+    PointSum_test(E.g1, E.f1, "G1_PointSum");
+    PointSum_test(E.g2, E.f2, "G2_PointSum");
+
+    MixedAdd_test(E.g1, E.f1, "G1_MixedAdd");
+    MixedAdd_test(E.g2, E.f2, "G2_MixedAdd");
+
+    for (int signedDigits = 0; signedDigits < 2; signedDigits++) {
+        for (u_int64_t nTasks = 1; nTasks <= 3; nTasks += 2) {
+            BatchAffine_test(E.g1, E.f1, "G1_BatchAffine", signedDigits, nTasks);
+            BatchAffine_test(E.g2, E.f2, "G2_BatchAffine", signedDigits, nTasks);
+        }
+    }
+}
+
+// Inputs of the multiexp tests: the batch-affine bases and 'nBatch'
+// scalar vectors over them. The scalars of the even bases are of the
+// same class in all the vectors and those of the odd ones differ, so the
+// batch profile holds zeros, ones, short and full scalars.
+template <typename Curve>
+struct Multiexp_inputs {
+    static const u_int64_t scalarSize = 32;
+
+    std::vector<typename Curve::PointAffine> bases;
+    std::vector<std::vector<uint8_t>> scalars;
+    std::vector<uint8_t *> scalarPtrs;
+    u_int64_t n;
+
+    Multiexp_inputs(Curve &g, u_int64_t nRandom, u_int64_t nBatch)
+        : scalars(nBatch), scalarPtrs(nBatch)
+    {
+        BatchAffine_bases(g, bases, nRandom);
+        n = bases.size();
+
+        for (u_int64_t w = 0; w < nBatch; w++) {
+            scalars[w].assign(n * scalarSize, 0);
+            scalarPtrs[w] = scalars[w].data();
+
+            for (u_int64_t i = 0; i < n; i++) {
+                uint8_t *scalar = &scalars[w][i * scalarSize];
+
+                switch ((i * 7 + (i & 1) * w) % 11) {
+                case 0: case 1: case 2:
+                    break;
+                case 3: case 4: case 5:
+                    scalar[0] = 1;
+                    break;
+                case 6: case 7: case 8:
+                    test_scalar(scalar, i, 3 + w);
+                    std::memset(scalar + (i % 8) + 1, 0, scalarSize - (i % 8) - 1);
+                    break;
+                default:
+                    test_scalar(scalar, i, 3 + w);
+                }
+            }
+        }
+    }
+};
+
+// Compares runProfiled, which splits the scalars by class, with runBatch
+// over all of them.
+template <typename Curve>
+void Profiled_test(Curve &g, typename BatchAffine::CurveField<Curve>::Type &F, const std::string &name, u_int64_t nBatch, u_int64_t nTasks)
+{
+    typedef typename Curve::Point Point;
+
+    Multiexp_inputs<Curve> in(g, 128, nBatch);
+    MultiExp::Pippenger<Curve> msm(g, F, ThreadPool::defaultPool(), nTasks);
+    MultiExp::ScalarProfile profile;
+    std::vector<Point> expected(nBatch), computed(nBatch);
+
+    msm.runBatch(expected.data(), in.bases.data(), in.scalarPtrs.data(), in.scalarSize, in.n, nBatch);
+
+    profile.build(in.scalarPtrs.data(), in.scalarSize, in.n, nBatch, ThreadPool::defaultPool());
+    msm.runProfiled(computed.data(), in.bases.data(), in.scalarPtrs.data(), in.scalarSize, nBatch, profile);
+
+    bool allClasses = true;
+    for (int c = 0; c < MultiExp::nScalarClasses; c++) {
+        allClasses = allClasses && profile.count((MultiExp::ScalarClass)c) > 0;
+    }
+
+    for (u_int64_t w = 0; w < nBatch; w++) {
+        if (!allClasses || !g.eq(expected[w], computed[w])) {
+            std::cout << name << ":" << w << " of " << nBatch << ", " << nTasks << " tasks failed!" << std::endl;
+            tests_failed++;
+        }
+        tests_run++;
+    }
+}
+
+// Compares runBatch and runProfiled over shifted copies of the bases with
+// runBatch over the bases alone, for numbers of copies that do and do not
+// divide the number of windows and more copies than windows.
+template <typename Curve>
+void Shifted_test(Curve &g, typename BatchAffine::CurveField<Curve>::Type &F, const std::string &name, bool signedDigits, u_int64_t nCopies)
+{
+    typedef typename Curve::Point Point;
+    const u_int64_t nBatch = 2;
+
+    Multiexp_inputs<Curve> in(g, 128, nBatch);
+    MultiExp::Pippenger<Curve> msm(g, F, ThreadPool::defaultPool(), 3, signedDigits);
+    MultiExp::ShiftedBases<Curve> shifted;
+    MultiExp::ScalarProfile profile;
+    std::vector<Point> expected(nBatch), computedBatch(nBatch), computedProfiled(nBatch);
+
+    msm.runBatch(expected.data(), in.bases.data(), in.scalarPtrs.data(), in.scalarSize, in.n, nBatch);
+
+    msm.shiftBases(shifted, in.bases.data(), in.scalarSize, in.n, nCopies);
+    msm.runBatch(computedBatch.data(), in.bases.data(), in.scalarPtrs.data(), in.scalarSize, in.n, nBatch, nullptr, &shifted);
+
+    profile.build(in.scalarPtrs.data(), in.scalarSize, in.n, nBatch, ThreadPool::defaultPool());
+    msm.runProfiled(computedProfiled.data(), in.bases.data(), in.scalarPtrs.data(), in.scalarSize, nBatch, profile, nullptr, nullptr, &shifted);
+
+    for (u_int64_t w = 0; w < nBatch; w++) {
+        if (!g.eq(expected[w], computedBatch[w]) || !g.eq(expected[w], computedProfiled[w])) {
+            std::cout << name << ":" << w << (signedDigits ? " signed" : "") << ", " << nCopies << " copies of "
+                      << shifted.windowsPerCopy << " windows failed!" << std::endl;
+            tests_failed++;
+        }
+        tests_run++;
+    }
+}
+
+// Compares runBatch with the windows and the split of a window table
+// with runBatch with the default ones, for more tasks than windows too.
+template <typename Curve>
+void Split_test(Curve &g, typename BatchAffine::CurveField<Curve>::Type &F, const std::string &name,
+                bool signedDigits, MultiExp::Strategy strategy, u_int64_t bitsPerChunk, u_int64_t nTasks)
+{
+    typedef typename Curve::Point Point;
+    const u_int64_t nBatch = 2;
+
+    Multiexp_inputs<Curve> in(g, 128, nBatch);
+    MultiExp::Pippenger<Curve> plain(g, F, ThreadPool::defaultPool(), 1);
+    MultiExp::Pippenger<Curve> split(g, F, ThreadPool::defaultPool(), nTasks, signedDigits);
+    MultiExp::WindowTable table;
+    std::vector<Point> expected(nBatch), computed(nBatch);
+
+    plain.runBatch(expected.data(), in.bases.data(), in.scalarPtrs.data(), in.scalarSize, in.n, nBatch);
+
+    table.set(in.n, signedDigits, nTasks, MultiExp::WindowChoice{bitsPerChunk, strategy});
+    split.setWindowTable(&table);
+    split.runBatch(computed.data(), in.bases.data(), in.scalarPtrs.data(), in.scalarSize, in.n, nBatch);
+
+    for (u_int64_t w = 0; w < nBatch; w++) {
+        if (!g.eq(expected[w], computed[w])) {
+            std::cout << name << ":" << w << (signedDigits ? " signed" : "")
+                      << (strategy == MultiExp::SplitWindows ? ", windows" : ", points") << " of "
+                      << bitsPerChunk << " bits, " << nTasks << " tasks failed!" << std::endl;
+            tests_failed++;
+        }
+        tests_run++;
+    }
+}
+
+// Compares runBatch within a memory limit with runBatch without one, for
+// a limit of one byte, which no pass fits, and one just below the memory
+// of the pass without a limit, which takes narrower windows or fewer
+// tasks.
+template <typename Curve>
+void MemoryLimit_test(Curve &g, typename BatchAffine::CurveField<Curve>::Type &F, const std::string &name,
+                      bool signedDigits, bool batchAffine)
+{
+    typedef typename Curve::Point Point;
+    const u_int64_t nBatch = 2;
+    const u_int64_t nTasks = 3;
+
+    Multiexp_inputs<Curve> in(g, 128, nBatch);
+    MultiExp::Pippenger<Curve> msm(g, F, ThreadPool::defaultPool(), nTasks, signedDigits);
+    std::vector<Point> expected(nBatch);
+
+    msm.setBatchAffine(batchAffine);
+    msm.runBatch(expected.data(), in.bases.data(), in.scalarPtrs.data(), in.scalarSize, in.n, nBatch);
+
+    const u_int64_t fullWidth = msm.windowWidth(in.scalarSize*8, in.n, nBatch);
+    const u_int64_t limits[] = {1, msm.memorySize(in.scalarSize, in.n, nBatch) - 1};
+
+    for (u_int64_t limit : limits) {
+        std::vector<Point> computed(nBatch);
+
+        msm.setMemoryLimit(limit);
+        msm.runBatch(computed.data(), in.bases.data(), in.scalarPtrs.data(), in.scalarSize, in.n, nBatch);
+
+        const u_int64_t width = msm.windowWidth(in.scalarSize*8, in.n, nBatch);
+
+        for (u_int64_t w = 0; w < nBatch; w++) {
+            if (width > fullWidth || !g.eq(expected[w], computed[w])) {
+                std::cout << name << ":" << w << (signedDigits ? " signed" : "") << (batchAffine ? " affine" : "")
+                          << ", limit of " << limit << " bytes, " << width << " bit windows failed!" << std::endl;
+                tests_failed++;
+            }
+            tests_run++;
+        }
+    }
+}
+
+void Multiexp_unit_test()
+{
+    AltBn128::Engine &E = AltBn128::Engine::engine;
+
+    for (u_int64_t nBatch = 1; nBatch <= 3; nBatch += 2) {
+        for (u_int64_t nTasks = 1; nTasks <= 3; nTasks += 2) {
+            Profiled_test(E.g1, E.f1, "G1_Profiled", nBatch, nTasks);
+            Profiled_test(E.g2, E.f2, "G2_Profiled", nBatch, nTasks);
+        }
+    }
+
+    // The 512 bases take 43 windows of 6 bits, or 37 signed ones of 7 bits.
+    const u_int64_t nCopies[] = {2, 3, 4, 8, 64};
+
+    for (u_int64_t k : nCopies) {
+        for (int signedDigits = 0; signedDigits < 2; signedDigits++) {
+            Shifted_test(E.g1, E.f1, "G1_Shifted", signedDigits, k);
+            Shifted_test(E.g2, E.f2, "G2_Shifted", signedDigits, k);
+        }
+    }
+
+    const u_int64_t bits[] = {3, 8, 11};
+    const u_int64_t nTasks[] = {1, 3, 64};
+
+    for (int strategy = MultiExp::SplitPoints; strategy <= MultiExp::SplitWindows; strategy++) {
+        for (u_int64_t b : bits) {
+            for (u_int64_t t : nTasks) {
+                for (int signedDigits = 0; signedDigits < 2; signedDigits++) {
+                    Split_test(E.g1, E.f1, "G1_Split", signedDigits, (MultiExp::Strategy)strategy, b, t);
+                    Split_test(E.g2, E.f2, "G2_Split", signedDigits, (MultiExp::Strategy)strategy, b, t);
+                }
+            }
+        }
+    }
+
+    for (int signedDigits = 0; signedDigits < 2; signedDigits++) {
+        for (int batchAffine = 0; batchAffine < 2; batchAffine++) {
+            MemoryLimit_test(E.g1, E.f1, "G1_MemoryLimit", signedDigits, batchAffine);
+            MemoryLimit_test(E.g2, E.f2, "G2_MemoryLimit", signedDigits, batchAffine);
+        }
+    }
+}
+
+// Extends three vectors at once with the lazy butterflies of CosetFFT and
+// compares them with ifft, the coset shift and fft of the ffiasm FFT.
+void CosetFFT_test(u_int32_t domainPower)
+{
+    RawFr &f = RawFr::field;
+    const u_int64_t n = 1ULL << domainPower;
+    const int nVectors = 3;
+
+    FFT<RawFr> fft(n * 2);
+    CosetFFT<RawFr> cosetFft(n);
+
+    std::vector<std::vector<RawFr::Element>> computed(nVectors, std::vector<RawFr::Element>(n));
+    std::vector<std::vector<RawFr::Element>> expected(nVectors, std::vector<RawFr::Element>(n));
+    RawFr::Element *vectors[nVectors];
+
+    for (int v = 0; v < nVectors; v++) {
+        for (u_int64_t i = 0; i < n; i++) {
+            test_element(f, computed[v][i], i, v);
+            f.copy(expected[v][i], computed[v][i]);
+        }
+
+        fft.ifft(expected[v].data(), n);
+
+        for (u_int64_t i = 0; i < n; i++) {
+            f.mul(expected[v][i], expected[v][i], fft.root(domainPower + 1, i));
+        }
+
+        fft.fft(expected[v].data(), n);
+
+        vectors[v] = computed[v].data();
+    }
+
+    cosetFft.extend(vectors, nVectors);
+
+    for (int v = 0; v < nVectors; v++) {
+        for (u_int64_t i = 0; i < n; i++) {
+            if (!is_equal(expected[v][i].v, computed[v][i].v)) {
+                std::cout << __func__ << ":" << domainPower << " failed at vector " << v << ", index " << i << "!" << std::endl;
+                std::cout << "Expected: " << expected[v][i].v << std::endl;
+                std::cout << "Computed: " << computed[v][i].v << std::endl;
+                std::cout << std::endl;
+                tests_failed++;
+                break;
+            }
+        }
+        tests_run++;
+    }
+}
+
+void CosetFFT_unit_test()
+{
+    for (u_int32_t domainPower = 0; domainPower <= 9; domainPower++) {
+        CosetFFT_test(domainPower);
+    }
+}
+
+// Compares the products of Montgomery::FieldMul, which take the MULX kernel
+// on CPUs with BMI2 and ADX, with the field's own Montgomery multiplication.
+template <typename Field>
+void FieldMul_test(Field &f, const std::string &name)
+{
+    Montgomery::FieldMul<Field> fieldMul(f);
+    typename Field::Element a, b, expected, computed;
+
+    for (int i = 0; i < 64; i++) {
+        // The last operands are -1 and -2, the largest values.
+        test_element(f, a, i, 0, i % 9);
+        test_element(f, b, i, 1, i % 9);
+        if (i == 62) {
+            f.copy(a, f.negOne());
+            f.copy(b, f.negOne());
+        }
+        if (i == 63) {
+            f.add(a, f.negOne(), f.negOne());
+            f.copy(b, f.negOne());
+        }
+
+        f.mul(expected, a, b);
+        fieldMul.mul(computed, a, b);
+        compare_Result(expected.v, computed.v, a.v, b.v, i, name + "_mul");
+
+        f.square(expected, a);
+        fieldMul.square(computed, a);
+        compare_Result(expected.v, computed.v, a.v, i, name + "_square");
+    }
+}
+
+void FieldMul_unit_test()
+{
+    FieldMul_test(RawFr::field, "Fr_FieldMul");
+    FieldMul_test(RawFq::field, "Fq_FieldMul");
+}
+
+// Compares the fused Fq2 products, with and without MULX, with the
+// Karatsuba formulas over the Fq operations, for u^2 = -1.
+void QuadraticMul_test(bool mulx, const std::string &name)
+{
+    typedef RawFq::Element Element;
+    RawFq &f = RawFq::field;
+    Montgomery::FieldMul<RawFq> fieldMul(f);
+    const Montgomery::Modulus &m = fieldMul.getModulus();
+
+    Element a[2], b[2], expected[2], computed[2];
+    Element aa, bb, t0, t1;
+
+    for (int i = 0; i < 64; i++) {
+        for (int j = 0; j < 2; j++) {
+            test_element(f, a[j], i, j, i % 9);
+            test_element(f, b[j], i, j + 2, i % 9);
+        }
+        if (i >= 62) {
+            f.copy(a[0], f.negOne());
+            f.copy(a[1], f.negOne());
+            f.copy(b[i - 62], f.negOne());
+        }
+
+        f.mul(aa, a[0], b[0]);
+        f.mul(bb, a[1], b[1]);
+        f.add(t0, a[0], a[1]);
+        f.add(t1, b[0], b[1]);
+        f.mul(t0, t0, t1);
+        f.sub(t0, t0, aa);
+        f.sub(expected[1], t0, bb);
+        f.sub(expected[0], aa, bb);
+
+        Montgomery::mulQuadratic(computed[0].v, a[0].v, b[0].v, m, mulx);
+        compare_Result(expected[0].v, computed[0].v, a[0].v, b[0].v, i, name + "_mul_a");
+        compare_Result(expected[1].v, computed[1].v, a[1].v, b[1].v, i, name + "_mul_b");
+
+        f.square(aa, a[0]);
+        f.square(bb, a[1]);
+        f.mul(t0, a[0], a[1]);
+        f.sub(expected[0], aa, bb);
+        f.add(expected[1], t0, t0);
+
+        Montgomery::squareQuadratic(computed[0].v, a[0].v, m, mulx);
+        compare_Result(expected[0].v, computed[0].v, a[0].v, i, name + "_square_a");
+        compare_Result(expected[1].v, computed[1].v, a[1].v, i, name + "_square_b");
+    }
+}
+
+void QuadraticMul_unit_test()
+{
+    QuadraticMul_test(false, "Fq2_QuadraticMul");
+    if (Montgomery::hasMulx()) {
+        QuadraticMul_test(true, "Fq2_QuadraticMul_mulx");
+    }
+}
+
+// Compares the batch operations of every instruction set the CPU has with
+// the scalar operations of the field, over a length that leaves a tail.
+template <typename Field>
+void FieldBatch_test(Field &f, FieldBatch::Isa isa, const std::string &name)
+{
+    typedef typename Field::Element Element;
+    const u_int64_t n = 37;
+
+    FieldBatch::Batch<Field> batch(f, isa);
+    std::vector<Element> a(n), b(n), computed(n), expected(n);
+
+    for (u_int64_t i = 0; i < n; i++) {
+        test_element(f, a[i], i, 0);
+        test_element(f, b[i], i, 1);
+    }
+    f.copy(a[n - 1], f.negOne());
+    f.copy(b[n - 2], f.negOne());
+    f.copy(b[n - 3], a[n - 3]);
+
+    const std::string prefix = name + "_" + FieldBatch::isaName(isa);
+
+    batch.mul(computed.data(), a.data(), b.data(), n);
+    for (u_int64_t i = 0; i < n; i++) {
+        f.mul(expected[i], a[i], b[i]);
+        compare_Result(expected[i].v, computed[i].v, a[i].v, b[i].v, i, prefix + "_mul");
+    }
+
+    batch.mulBy(computed.data(), a.data(), b[n - 2], n);
+    for (u_int64_t i = 0; i < n; i++) {
+        f.mul(expected[i], a[i], b[n - 2]);
+        compare_Result(expected[i].v, computed[i].v, a[i].v, b[n - 2].v, i, prefix + "_mulBy");
+    }
+
+    batch.square(computed.data(), a.data(), n);
+    for (u_int64_t i = 0; i < n; i++) {
+        f.square(expected[i], a[i]);
+        compare_Result(expected[i].v, computed[i].v, a[i].v, i, prefix + "_square");
+    }
+
+    batch.add(computed.data(), a.data(), b.data(), n);
+    for (u_int64_t i = 0; i < n; i++) {
+        f.add(expected[i], a[i], b[i]);
+        compare_Result(expected[i].v, computed[i].v, a[i].v, b[i].v, i, prefix + "_add");
+    }
+
+    batch.sub(computed.data(), a.data(), b.data(), n);
+    for (u_int64_t i = 0; i < n; i++) {
+        f.sub(expected[i], a[i], b[i]);
+        compare_Result(expected[i].v, computed[i].v, a[i].v, b[i].v, i, prefix + "_sub");
+    }
+
+    // In place, as the prover runs them.
+    computed = a;
+    batch.mul(computed.data(), computed.data(), b.data(), n);
+    for (u_int64_t i = 0; i < n; i++) {
+        f.mul(expected[i], a[i], b[i]);
+        compare_Result(expected[i].v, computed[i].v, a[i].v, b[i].v, i, prefix + "_mul_in_place");
+    }
+}
+
+void FieldBatch_unit_test()
+{
+    for (int isa = FieldBatch::Scalar; isa <= FieldBatch::bestIsa(); isa++) {
+        FieldBatch_test(RawFr::field, (FieldBatch::Isa)isa, "Fr_FieldBatch");
+        FieldBatch_test(RawFq::field, (FieldBatch::Isa)isa, "Fq_FieldBatch");
+    }
+}
+
 void print_results()
 {
     std::cout << "Results: " << std::dec << tests_run << " tests were run, " << tests_failed << " failed." << std::endl;
@@ -11200,6 +12241,16 @@ int main()
     Fq_leq_s1l2n_unit_test();
     Fq_lnot_unit_test();
 
+    CoefPartition_unit_test();
+    Glv_unit_test();
+    WindowDigits_unit_test();
+    BatchAffine_unit_test();
+    Multiexp_unit_test();
+    CosetFFT_unit_test();
+    FieldMul_unit_test();
+    QuadraticMul_unit_test();
+    FieldBatch_unit_test();
+
 
     print_results();
 
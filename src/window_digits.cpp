@@ -0,0 +1,128 @@
+#include "window_digits.hpp"
+
+namespace MultiExp {
+
+// Offset of the scalars (view[w])[i] for i < nView among (base[w])[i] for
+// i < n, if they are a view into those.
+static bool viewOffset(const std::vector<uint8_t *> &base, uint64_t n, uint8_t *const *view, uint64_t nView,
+                       uint64_t nBatch, uint64_t scalarSize, uint64_t &offset)
+{
+    if (base.size() != nBatch) {
+        return false;
+    }
+
+    for (uint64_t w = 0; w < nBatch; w++) {
+        const uintptr_t from = (uintptr_t)base[w];
+        const uintptr_t p = (uintptr_t)view[w];
+
+        if (p < from || (p - from) % scalarSize != 0) {
+            return false;
+        }
+
+        const uint64_t o = (p - from) / scalarSize;
+
+        if ((w > 0 && o != offset) || o + nView > n) {
+            return false;
+        }
+        offset = o;
+    }
+
+    return true;
+}
+
+void WindowDigits::build(uint8_t *const *_scalars, uint64_t _scalarSize, uint64_t _scalarBits, uint64_t _n, uint64_t nBatch,
+                         uint64_t _bitsPerChunk, bool _signedDigits, ThreadPool &threadPool)
+{
+    scalars.assign(_scalars, _scalars + nBatch);
+    scalarSize = _scalarSize;
+    scalarBits = _scalarBits;
+    bitsPerChunk = _bitsPerChunk;
+    signedDigits = _signedDigits;
+    nChunks = windowCount(scalarBits, bitsPerChunk, signedDigits);
+    n = _n;
+    digits.resize(nChunks * n * nBatch);
+
+    const uint32_t half = 1U << (bitsPerChunk - 1);
+
+    bias = signedDigits ? half - 1 : 0;
+
+    threadPool.parallelFor(0, n, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        for (int64_t i = begin; i < end; i++) {
+            for (uint64_t w = 0; w < nBatch; w++) {
+                const uint8_t *scalar = scalars[w] + i*scalarSize;
+                uint32_t carry = 0;
+
+                for (uint64_t j = 0; j < nChunks; j++) {
+                    int32_t d = windowDigit(scalar, scalarSize, j*bitsPerChunk, bitsPerChunk) + carry;
+
+                    if (signedDigits) {
+                        carry = d > (int32_t)half;
+                        d -= (int32_t)(carry << bitsPerChunk);
+                    }
+
+                    digits[(j*n + i)*nBatch + w] = d + bias;
+                }
+            }
+        }
+    });
+}
+
+bool WindowDigits::covers(uint8_t *const *_scalars, uint64_t _scalarSize, uint64_t _scalarBits, uint64_t _n, uint64_t nBatch,
+                          uint64_t _bitsPerChunk, bool _signedDigits, uint64_t &offset) const
+{
+    // The digits of the low windows do not depend on the higher ones.
+    return scalarSize == _scalarSize &&
+           scalarBits >= _scalarBits &&
+           bitsPerChunk == _bitsPerChunk &&
+           signedDigits == _signedDigits &&
+           viewOffset(scalars, n, _scalars, _n, nBatch, scalarSize, offset);
+}
+
+void DigitCache::addScalars(uint8_t *const *scalars, uint64_t scalarSize, uint64_t n, uint64_t nBatch)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+
+    extents.push_back(Extent{std::vector<uint8_t *>(scalars, scalars + nBatch), scalarSize, n});
+}
+
+DigitView DigitCache::get(uint8_t *const *scalars, uint64_t scalarSize, uint64_t scalarBits, uint64_t n, uint64_t nBatch,
+                          uint64_t bitsPerChunk, bool signedDigits, ThreadPool &threadPool)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    uint64_t offset = 0;
+
+    for (const WindowDigits &digits : entries) {
+        if (digits.covers(scalars, scalarSize, scalarBits, n, nBatch, bitsPerChunk, signedDigits, offset)) {
+            return DigitView{&digits, offset};
+        }
+    }
+
+    // Entries may be in use by other multiexps, so they are never replaced.
+    entries.emplace_back();
+
+    for (const Extent &extent : extents) {
+        if (extent.scalarSize == scalarSize && viewOffset(extent.scalars, extent.n, scalars, n, nBatch, scalarSize, offset)) {
+            entries.back().build(extent.scalars.data(), scalarSize, scalarBits, extent.n, nBatch, bitsPerChunk, signedDigits, threadPool);
+
+            return DigitView{&entries.back(), offset};
+        }
+    }
+
+    entries.back().build(scalars, scalarSize, scalarBits, n, nBatch, bitsPerChunk, signedDigits, threadPool);
+
+    return DigitView{&entries.back(), 0};
+}
+
+uint64_t DigitCache::bytes()
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    uint64_t r = 0;
+
+    for (const WindowDigits &digits : entries) {
+        r += digits.bytes();
+    }
+
+    return r;
+}
+
+} // Namespace
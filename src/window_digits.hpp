@@ -0,0 +1,114 @@
+#ifndef WINDOW_DIGITS_HPP
+#define WINDOW_DIGITS_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <list>
+#include <mutex>
+#include <vector>
+
+#include "threadpool.hpp"
+
+namespace MultiExp {
+
+    // Unsigned window of 'bits' bits at 'bitPos' of a little-endian scalar.
+    inline uint32_t windowDigit(const uint8_t *scalar, uint64_t scalarSize, uint64_t bitPos, uint64_t bits) {
+        const uint64_t bytePos = bitPos >> 3;
+
+        if (bytePos >= scalarSize) {
+            return 0;
+        }
+
+        uint64_t v = 0;
+        std::memcpy(&v, scalar + bytePos, std::min<uint64_t>(sizeof(v), scalarSize - bytePos));
+
+        return (v >> (bitPos & 7)) & ((1ULL << bits) - 1);
+    }
+
+    // Windows of 'bitsPerChunk' bits needed for scalars below 2^scalarBits.
+    // Signed digits may carry into one more.
+    inline uint64_t windowCount(uint64_t scalarBits, uint64_t bitsPerChunk, bool signedDigits) {
+        return signedDigits ? scalarBits / bitsPerChunk + 1 : (scalarBits + bitsPerChunk - 1) / bitsPerChunk;
+    }
+
+    // Window digits of scalars, decoded once so that multiexps over the same
+    // scalars only do point work. Signed digit j is window j plus the carry
+    // into it, less 2^bitsPerChunk when that exceeds 2^(bitsPerChunk-1), so
+    // the digits lie in (-2^(bitsPerChunk-1), 2^(bitsPerChunk-1)] and a
+    // window needs half the buckets, the sign going to the point. The digits
+    // are stored window by window, in the order the bucket method reads
+    // them, in 16 bits offset by 'bias'.
+    class WindowDigits {
+
+        std::vector<uint8_t *> scalars;
+        uint64_t scalarSize;
+        uint64_t scalarBits;
+        uint64_t bitsPerChunk;
+        bool signedDigits;
+        uint64_t nChunks;
+        uint64_t n;
+        int32_t bias;
+        std::vector<uint16_t> digits;
+
+    public:
+        WindowDigits()
+            : scalarSize(0), scalarBits(0), bitsPerChunk(0), signedDigits(false),
+              nChunks(0), n(0), bias(0) {}
+
+        // Decodes the low 'scalarBits' of scalars[w][i] for i < n and
+        // w < nBatch.
+        void build(uint8_t *const *_scalars, uint64_t _scalarSize, uint64_t _scalarBits, uint64_t _n, uint64_t nBatch,
+                   uint64_t _bitsPerChunk, bool _signedDigits, ThreadPool &threadPool);
+
+        // Whether the scalars (_scalars[w])[i] for i < _n are the decoded
+        // ones from 'offset' on.
+        bool covers(uint8_t *const *_scalars, uint64_t _scalarSize, uint64_t _scalarBits, uint64_t _n, uint64_t nBatch,
+                    uint64_t _bitsPerChunk, bool _signedDigits, uint64_t &offset) const;
+
+        // Digit of window j of scalars[w][i].
+        int32_t digit(uint64_t i, uint64_t w, uint64_t j) const {
+            return (int32_t)digits[(j*n + i)*scalars.size() + w] - bias;
+        }
+
+        uint64_t bytes() const { return digits.size() * sizeof(uint16_t); }
+    };
+
+    // Digits of the scalars of one multiexp, from 'offset' on in 'digits'.
+    struct DigitView {
+        const WindowDigits *digits;
+        uint64_t offset;
+
+        int32_t digit(uint64_t i, uint64_t w, uint64_t j) const {
+            return digits->digit(offset + i, w, j);
+        }
+    };
+
+    // Digits shared by the multiexps of a proof. The scalars of a multiexp
+    // may be a view into those given to addScalars(), as the scalars of C
+    // are into the witness, and are then decoded over all of those, once
+    // for every view.
+    class DigitCache {
+
+        struct Extent {
+            std::vector<uint8_t *> scalars;
+            uint64_t scalarSize;
+            uint64_t n;
+        };
+
+        std::mutex mutex;
+        std::vector<Extent> extents;
+        std::list<WindowDigits> entries;
+
+    public:
+        void addScalars(uint8_t *const *scalars, uint64_t scalarSize, uint64_t n, uint64_t nBatch);
+
+        DigitView get(uint8_t *const *scalars, uint64_t scalarSize, uint64_t scalarBits, uint64_t n, uint64_t nBatch,
+                      uint64_t bitsPerChunk, bool signedDigits, ThreadPool &threadPool);
+
+        // Bytes held by the decoded digits.
+        uint64_t bytes();
+    };
+}
+
+#endif // WINDOW_DIGITS_HPP